@@ -16,6 +16,7 @@ class CompressorRecipe(ConanFile):
     def build_requirements(self):
         self.tool_requires("cmake/3.29.2")
         self.test_requires("gtest/1.14.0")
+        self.test_requires("benchmark/1.8.3")
         
     def layout(self):
         cmake_layout(self)
@@ -1,63 +1,112 @@
-﻿#include <logger/Logger.h>
-#include <md/BinaryDataReader.h>
-#include <md/MappedFile.h>
-#include <md/Symbols.h>
+﻿#include <logger/FileSink.h>
+#include <logger/Logger.h>
+#include <md/ItchReplay.h>
+#include <simulator/Backtest.h>
 #include <simulator/functions.h>
 
 #include <chrono>
+#include <memory>
 #include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace {
 
 using namespace std::string_literals;
 
-auto getTestFile() {
+// --name=VALUE, or the default without it
+auto getOption(int argc, char** argv, std::string_view option, std::string const& defaultValue = {}) {
+  for (auto const arg : std::span(argv + 1, argc - 1)) {
+    auto const value = std::string_view(arg);
+    if (value.starts_with(option) && value.substr(option.size()).starts_with('=')) return std::string(value.substr(option.size() + 1));
+  }
+  return defaultValue;
+}
+
+auto split(std::string const& list) {
+  auto items = std::vector<std::string>();
+  for (auto const item : std::views::split(list, ',')) items.emplace_back(item.begin(), item.end());
+  return items;
+}
+
+auto getTestFiles(int argc, char** argv) {
+  // files are replayed in the order given, one trading day each
+  auto files = std::vector<std::string>();
+  for (auto const arg : std::span(argv + 1, argc - 1)) {
+    if (!std::string_view(arg).starts_with("--")) files.emplace_back(arg);
+  }
+  if (!files.empty()) return files;
 #ifdef _WIN32
   auto const filename = "C:\\dev\\VS\\lob\\data\\01302019.NASDAQ_ITCH50"s;
 #else
-  auto const filename = "/mnt/itch-data/01302019.NASDAQ_ITCH50";
+  auto const filename = "/mnt/itch-data/01302019.NASDAQ_ITCH50"s;
 #endif
-  return md::MappedFile(filename);
+  return std::vector<std::string>{filename};
 }
 
 }  // namespace
 
-int main() {
+int main(int argc, char** argv) {
 
   using namespace std::chrono_literals;
 
-  auto logFile = std::ofstream("logs/main.log");
-  auto logger = logging::Logger(1024, logging::handlers::createFileHandler(logFile), 1ms);
+  auto logger = logging::Logger(1024, std::make_unique<logging::FileSink>("logs/main.log", logging::FileSinkOptions{.maxFileSize = 256 << 20}), 1ms);
 
   auto loggerPtr = &logger;
   //loggerPtr = nullptr;
 
-  auto const file = getTestFile();
+  // --strategy=NAME picks a registered strategy, --record=FILE only records the strategies' input,
+  // --backtest=SYMBOL,... runs the strategy on every day in parallel instead, on --threads=N.
+  // --cores=N,... pins the multi threaded run's strategies and simulator, in that order.
+  auto const strategyName = getOption(argc, argv, "--strategy", "TestStrategy");
+  auto const recording = getOption(argc, argv, "--record");
+  auto const backtestSymbols = getOption(argc, argv, "--backtest");
   auto const maxNumIters = 10000000;
+  auto cores = std::vector<int>();
+  for (auto const& core : split(getOption(argc, argv, "--cores"))) cores.push_back(std::stoi(core));
+
+  if (!backtestSymbols.empty()) {
+    auto const files = getTestFiles(argc, argv);
+    auto const symbolSets = std::vector<std::vector<std::string>>{split(backtestSymbols)};
+    auto const configs = std::vector{simulator::StrategyConfig{strategyName}};
+    auto options = simulator::BacktestOptions{};
+    if (auto const threads = getOption(argc, argv, "--threads"); !threads.empty()) options.numThreads = std::stoul(threads);
+    auto const report = simulator::runBacktests(simulator::makeBacktestJobs(files, symbolSets, configs), options);
+    std::println("{}", report.toString());
+    report.save("diagnostics/backtest.json");
+    return 0;
+  }
 
-  auto reader = md::BinaryDataReader(file.data(), file.size());
-  auto const symbols = md::utils::Symbols(reader);
-  std::println("Loaded {} symbols", symbols.count());
+  auto replay = md::ItchReplay(getTestFiles(argc, argv));
 
-  auto marketStart = reader.curr();
+  std::println("Loaded {} symbols ({} days), running {}", replay.count(), replay.numDays(), strategyName);
+
+  if (!recording.empty()) {
+    auto const symbolIds = std::vector<int>{replay.byName("QQQ"), replay.byName("SPY"), replay.byName("AMD"), replay.byName("IWM")};
+    auto const numRecorded = simulator::recordTopOfBook(replay, symbolIds, maxNumIters, recording);
+    std::println("Recorded {} top of book updates to {}", numRecorded, recording);
+    return 0;
+  }
 
   {
-    reader.reset(marketStart);
+    replay.rewind();
     if (loggerPtr) loggerPtr->log("Start single thread");
     std::println("Single thread:");
     auto const start = std::chrono::high_resolution_clock::now();
-    simulator::runTest(reader, symbols, maxNumIters, true, loggerPtr);
+    simulator::runTest(replay, maxNumIters, true, loggerPtr, strategyName);
     auto const end = std::chrono::high_resolution_clock::now();
     std::println("Time: {}.\n", std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
   }
 
   {
-    reader.reset(marketStart);
-    auto reader = md::BinaryDataReader(file.data(), file.size());
+    replay.rewind();
     if (loggerPtr) loggerPtr->log("Start multi threaded");
     std::println("Multi threaded:");
     auto const start = std::chrono::high_resolution_clock::now();
-    simulator::runTest(reader, symbols, maxNumIters, false, loggerPtr);
+    simulator::runTest(replay, maxNumIters, false, loggerPtr, strategyName, cores);
     auto const end = std::chrono::high_resolution_clock::now();
     std::println("Time: {}.\n", std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
   }
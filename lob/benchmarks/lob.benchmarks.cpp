@@ -0,0 +1,446 @@
+#include <benchmark/benchmark.h>
+#include <lob/lob.h>
+#include <md/BinaryDataReader.h>
+#include <md/MappedFile.h>
+#include <md/Symbols.h>
+#include <md/itch/Dispatch.h>
+#include <simulator/ItchToLobType.h>
+#include <simulator/TimingWheel.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> numAllocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  numAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto* ptr = std::malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+using namespace std::string_literals;
+
+using LevelT = lob::LimitOrderBook::LevelT;
+
+constexpr int Mid = 1000000;  // 100.0000
+constexpr int Tick = 100;     // 0.01
+constexpr int BatchSize = 1000;
+
+// Synthetic order flow: how far from the touch orders rest, how many orders rest in the book and
+// which fraction of non-add events are cancels (delete, reduce, replace) rather than executions.
+struct Profile {
+  char const* name;
+  int numLevels;
+  int numResting;
+  double cancelRatio;
+};
+
+constexpr auto profiles = std::array{
+    Profile{"NearTouch", 3, 1000, 0.5},
+    Profile{"DeepBook", 200, 20000, 0.5},
+    Profile{"HighCancel", 10, 5000, 0.95}};
+
+struct Op {
+  enum class Type : char {
+    Add,
+    Delete,
+    Reduce,
+    Replace,
+    Execute
+  };
+
+  Type type = Type::Add;
+  lob::OrderId id{0};
+  lob::OrderId newId{0};
+  lob::Direction direction = lob::Direction::Buy;
+  int size = 0;
+  LevelT level{0};
+};
+
+void apply(lob::LimitOrderBook& book, Op const& op) {
+  switch (op.type) {
+    case Op::Type::Add:
+      book.addOrder(op.id, op.direction, op.size, op.level);
+      break;
+    case Op::Type::Delete:
+      book.deleteOrder(op.id);
+      break;
+    case Op::Type::Reduce:
+      book.reduceOrder(op.id, op.size);
+      break;
+    case Op::Type::Replace:
+      book.replaceOrder(op.id, op.newId, op.size, op.level);
+      break;
+    case Op::Type::Execute:
+      book.executeOrder(op.id, op.size);
+      break;
+  }
+}
+
+class FlowGenerator {
+ public:
+  FlowGenerator(Profile const& profile, unsigned seed) : mProfile(profile), mRng(seed) {}
+
+  [[nodiscard]] Op add() {
+    auto const direction = coin(0.5) ? lob::Direction::Buy : lob::Direction::Sell;
+    auto const op = Op{Op::Type::Add, lob::OrderId(mNextId++), lob::OrderId(0), direction, 100 * uniform(1, 5), level(direction)};
+    mLive.push_back(op);
+    return op;
+  }
+
+  [[nodiscard]] Op next() {
+    if (mLive.empty() || coin(static_cast<int>(mLive.size()) < mProfile.numResting ? 0.6 : 0.4)) return add();
+
+    auto const idx = static_cast<size_t>(uniform(0, static_cast<int>(mLive.size()) - 1));
+    auto& order = mLive[idx];
+
+    if (!coin(mProfile.cancelRatio)) {
+      auto const size = coin(0.5) ? order.size : uniform(1, order.size);
+      auto const op = Op{Op::Type::Execute, order.id, lob::OrderId(0), order.direction, size, order.level};
+      if (size == order.size) remove(idx);
+      else order.size -= size;
+      return op;
+    }
+
+    auto const kind = uniform(0, 2);
+    if (kind == 0 && order.size > 1) {
+      auto const size = uniform(1, order.size - 1);
+      order.size -= size;
+      return Op{Op::Type::Reduce, order.id, lob::OrderId(0), order.direction, size, order.level};
+    }
+    if (kind == 1) {
+      auto const op = Op{Op::Type::Replace, order.id, lob::OrderId(mNextId++), order.direction, 100 * uniform(1, 5), level(order.direction)};
+      order.id = op.newId;
+      order.size = op.size;
+      order.level = op.level;
+      return op;
+    }
+    auto const op = Op{Op::Type::Delete, order.id, lob::OrderId(0), order.direction, order.size, order.level};
+    remove(idx);
+    return op;
+  }
+
+  [[nodiscard]] Op const& randomLive() {
+    return mLive[static_cast<size_t>(uniform(0, static_cast<int>(mLive.size()) - 1))];
+  }
+
+  [[nodiscard]] LevelT level(lob::Direction direction) {
+    auto const distance = Tick * (1 + uniform(0, mProfile.numLevels - 1));
+    return LevelT(direction == lob::Direction::Buy ? Mid - distance : Mid + distance);
+  }
+
+  [[nodiscard]] lob::OrderId nextId() noexcept {
+    return lob::OrderId(mNextId++);
+  }
+
+ private:
+  bool coin(double p) {
+    return std::uniform_real_distribution<double>(0, 1)(mRng) < p;
+  }
+
+  int uniform(int min, int max) {
+    return std::uniform_int_distribution<int>(min, max)(mRng);
+  }
+
+  void remove(size_t idx) {
+    mLive[idx] = mLive.back();
+    mLive.pop_back();
+  }
+
+  Profile mProfile;
+  std::mt19937 mRng;
+  std::vector<Op> mLive;
+  int mNextId = 1;
+};
+
+// Book with the profile's resting orders, plus the generator that knows about them.
+auto makeBook(Profile const& profile) {
+  auto result = std::pair{std::make_unique<lob::LimitOrderBook>(), FlowGenerator(profile, 42)};
+  auto& [book, flow] = result;
+  for (int i = 0; i != profile.numResting; ++i) {
+    apply(*book, flow.add());
+  }
+  return result;
+}
+
+void setCounters(benchmark::State& state, size_t numAllocationsTimed) {
+  auto const numOps = static_cast<double>(state.iterations()) * BatchSize;
+  state.SetItemsProcessed(static_cast<int64_t>(numOps));
+  state.counters["time/op"] = benchmark::Counter(BatchSize, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+  state.counters["allocs/op"] = benchmark::Counter(numAllocationsTimed / numOps);
+}
+
+// Runs a batch of BatchSize ops with setup and teardown excluded from timing and allocation counts.
+void runBatches(benchmark::State& state, auto const& setup, auto const& timed, auto const& teardown) {
+  auto const& profile = profiles[state.range(0)];
+  auto [book, flow] = makeBook(profile);
+  auto batch = std::vector<Op>(BatchSize);
+  size_t numAllocationsTimed = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (auto& op : batch) op = setup(*book, flow);
+    state.ResumeTiming();
+
+    auto const allocationsBefore = numAllocations.load(std::memory_order_relaxed);
+    for (auto const& op : batch) timed(*book, op);
+    numAllocationsTimed += numAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+    state.PauseTiming();
+    for (auto const& op : batch) teardown(*book, op);
+    state.ResumeTiming();
+  }
+
+  state.SetLabel(profile.name);
+  setCounters(state, numAllocationsTimed);
+}
+
+void BM_AddOrder(benchmark::State& state) {
+  runBatches(
+      state,
+      [](auto&, auto& flow) { auto const direction = flow.randomLive().direction; return Op{Op::Type::Add, flow.nextId(), lob::OrderId(0), direction, 100, flow.level(direction)}; },
+      [](auto& book, Op const& op) { book.addOrder(op.id, op.direction, op.size, op.level); },
+      [](auto& book, Op const& op) { book.deleteOrder(op.id); });
+}
+
+void BM_DeleteOrder(benchmark::State& state) {
+  runBatches(
+      state,
+      [](auto& book, auto& flow) { auto const direction = flow.randomLive().direction; auto const op = Op{Op::Type::Delete, flow.nextId(), lob::OrderId(0), direction, 100, flow.level(direction)}; book.addOrder(op.id, op.direction, op.size, op.level); return op; },
+      [](auto& book, Op const& op) { benchmark::DoNotOptimize(book.deleteOrder(op.id)); },
+      [](auto&, Op const&) {});
+}
+
+void BM_ReduceOrder(benchmark::State& state) {
+  runBatches(
+      state,
+      [](auto& book, auto& flow) { auto const direction = flow.randomLive().direction; auto const op = Op{Op::Type::Reduce, flow.nextId(), lob::OrderId(0), direction, 100, flow.level(direction)}; book.addOrder(op.id, op.direction, op.size, op.level); return op; },
+      [](auto& book, Op const& op) { benchmark::DoNotOptimize(book.reduceOrder(op.id, 40)); },
+      [](auto& book, Op const& op) { book.deleteOrder(op.id); });
+}
+
+void BM_ReplaceOrder(benchmark::State& state) {
+  runBatches(
+      state,
+      [](auto& book, auto& flow) { auto const direction = flow.randomLive().direction; auto const op = Op{Op::Type::Replace, flow.nextId(), flow.nextId(), direction, 200, flow.level(direction)}; book.addOrder(op.id, op.direction, 100, flow.level(direction)); return op; },
+      [](auto& book, Op const& op) { benchmark::DoNotOptimize(book.replaceOrder(op.id, op.newId, op.size, op.level)); },
+      [](auto& book, Op const& op) { book.deleteOrder(op.newId); });
+}
+
+void BM_ExecuteOrder(benchmark::State& state) {
+  runBatches(
+      state,
+      [](auto& book, auto& flow) { auto const direction = flow.randomLive().direction; auto const op = Op{Op::Type::Execute, flow.nextId(), lob::OrderId(0), direction, 100, direction == lob::Direction::Buy ? book.bid() : book.ask()}; book.addOrder(op.id, op.direction, op.size, op.level); return op; },
+      [](auto& book, Op const& op) { benchmark::DoNotOptimize(book.executeOrder(op.id, op.size)); },
+      [](auto&, Op const&) {});
+}
+
+void BM_Top(benchmark::State& state) {
+  runBatches(
+      state,
+      [](auto&, auto&) { return Op{}; },
+      [](auto const& book, Op const&) { benchmark::DoNotOptimize(book.top()); },
+      [](auto&, Op const&) {});
+}
+
+// Mixed flow of all operations in the profile's proportions.
+void BM_OrderFlow(benchmark::State& state) {
+  auto const& profile = profiles[state.range(0)];
+  auto [book, flow] = makeBook(profile);
+  size_t numAllocationsTimed = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto batch = std::vector<Op>(BatchSize);
+    for (auto& op : batch) op = flow.next();
+    state.ResumeTiming();
+
+    auto const allocationsBefore = numAllocations.load(std::memory_order_relaxed);
+    for (auto const& op : batch) apply(*book, op);
+    numAllocationsTimed += numAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+  }
+
+  state.SetLabel(profile.name);
+  setCounters(state, numAllocationsTimed);
+}
+
+auto getTestFilename() {
+#ifdef _WIN32
+  return "C:\\dev\\VS\\lob\\data\\01302019.NASDAQ_ITCH50"s;
+#else
+  return "/mnt/itch-data/01302019.NASDAQ_ITCH50"s;
+#endif
+}
+
+// Book operations of one symbol as recorded in the test file.
+std::vector<Op> const& recordedItchFlow(std::string const& symbol) {
+  static auto cache = std::map<std::string, std::vector<Op>>();
+  if (auto const it = cache.find(symbol); it != cache.end()) return it->second;
+
+  auto ops = std::vector<Op>();
+  auto const file = md::MappedFile(getTestFilename());
+  auto reader = md::BinaryDataReader(file.data(), file.size());
+  auto const locate = md::utils::Symbols(reader).byName(symbol);
+
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+  using namespace md::itch::types;
+
+  auto const addOrder = [&](itch_message<MessageType::ADD_ORDER> const& msg) {
+    if (msg.stock_locate == locate) ops.push_back({Op::Type::Add, toOrderId(msg.oid), lob::OrderId(0), toDirection(msg.buy), toInt(msg.qty), toLevel<lob::LimitOrderBook::Precision>(msg.price)});
+  };
+  auto const executeOrder = [&](itch_message<MessageType::EXECUTE_ORDER> const& msg) {
+    if (msg.stock_locate == locate) ops.push_back({Op::Type::Execute, toOrderId(msg.oid), lob::OrderId(0), lob::Direction::Buy, toInt(msg.qty)});
+  };
+  auto visitor = md::itch::overloaded{
+      addOrder,
+      [&](itch_message<MessageType::ADD_ORDER_MPID> const& msg) { addOrder(msg.add_msg); },
+      executeOrder,
+      [&](itch_message<MessageType::EXECUTE_ORDER_WITH_PRICE> const& msg) { executeOrder(msg.exec); },
+      [&](itch_message<MessageType::REDUCE_ORDER> const& msg) {
+        if (msg.stock_locate == locate) ops.push_back({Op::Type::Reduce, toOrderId(msg.oid), lob::OrderId(0), lob::Direction::Buy, toInt(msg.qty)});
+      },
+      [&](itch_message<MessageType::DELETE_ORDER> const& msg) {
+        if (msg.stock_locate == locate) ops.push_back({Op::Type::Delete, toOrderId(msg.oid)});
+      },
+      [&](itch_message<MessageType::REPLACE_ORDER> const& msg) {
+        if (msg.stock_locate == locate) ops.push_back({Op::Type::Replace, toOrderId(msg.oid), toOrderId(msg.new_order_id), lob::Direction::Buy, toInt(msg.new_qty), toLevel<lob::LimitOrderBook::Precision>(msg.new_price)});
+      }};
+
+  while (reader.remaining() > 3) {
+    md::itch::dispatch(reader, visitor);
+  }
+  return cache.emplace(symbol, std::move(ops)).first->second;
+}
+
+void BM_ItchFlow(benchmark::State& state) try {
+  auto const& ops = recordedItchFlow("QQQ");
+  size_t numAllocationsTimed = 0;
+
+  for (auto _ : state) {
+    auto book = lob::LimitOrderBook();
+    auto const allocationsBefore = numAllocations.load(std::memory_order_relaxed);
+    for (auto const& op : ops) apply(book, op);
+    numAllocationsTimed += numAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+  }
+
+  auto const numOps = static_cast<double>(state.iterations()) * ops.size();
+  state.SetLabel("QQQ");
+  state.SetItemsProcessed(static_cast<int64_t>(numOps));
+  state.counters["time/op"] = benchmark::Counter(static_cast<double>(ops.size()), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+  state.counters["allocs/op"] = benchmark::Counter(numAllocationsTimed / numOps);
+} catch (std::exception const& ex) {
+  state.SkipWithError(ex.what());
+}
+
+// Strategy timers in steady state: state.range(0) pending, each expiring one reschedules itself up
+// to 100us ahead, while the clock moves on by 100ns steps as market data would.
+template <class Scheduler>
+void runTimers(benchmark::State& state) {
+  auto scheduler = Scheduler();
+  auto rng = std::mt19937_64(42);
+  uint64_t now = 0;
+  size_t fired = 0;
+  for (int64_t i = 0; i != state.range(0); ++i) scheduler.add(rng() % 100'000);
+  for (auto _ : state) {
+    now += 100;
+    fired += scheduler.expire(now, [&] { scheduler.add(now + rng() % 100'000); });
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(fired));
+}
+
+struct WheelTimers {
+  void add(uint64_t time) {
+    wheel.schedule(time, [] {});
+  }
+
+  size_t expire(uint64_t now, auto const& reschedule) {
+    return wheel.expireUntil(now, [&](uint64_t, auto const& event) {
+      event();
+      reschedule();
+    });
+  }
+
+  simulator::TimingWheel<std::function<void()>> wheel;
+};
+
+// the binary heap the simulator used before
+struct HeapTimers {
+  using EventT = std::pair<uint64_t, std::function<void()>>;
+
+  struct Greater {
+    bool operator()(EventT const& lhs, EventT const& rhs) const noexcept {
+      return lhs.first > rhs.first;
+    }
+  };
+
+  void add(uint64_t time) {
+    queue.emplace(time, [] {});
+  }
+
+  size_t expire(uint64_t now, auto const& reschedule) {
+    size_t n = 0;
+    while (!queue.empty() && queue.top().first <= now) {
+      auto const event = queue.top().second;
+      queue.pop();
+      event();
+      reschedule();
+      ++n;
+    }
+    return n;
+  }
+
+  std::priority_queue<EventT, std::vector<EventT>, Greater> queue;
+};
+
+void BM_TimingWheel(benchmark::State& state) {
+  runTimers<WheelTimers>(state);
+}
+
+void BM_PriorityQueueEvents(benchmark::State& state) {
+  runTimers<HeapTimers>(state);
+}
+
+void profileArgs(benchmark::internal::Benchmark* b) {
+  for (int i = 0; i != static_cast<int>(profiles.size()); ++i) b->Arg(i);
+}
+
+BENCHMARK(BM_AddOrder)->Apply(profileArgs);
+BENCHMARK(BM_DeleteOrder)->Apply(profileArgs);
+BENCHMARK(BM_ReduceOrder)->Apply(profileArgs);
+BENCHMARK(BM_ReplaceOrder)->Apply(profileArgs);
+BENCHMARK(BM_ExecuteOrder)->Apply(profileArgs);
+BENCHMARK(BM_Top)->Apply(profileArgs);
+BENCHMARK(BM_OrderFlow)->Apply(profileArgs);
+BENCHMARK(BM_ItchFlow)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TimingWheel)->Arg(100)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_PriorityQueueEvents)->Arg(100)->Arg(10'000)->Arg(1'000'000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
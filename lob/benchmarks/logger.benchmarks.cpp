@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <logger/Logger.h>
+#include <logger/MpscQueue.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// per thread, so only the caller's allocations are counted and not the handler's
+thread_local size_t numAllocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++numAllocations;
+  if (auto* ptr = std::malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+// Cost on the calling thread of the log lines TestStrategy writes on a signal. The handler drops
+// the messages, so this is the producer side only.
+template <class LogF>
+void runLog(benchmark::State& state, LogF&& logF) {
+  auto logger = logging::Logger(1 << 16, [](logging::LogMessage const& msg) { benchmark::DoNotOptimize(msg.msg.data()); }, std::chrono::milliseconds(1));
+  double bid = 100.01;
+  double ask = 100.03;
+  double mean = 100.02;
+  double stdev = 0.004;
+
+  auto const allocationsBefore = numAllocations;
+  for (auto _ : state) {
+    logF(logger, bid, ask, (bid + ask) / 2, mean, stdev);
+    bid += 0.01;
+  }
+  state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(numAllocations - allocationsBefore), benchmark::Counter::kAvgIterations);
+  state.counters["dropped"] = static_cast<double>(logger.numDropped());
+}
+
+void BM_LogDeferred(benchmark::State& state) {
+  runLog(state, [](logging::Logger& logger, double bid, double ask, double micro, double mean, double stdev) {
+    logger.log("Bid/ask: {}/{}. micro: {}. Mean: {}, stdev: {}", bid, ask, micro, mean, stdev);
+  });
+}
+
+void BM_LogFormatted(benchmark::State& state) {
+  runLog(state, [](logging::Logger& logger, double bid, double ask, double micro, double mean, double stdev) {
+    logger.logFormatted("Bid/ask: {}/{}. micro: {}. Mean: {}, stdev: {}", bid, ask, micro, mean, stdev);
+  });
+}
+
+// Throughput of the log queue with state.range(0) producers pushing log records as fast as they can
+// while one consumer drains it, for each full queue policy.
+void BM_MpscQueue(benchmark::State& state) {
+  constexpr size_t NumItems = 1 << 20;
+  auto const numProducers = static_cast<size_t>(state.range(0));
+  auto const policy = static_cast<logging::FullPolicy>(state.range(1));
+
+  uint64_t numReceived = 0;
+  uint64_t numDropped = 0;
+  for (auto _ : state) {
+    auto queue = logging::MpscQueue<logging::LogRecord>(1024, policy);
+    auto numDone = std::atomic<size_t>(0);
+    {
+      auto producers = std::vector<std::jthread>();
+      for (size_t p = 0; p != numProducers; ++p) {
+        producers.emplace_back([&] {
+          for (size_t i = 0; i != NumItems / numProducers; ++i) {
+            queue.push([i](logging::LogRecord& record) { std::memcpy(record.args.data(), &i, sizeof(i)); });
+          }
+          ++numDone;
+        });
+      }
+      auto const consume = [&](logging::LogRecord const& record) { benchmark::DoNotOptimize(record.args[0]); ++numReceived; };
+      while (numDone != numProducers) {
+        if (!queue.pop(consume)) std::this_thread::yield();
+      }
+      while (queue.pop(consume)) {
+      }
+    }
+    numDropped += queue.numDropped();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * NumItems));
+  state.counters["dropped"] = benchmark::Counter(static_cast<double>(numDropped) / static_cast<double>(numReceived + numDropped));
+}
+
+}  // namespace
+
+BENCHMARK(BM_LogDeferred);
+BENCHMARK(BM_LogFormatted);
+BENCHMARK(BM_MpscQueue)
+    ->ArgNames({"producers", "policy"})
+    ->ArgsProduct({{1, 2, 4, 8}, {static_cast<int>(logging::FullPolicy::DropNewest), static_cast<int>(logging::FullPolicy::OverwriteOldest), static_cast<int>(logging::FullPolicy::Block)}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,28 @@
+#include <benchmark/benchmark.h>
+#include <md/itch/messages.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace {
+
+// Parse throughput of the most common message, at every alignment.
+void BM_ParseAddOrder(benchmark::State& state) {
+  auto data = std::array<char, 64 + 8>();
+  auto rng = std::mt19937(42);
+  std::ranges::generate(data, [&] { return static_cast<char>(rng()); });
+
+  size_t offset = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(md::itch::messages::itch_message<md::itch::messages::MessageType::ADD_ORDER>::parse(data.data() + offset));
+    offset = (offset + 1) & 7;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ParseAddOrder);
+
+}  // namespace
+
+BENCHMARK_MAIN();
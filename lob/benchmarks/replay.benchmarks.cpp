@@ -0,0 +1,242 @@
+// End-to-end replay benchmark: getNextMarketDataEvent -> Simulator::step -> ItchBooksManager -> strategy.
+// Replays a synthetic ITCH day from ItchGenerator (seeded, so runs are comparable between commits) and
+// writes throughput, per-message latency percentiles and the split across decode, book update,
+// top of book publish and strategy callback as JSON. The strategies are then also run alone, on a
+// recording of the tops they were fed.
+//
+// usage: ReplayBenchmark [--messages=N] [--symbols=N] [--seed=N] [--runs=N] [--output=file.json]
+
+#include <lob/LatencyHistogram.h>
+#include <lob/Tsc.h>
+#include <md/ItchGenerator.h>
+#include <md/ItchReplay.h>
+#include <simulator/ItchBooksManager.h>
+#include <simulator/OMS.h>
+#include <simulator/PipelineLatencies.h>
+#include <simulator/Simulator.h>
+#include <simulator/TopOfBookRecording.h>
+#include <simulator/functions.h>
+#include <strategies/Strategies.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Options {
+  size_t numMessages = 2000000;
+  int numSymbols = 8;
+  uint64_t seed = 42;
+  int numRuns = 3;
+  std::string output = "replay_benchmark.json";
+};
+
+Options parseOptions(int argc, char** argv) {
+  auto options = Options{};
+  auto const parse = [](std::string_view value, auto& target) {
+    if (std::from_chars(value.data(), value.data() + value.size(), target).ec != std::errc{}) {
+      throw std::runtime_error(std::format("Invalid value: {}", value));
+    }
+  };
+
+  for (int i = 1; i < argc; ++i) {
+    auto const arg = std::string_view(argv[i]);
+    auto const eq = arg.find('=');
+    auto const name = arg.substr(0, eq);
+    auto const value = eq == std::string_view::npos ? std::string_view() : arg.substr(eq + 1);
+    if (name == "--messages") parse(value, options.numMessages);
+    else if (name == "--symbols") parse(value, options.numSymbols);
+    else if (name == "--seed") parse(value, options.seed);
+    else if (name == "--runs") parse(value, options.numRuns);
+    else if (name == "--output") options.output = value;
+    else throw std::runtime_error(std::format("Unknown option: {}", arg));
+  }
+  if (options.numSymbols < 1 || options.numMessages < 2) throw std::runtime_error("Need at least one symbol and two messages");
+  return options;
+}
+
+nlohmann::json summary(lob::LatencyHistogram const& histogram) {
+  return {
+      {"mean", histogram.mean()},
+      {"p50", histogram.valueAtPercentile(50)},
+      {"p90", histogram.valueAtPercentile(90)},
+      {"p99", histogram.valueAtPercentile(99)},
+      {"p99.9", histogram.valueAtPercentile(99.9)},
+      {"max", histogram.max()},
+      {"total_ms", static_cast<double>(histogram.sum()) / 1e6}};
+}
+
+nlohmann::json runOnce(md::ItchReplay& replay, size_t numEvents) {
+  simulator::ItchBooksManager bmgr;
+  auto oms = simulator::OMS{};
+
+  struct Subscription {
+    simulator::ItchBooksManager::TopOfBookBuffer const& buffer;
+    strategies::TestStrategy strategy;
+    size_t readIdx = 0;
+  };
+
+  auto subscriptions = std::vector<Subscription>();
+  subscriptions.reserve(replay.count());
+  for (uint16_t id = 1; id <= replay.count(); ++id) {
+    subscriptions.push_back({bmgr.bufferById(id), strategies::TestStrategy(oms, id)});
+  }
+
+  auto latencies = simulator::PipelineLatencies{};
+  bmgr.setPublishLatency(&latencies.publish);
+
+  uint64_t decodeTicks = 0;
+  auto simulator = simulator::Simulator{[&] {
+    auto const start = lob::rdtsc();
+    auto event = simulator::getNextMarketDataEvent(replay, bmgr);
+    decodeTicks = lob::rdtsc() - start;
+    return event;
+  }};
+  oms.connect(simulator, bmgr);
+
+  // the step that applies the last event runs into the end of the replay
+  auto const numSteps = numEvents - 1;
+  auto total = lob::LatencyHistogram{};
+  auto strategy = lob::LatencyHistogram{};
+  auto book = lob::LatencyHistogram{};
+
+  auto const start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i != numSteps; ++i) {
+    auto const publishBefore = latencies.publish.sum();
+    auto const t0 = lob::rdtsc();
+    simulator.step();
+    oms.processRequests();
+    auto const t1 = lob::rdtsc();
+
+    for (auto& subscription : subscriptions) {
+      if (subscription.buffer.size() == subscription.readIdx) continue;
+      auto const [updates, m, M] = subscription.buffer.read(subscription.readIdx);
+      for (auto const& [timestamp, top] : updates) {
+        subscription.strategy.onUpdate(timestamp, top);
+      }
+      subscription.readIdx = M + 1;
+    }
+    auto const t2 = lob::rdtsc();
+
+    auto const decodeNs = lob::ticksToNs(decodeTicks);
+    auto const stepNs = lob::ticksToNs(t1 - t0);
+    auto const publishNs = latencies.publish.sum() - publishBefore;
+    total.record(lob::ticksToNs(t2 - t0));
+    latencies.decode.record(decodeNs);
+    book.record(stepNs - std::min(stepNs, decodeNs + publishNs));
+    strategy.record(lob::ticksToNs(t2 - t1));
+  }
+  auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  auto phases = nlohmann::json{
+      {"total", summary(total)},
+      {"decode", summary(latencies.decode)},
+      {"book_update", summary(book)},
+      {"publish", summary(latencies.publish)},
+      {"strategy", summary(strategy)}};
+
+  auto share = nlohmann::json::object();
+  for (auto const* phase : {"decode", "book_update", "publish", "strategy"}) {
+    share[phase] = phases[phase]["total_ms"].get<double>() / phases["total"]["total_ms"].get<double>();
+  }
+
+  return {
+      {"messages", numSteps},
+      {"seconds", seconds},
+      {"messages_per_second", static_cast<double>(numSteps) / seconds},
+      {"top_of_book_publishes", latencies.publish.count()},
+      {"latency_ns", phases},
+      {"time_share", share}};
+}
+
+// TestStrategy on every symbol of the recording, without the book engine in the loop.
+nlohmann::json runStrategiesOnce(simulator::TopOfBookRecording const& recording) {
+  auto oms = simulator::OMS{};
+  auto const maxId = recording.size() == 0 ? 0 : std::ranges::max(recording.records(), {}, &simulator::TopOfBookRecord::symbolId).symbolId;
+  auto byId = std::vector<std::unique_ptr<strategies::TestStrategy>>();
+  for (int id = 0; id <= maxId; ++id) byId.push_back(std::make_unique<strategies::TestStrategy>(oms, id));
+
+  auto const start = std::chrono::steady_clock::now();
+  for (auto const& record : recording.records()) {
+    byId[record.symbolId]->onUpdate(simulator::Simulator::TimestampT(record.timestamp), record.top());
+  }
+  auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return {
+      {"updates", recording.size()},
+      {"seconds", seconds},
+      {"updates_per_second", static_cast<double>(recording.size()) / seconds},
+      {"ns_per_update", seconds * 1e9 / static_cast<double>(recording.size())}};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+  auto const options = parseOptions(argc, argv);
+
+  auto const filename = (std::filesystem::temp_directory_path() / std::format("lob_replay_benchmark_{}.itch", options.seed)).string();
+  auto config = md::ItchGeneratorConfig{};
+  config.seed = options.seed;
+  config.numSymbols = options.numSymbols;
+  config.numMessages = options.numMessages;
+  auto const numEvents = md::generateItchFile(filename, config).numMessages;
+  auto const recordingFilename = (std::filesystem::temp_directory_path() / std::format("lob_replay_benchmark_{}.tops", options.seed)).string();
+  lob::calibrateTsc();
+  auto const ticksPerNs = lob::tscTicksPerNs();
+
+  auto runs = nlohmann::json::array();
+  {
+    auto replay = md::ItchReplay({filename});
+    for (int i = 0; i != options.numRuns; ++i) {
+      replay.rewind();
+      auto run = runOnce(replay, numEvents);
+      std::println("run {}: {:.0f} msgs/s, p50 {:.0f} ns, p99 {:.0f} ns, p99.9 {:.0f} ns", i,
+                   run["messages_per_second"].get<double>(), run["latency_ns"]["total"]["p50"].get<double>(),
+                   run["latency_ns"]["total"]["p99"].get<double>(), run["latency_ns"]["total"]["p99.9"].get<double>());
+      runs.push_back(std::move(run));
+    }
+
+    auto symbolIds = std::vector<int>(replay.count());
+    std::iota(symbolIds.begin(), symbolIds.end(), 1);
+    replay.rewind();
+    simulator::recordTopOfBook(replay, symbolIds, numEvents - 1, recordingFilename);
+  }
+  std::filesystem::remove(filename);
+
+  auto strategyRuns = nlohmann::json::array();
+  {
+    auto const recording = simulator::TopOfBookRecording(recordingFilename);
+    for (int i = 0; i != options.numRuns; ++i) {
+      auto run = runStrategiesOnce(recording);
+      std::println("strategies alone {}: {:.0f} updates/s, {:.1f} ns/update", i, run["updates_per_second"].get<double>(), run["ns_per_update"].get<double>());
+      strategyRuns.push_back(std::move(run));
+    }
+  }
+  std::filesystem::remove(recordingFilename);
+
+  auto const result = nlohmann::json{
+      {"config", {{"messages", options.numMessages}, {"symbols", options.numSymbols}, {"seed", options.seed}, {"runs", options.numRuns}}},
+      {"tsc_ticks_per_ns", ticksPerNs},
+      {"runs", runs},
+      {"strategy_runs", strategyRuns}};
+
+  auto out = std::ofstream(options.output);
+  out << result.dump(2) << std::endl;
+  std::println("Results written to {}", options.output);
+  return 0;
+} catch (std::exception const& ex) {
+  std::println("Exception: {}", ex.what());
+  return 1;
+}
@@ -0,0 +1,83 @@
+#include <md/ItchGenerator.h>
+
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <print>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr auto usage = R"(usage: itchgen FILE [options]
+  --seed=N              random seed (42)
+  --symbols=A,B,...     symbol names, or
+  --num-symbols=N       number of generated symbols (8)
+  --messages=N          order messages to write (10000000)
+  --rate=N              messages per second over all symbols (1000000)
+  --price-move=P        chance per message that a symbol's mid moves a tick (0.001)
+  --levels=N            orders rest within N ticks of the mid (10)
+  --cancel-ratio=P      fraction of removals that are cancels, not executions (0.9)
+  --lifetime-us=N       mean order lifetime in microseconds (5000)
+  --start-price=N       start mid in 1/10000 dollar (1000000)
+  --tick=N              tick size in 1/10000 dollar (100))";
+
+template <class T>
+T parse(std::string_view value) {
+  T result{};
+  if (std::from_chars(value.data(), value.data() + value.size(), result).ec != std::errc{}) {
+    throw std::runtime_error(std::format("Invalid value: {}", value));
+  }
+  return result;
+}
+
+md::ItchGeneratorConfig parseConfig(int argc, char** argv) {
+  auto config = md::ItchGeneratorConfig{};
+  for (int i = 2; i < argc; ++i) {
+    auto const arg = std::string_view(argv[i]);
+    auto const eq = arg.find('=');
+    auto const name = arg.substr(0, eq);
+    auto const value = eq == std::string_view::npos ? std::string_view() : arg.substr(eq + 1);
+
+    if (name == "--seed") config.seed = parse<uint64_t>(value);
+    else if (name == "--symbols") {
+      for (auto const symbol : std::views::split(value, ',')) config.symbols.emplace_back(std::string_view(symbol));
+    }
+    else if (name == "--num-symbols") config.numSymbols = parse<int>(value);
+    else if (name == "--messages") config.numMessages = parse<uint64_t>(value);
+    else if (name == "--rate") config.messagesPerSecond = parse<double>(value);
+    else if (name == "--price-move") config.priceMoveProbability = parse<double>(value);
+    else if (name == "--levels") config.numLevels = parse<int>(value);
+    else if (name == "--cancel-ratio") config.cancelRatio = parse<double>(value);
+    else if (name == "--lifetime-us") config.meanOrderLifetime = std::chrono::microseconds(parse<int64_t>(value));
+    else if (name == "--start-price") config.startPrice = parse<uint32_t>(value);
+    else if (name == "--tick") config.tickSize = parse<uint32_t>(value);
+    else throw std::runtime_error(std::format("Unknown option: {}", arg));
+  }
+  return config;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+  if (argc < 2 || std::string_view(argv[1]).starts_with("-")) {
+    std::println("{}", usage);
+    return 1;
+  }
+
+  auto const config = parseConfig(argc, argv);
+  auto const start = std::chrono::steady_clock::now();
+  auto const stats = md::generateItchFile(argv[1], config);
+  auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::println("Wrote {} messages ({} MB) to {} in {:.2f} s ({:.1f} M msgs/s, {:.0f} MB/s)", stats.numMessages, stats.numBytes >> 20, argv[1], seconds,
+               static_cast<double>(stats.numMessages) / seconds / 1e6, static_cast<double>(stats.numBytes) / seconds / (1 << 20));
+  std::println("adds: {}, executes: {}, reduces: {}, deletes: {}, replaces: {}", stats.numAdds, stats.numExecutes, stats.numReduces, stats.numDeletes, stats.numReplaces);
+  std::println("last timestamp: {} ns after midnight", stats.lastTimestamp.count());
+  return 0;
+} catch (std::exception const& ex) {
+  std::println("Exception: {}", ex.what());
+  return 1;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace lob {
+
+// Log-bucketed histogram of latencies (HDR style). Every power of two range is split into
+// SubBucketCount / 2 linear buckets, so recorded values are kept to within 1 / 64 (1.6%) of their
+// value while the whole range up to 2^40 (18 minutes in ns) fits into a fixed 18KB of counters.
+// Recording is a couple of instructions and never allocates. Instances are not thread safe: every
+// thread records into its own and they are merged for reporting.
+class LatencyHistogram {
+ public:
+  static constexpr int SubBucketBits = 7;
+  static constexpr int MaxValueBits = 40;
+  static constexpr uint64_t SubBucketCount = uint64_t(1) << SubBucketBits;
+  static constexpr uint64_t HalfCount = SubBucketCount / 2;
+  static constexpr uint64_t MaxValue = (uint64_t(1) << MaxValueBits) - 1;
+  static constexpr size_t NumBuckets = (MaxValueBits - SubBucketBits + 2) * HalfCount;
+
+  [[nodiscard]] static constexpr size_t bucketIndex(uint64_t value) noexcept {
+    value = std::min(value, MaxValue);
+    if (value < SubBucketCount) return static_cast<size_t>(value);
+    auto const shift = std::bit_width(value) - SubBucketBits;
+    return static_cast<size_t>((shift + 1) * HalfCount + (value >> shift) - HalfCount);
+  }
+
+  // Smallest and largest value that share the bucket.
+  [[nodiscard]] static constexpr uint64_t bucketLowest(size_t index) noexcept {
+    if (index < SubBucketCount) return index;
+    auto const shift = index / HalfCount - 1;
+    return (index % HalfCount + HalfCount) << shift;
+  }
+
+  [[nodiscard]] static constexpr uint64_t bucketHighest(size_t index) noexcept {
+    if (index < SubBucketCount) return index;
+    auto const shift = index / HalfCount - 1;
+    return bucketLowest(index) + (uint64_t(1) << shift) - 1;
+  }
+
+  void record(uint64_t value) noexcept {
+    ++mCounts[bucketIndex(value)];
+    ++mCount;
+    mSum += value;
+    mMin = std::min(mMin, value);
+    mMax = std::max(mMax, value);
+  }
+
+  void record(std::chrono::nanoseconds value) noexcept {
+    record(static_cast<uint64_t>(std::max<int64_t>(value.count(), 0)));
+  }
+
+  void merge(LatencyHistogram const& other) noexcept {
+    for (size_t i = 0; i != NumBuckets; ++i) {
+      mCounts[i] += other.mCounts[i];
+    }
+    mCount += other.mCount;
+    mSum += other.mSum;
+    mMin = std::min(mMin, other.mMin);
+    mMax = std::max(mMax, other.mMax);
+  }
+
+  void reset() noexcept {
+    *this = LatencyHistogram{};
+  }
+
+  [[nodiscard]] uint64_t count() const noexcept { return mCount; }
+  [[nodiscard]] uint64_t min() const noexcept { return mCount ? mMin : 0; }
+  [[nodiscard]] uint64_t max() const noexcept { return mMax; }
+  [[nodiscard]] uint64_t sum() const noexcept { return mSum; }
+  [[nodiscard]] double mean() const noexcept { return mCount ? static_cast<double>(mSum) / static_cast<double>(mCount) : 0.0; }
+
+  // Highest value of the bucket holding the given percentile (0-100), capped at the exact max.
+  [[nodiscard]] uint64_t valueAtPercentile(double percentile) const noexcept {
+    if (mCount == 0) return 0;
+    auto const rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(mCount) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i != NumBuckets; ++i) {
+      seen += mCounts[i];
+      if (seen >= rank) return std::min(bucketHighest(i), mMax);
+    }
+    return mMax;
+  }
+
+  // Calls f(lowest, highest, count) for every non-empty bucket in increasing order.
+  template <class F>
+  void forEachBucket(F&& f) const {
+    for (size_t i = 0; i != NumBuckets; ++i) {
+      if (mCounts[i]) f(bucketLowest(i), bucketHighest(i), mCounts[i]);
+    }
+  }
+
+  [[nodiscard]] std::string summary(std::string_view unit = "ns") const {
+    return std::format("count: {}, min: {}{}, p50: {}{}, p99: {}{}, p99.9: {}{}, max: {}{}, mean: {:.1f}{}",
+                       count(), min(), unit, valueAtPercentile(50), unit, valueAtPercentile(99), unit,
+                       valueAtPercentile(99.9), unit, max(), unit, mean(), unit);
+  }
+
+ private:
+  std::array<uint64_t, NumBuckets> mCounts = {};
+  uint64_t mCount = 0;
+  uint64_t mSum = 0;
+  uint64_t mMin = std::numeric_limits<uint64_t>::max();
+  uint64_t mMax = 0;
+};
+
+static_assert(LatencyHistogram::bucketIndex(LatencyHistogram::MaxValue) == LatencyHistogram::NumBuckets - 1);
+static_assert(LatencyHistogram::bucketLowest(LatencyHistogram::bucketIndex(1000)) <= 1000);
+static_assert(LatencyHistogram::bucketHighest(LatencyHistogram::bucketIndex(1000)) >= 1000);
+
+}  // namespace lob
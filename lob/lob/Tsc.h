@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace lob {
+
+// Reads the time stamp counter. Costs a handful of cycles, against tens of ns for a clock call,
+// so it can be taken around every message. Falls back to steady_clock ticks where there is no TSC.
+[[nodiscard]] inline uint64_t rdtsc() noexcept {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Counts TSC ticks against steady_clock over interval. Assumes an invariant TSC, which every
+// x86 CPU of the last decade has.
+[[nodiscard]] inline double calibrateTscTicksPerNs(std::chrono::nanoseconds interval = std::chrono::milliseconds(100)) {
+  auto const start = std::chrono::steady_clock::now();
+  auto const startTicks = rdtsc();
+  auto now = start;
+  while (now - start < interval) {
+    now = std::chrono::steady_clock::now();
+  }
+  auto const ticks = rdtsc() - startTicks;
+  return static_cast<double>(ticks) / static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+}
+
+namespace detail {
+
+// Written once by calibrateTsc() before the hot path starts and only read afterwards, so
+// converting is a load and a multiply with no guard on the way.
+struct TscCalibration {
+  uint64_t baseTicks = 0;
+  double ticksPerNs = 0.0;
+  double nsPerTick = 0.0;
+};
+
+inline TscCalibration tscCalibration;
+inline std::once_flag tscCalibrated;
+
+}  // namespace detail
+
+// Calibrates the TSC and sets the TscClock epoch. Only the first call does the work; make it
+// before the threads taking timestamps start, as ticksToNs() and TscClock count 0 until then.
+inline void calibrateTsc() {
+  std::call_once(detail::tscCalibrated, [] {
+    auto const ticksPerNs = calibrateTscTicksPerNs();
+    detail::tscCalibration = {rdtsc(), ticksPerNs, 1.0 / ticksPerNs};
+  });
+}
+
+[[nodiscard]] inline double tscTicksPerNs() {
+  calibrateTsc();
+  return detail::tscCalibration.ticksPerNs;
+}
+
+[[nodiscard]] inline uint64_t ticksToNs(uint64_t ticks) noexcept {
+  return static_cast<uint64_t>(static_cast<double>(ticks) * detail::tscCalibration.nsPerTick);
+}
+
+// std::chrono clock on the TSC. now() is an rdtsc and a multiply, so stamping a message and taking
+// the lag on the consumer side no longer cost a clock call each. The epoch is set by
+// calibrateTsc(). Time points are only comparable within the process.
+struct TscClock {
+  using rep = int64_t;
+  using period = std::nano;
+  using duration = std::chrono::nanoseconds;
+  using time_point = std::chrono::time_point<TscClock>;
+  static constexpr bool is_steady = true;
+
+  [[nodiscard]] static time_point now() noexcept {
+    // signed, as another core's counter can lag behind the one that took the base by a few ticks
+    auto const ticks = std::max(static_cast<int64_t>(rdtsc() - detail::tscCalibration.baseTicks), int64_t{0});
+    return time_point(duration(static_cast<rep>(static_cast<double>(ticks) * detail::tscCalibration.nsPerTick)));
+  }
+};
+
+// Clock of the timestamps on published market data. Building with LOB_USE_TSC_CLOCK switches it
+// from steady_clock to TscClock; it has to be the same in every target sharing the buffers.
+#if defined(LOB_USE_TSC_CLOCK)
+using PublishClock = TscClock;
+#else
+using PublishClock = std::chrono::steady_clock;
+#endif
+
+}  // namespace lob
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace lob {
+
+// Virtual (strategy owned) orders resting at one price level, kept apart from the real orders so
+// they change neither the depth nor the top of book. Each joined behind the real quantity at the
+// level at the time; real orders that were ahead of it and are cancelled or executed later reduce
+// that quantity.
+//
+// Entries are kept in arrival order, so the entries behind a real order are a suffix. The
+// reductions are a Fenwick tree over the entry index: a real order shrinking adds its quantity from
+// the first entry behind it onwards, an O(log n) update, and an entry's quantity ahead is what it
+// joined behind minus an O(log n) prefix sum. Removed entries are compacted away once they are the
+// majority.
+class VirtualQueue {
+ public:
+  using IdT = uint64_t;
+
+  // seq orders the entry among the real orders of the level: greater than those ahead of it
+  void add(IdT id, uint64_t seq, int ahead) {
+    auto const i = mEntries.size();
+    growTree();
+    // reductions so far also count for the new entry's prefix, which its baseline cancels out
+    mEntries.push_back({id, seq, ahead + sum(i + 1), true});
+    mIndex.emplace(id, i);
+  }
+
+  bool remove(IdT id) {
+    auto const it = mIndex.find(id);
+    if (it == mIndex.end()) return false;
+    mEntries[it->second].live = false;
+    mIndex.erase(it);
+    if (mEntries.size() >= 64 && mIndex.size() < mEntries.size() / 2) compact();
+    return true;
+  }
+
+  [[nodiscard]] int ahead(IdT id) const {
+    auto const i = mIndex.at(id);
+    return static_cast<int>(mEntries[i].baseline - sum(i + 1));
+  }
+
+  // The real order that joined with seq shrank by qty.
+  void reduce(uint64_t seq, int qty) {
+    for (auto i = firstBehind(seq) + 1; i <= mEntries.size(); i += i & (~i + 1)) mTree[i] += qty;
+  }
+
+  // Calls f(id) for the entries that joined before the real order with seq, oldest first, while f
+  // returns true. Returns whether f never stopped it.
+  template <class F>
+  bool forEachAhead(uint64_t seq, F&& f) const {
+    return forEachUntil(firstBehind(seq), f);
+  }
+
+  // Calls f(id) for every entry, oldest first, while f returns true. Returns whether f never stopped
+  // it.
+  template <class F>
+  bool forEach(F&& f) const {
+    return forEachUntil(mEntries.size(), f);
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return mIndex.empty();
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mIndex.size();
+  }
+
+ private:
+  struct Entry {
+    IdT id;
+    uint64_t seq;
+    int64_t baseline;  // quantity ahead when joining plus the reductions already counted for it
+    bool live;
+  };
+
+  template <class F>
+  bool forEachUntil(size_t end, F& f) const {
+    for (size_t i = 0; i != end; ++i) {
+      if (mEntries[i].live && !f(mEntries[i].id)) return false;
+    }
+    return true;
+  }
+
+  [[nodiscard]] size_t firstBehind(uint64_t seq) const {
+    return static_cast<size_t>(std::ranges::upper_bound(mEntries, seq, {}, &Entry::seq) - mEntries.begin());
+  }
+
+  // sum of the reductions added at the first n entries, node k of the tree covers entries (k - lowbit(k), k]
+  [[nodiscard]] int64_t sum(size_t n) const {
+    int64_t total = 0;
+    for (auto k = n; k != 0; k -= k & (~k + 1)) total += mTree[k];
+    return total;
+  }
+
+  // Adds the node of the next entry, covering reductions already added at the entries before it.
+  void growTree() {
+    if (mTree.empty()) mTree.push_back(0);
+    auto const k = mTree.size();
+    mTree.push_back(sum(k - 1) - sum(k - (k & (~k + 1))));
+  }
+
+  void compact() {
+    auto entries = std::vector<Entry>();
+    entries.reserve(mIndex.size());
+    for (size_t i = 0; i != mEntries.size(); ++i) {
+      if (mEntries[i].live) entries.push_back({mEntries[i].id, mEntries[i].seq, mEntries[i].baseline - sum(i + 1), true});
+    }
+    mEntries = std::move(entries);
+    mTree.assign(mEntries.size() + 1, 0);
+    for (size_t i = 0; i != mEntries.size(); ++i) mIndex[mEntries[i].id] = i;
+  }
+
+  std::vector<Entry> mEntries;
+  std::vector<int64_t> mTree;  // 1-based, mTree[0] unused
+  boost::unordered_map<IdT, size_t> mIndex;
+};
+
+}  // namespace lob
@@ -8,9 +8,12 @@
 #include <iterator>
 #include <list>
 #include <map>
+#include <optional>
 #include <print>
 #include <ranges>
 
+#include "VirtualQueue.h"
+
 namespace lob {
 
 template <class... Args>
@@ -130,12 +133,14 @@ template <int Precision>
 class LimitOrder {
  public:
   using LevelT = Level<Precision>;
-  constexpr LimitOrder(int size, Direction direction, LevelT level, OrderId orderId) : mSize(size), mDirection(direction), mLevel(level), mOrderId(orderId) {}
+  constexpr LimitOrder(int size, Direction direction, LevelT level, OrderId orderId, uint64_t seq = 0) : mSize(size), mDirection(direction), mLevel(level), mOrderId(orderId), mSeq(seq) {}
 
   [[nodiscart]] constexpr auto size() const noexcept { return mSize; }
   [[nodiscart]] constexpr auto direction() const noexcept { return mDirection; }
   [[nodiscart]] constexpr auto level() const noexcept { return mLevel; }
   [[nodiscart]] constexpr auto orderId() const noexcept { return mOrderId; }
+  // arrival order within the book, to tell which orders at a level are ahead of others
+  [[nodiscart]] constexpr auto seq() const noexcept { return mSeq; }
   constexpr auto setSize(int size) noexcept { mSize = size; }
 
  private:
@@ -143,14 +148,15 @@ class LimitOrder {
   Direction mDirection;
   LevelT mLevel;
   OrderId mOrderId;
+  uint64_t mSeq;
 };
 
 template <int Precision>
 class LevelOrders {
  public:
-  auto add(int size, Direction direction, Level<Precision> level, OrderId orderId) {
+  auto add(int size, Direction direction, Level<Precision> level, OrderId orderId, uint64_t seq) {
     mDepth += size;
-    return mOrders.emplace(mOrders.begin(), size, direction, level, orderId);
+    return mOrders.emplace(mOrders.begin(), size, direction, level, orderId, seq);
   }
 
   void remove(std::list<LimitOrder<Precision>>::iterator it) {
@@ -207,7 +213,7 @@ class LimitOrderBook {
 
   OrderId addOrder(const OrderId orderId, const Direction direction, const int size, const LevelT level) {
     // todo(?): check if we can (partially) trade
-    auto it = (direction == Direction::Sell ? mAsk : mBid)[level].add(size, direction, level, orderId);
+    auto it = (direction == Direction::Sell ? mAsk : mBid)[level].add(size, direction, level, orderId, mNextSeq++);
     mOrders.emplace(orderId, it);
 
     return orderId;
@@ -220,6 +226,7 @@ class LimitOrderBook {
     auto const orderIt = it->second;
     auto const level = orderIt->level();
     auto& side = orderIt->direction() == Direction::Sell ? mAsk : mBid;
+    realOrderReduced(*orderIt, orderIt->size());
     side[level].remove(orderIt);
     if (side[level].empty()) side.erase(level);
     mOrders.erase(it);
@@ -240,6 +247,7 @@ class LimitOrderBook {
 
     auto const level = orderIt->level();
     auto& side = orderIt->direction() == Direction::Sell ? mAsk : mBid;
+    realOrderReduced(*orderIt, numCancelled);
     side[level].reduce(orderIt->size(), newSize);
     orderIt->setSize(newSize);
 
@@ -263,6 +271,8 @@ class LimitOrderBook {
       // std::println("replaceOrder: new level same as the old one! client probably should have reduced (partially cancelled) order to retain time priority. Or is this case handled as a reduce by the exchange?");
     }
 
+    // the new order joins at the back, even at the same price
+    realOrderReduced(*orderIt, orderIt->size());
     side[oldLevel].remove(orderIt);
     if (side[oldLevel].empty()) side.erase(oldLevel);
     mOrders.erase(it);
@@ -289,13 +299,8 @@ class LimitOrderBook {
       std::cout << *this << std::endl;*/
     }
 
-    
-    if (auto [total, priority] = side[level].timePriority(orderIt); priority != 1) {
-      /*std::println("Executing {}, but not best time priority (priority: {}, total: {}, bs: {})", (int)orderId, priority, total, bs);
-      std::print("level: {} ({}). ", static_cast<int>(level), static_cast<double>(level));
-      side[level].print();*/
-    }
 
+    realOrderReduced(*orderIt, size);
     if (orderIt->size() == size) {
       side[level].remove(orderIt);
       if (side[level].empty()) side.erase(level);
@@ -312,6 +317,96 @@ class LimitOrderBook {
     }
   }
 
+  [[nodiscard]] std::optional<LevelT> orderLevel(const OrderId orderId) const {
+    auto const it = mOrders.find(orderId);
+    if (it == mOrders.end()) return {};
+    return it->second->level();
+  }
+
+  [[nodiscard]] std::optional<Direction> orderDirection(const OrderId orderId) const {
+    auto const it = mOrders.find(orderId);
+    if (it == mOrders.end()) return {};
+    return it->second->direction();
+  }
+
+  // total size resting at a price, 0 if there is no such level
+  [[nodiscard]] int depthAt(const Direction direction, const LevelT level) const {
+    auto const& side = direction == Direction::Sell ? mAsk : mBid;
+    auto const it = side.find(level);
+    return it == side.end() ? 0 : it->second.depth();
+  }
+
+  // Visits the levels of one side from the best price outwards while f(level, depth) returns true.
+  template <class F>
+  void forEachLevel(const Direction direction, F&& f) const {
+    auto const& side = direction == Direction::Sell ? mAsk : mBid;
+    for (auto it = side.rbegin(); it != side.rend(); ++it) {
+      if (!f(it->first, it->second.depth())) return;
+    }
+  }
+
+  using VirtualOrderId = VirtualQueue::IdT;
+
+  // Adds a strategy order at the back of the queue at level. Virtual orders are not part of the
+  // depth or the top of book, the book only tracks the real quantity ahead of them.
+  void addVirtualOrder(const VirtualOrderId id, const Direction direction, const LevelT level) {
+    auto& queues = direction == Direction::Sell ? mVirtualAsk : mVirtualBid;
+    queues[level].add(id, mNextSeq++, depthAt(direction, level));
+    mVirtualOrders.emplace(id, std::pair(direction, level));
+  }
+
+  bool deleteVirtualOrder(const VirtualOrderId id) {
+    auto const it = mVirtualOrders.find(id);
+    if (it == mVirtualOrders.end()) return false;
+
+    auto const [direction, level] = it->second;
+    auto& queues = direction == Direction::Sell ? mVirtualAsk : mVirtualBid;
+    auto const queue = queues.find(level);
+    queue->second.remove(id);
+    if (queue->second.empty()) queues.erase(queue);
+    mVirtualOrders.erase(it);
+
+    return true;
+  }
+
+  // real quantity ahead of a virtual order at its level
+  [[nodiscard]] std::optional<int> queueAhead(const VirtualOrderId id) const {
+    auto const it = mVirtualOrders.find(id);
+    if (it == mVirtualOrders.end()) return {};
+    auto const [direction, level] = it->second;
+    return (direction == Direction::Sell ? mVirtualAsk : mVirtualBid).at(level).ahead(id);
+  }
+
+  // Calls f(id) for the virtual orders at the level of a real order that joined before it, oldest
+  // first, while f returns true. When the real order executes, these would have been executed first.
+  template <class F>
+  void forEachVirtualOrderAhead(const OrderId orderId, F&& f) const {
+    if (mVirtualOrders.empty()) return;
+    auto const it = mOrders.find(orderId);
+    if (it == mOrders.end()) return;
+    auto const& order = *it->second;
+    auto const& queues = order.direction() == Direction::Sell ? mVirtualAsk : mVirtualBid;
+    if (auto const queue = queues.find(order.level()); queue != queues.end()) queue->second.forEachAhead(order.seq(), f);
+  }
+
+  // Calls f(id) for the virtual orders of one side at better prices than level, best price first and
+  // oldest first within a level, while f returns true. An execution at level went through their
+  // prices, so these would have been executed first.
+  template <class F>
+  void forEachVirtualOrderThrough(const Direction direction, const LevelT level, F&& f) const {
+    auto const visit = [&f](auto first, auto last) {
+      for (auto it = first; it != last; ++it) {
+        if (!it->second.forEach(f)) return;
+      }
+    };
+    if (direction == Direction::Sell) visit(mVirtualAsk.begin(), mVirtualAsk.lower_bound(level));
+    else visit(mVirtualBid.rbegin(), std::make_reverse_iterator(mVirtualBid.upper_bound(level)));
+  }
+
+  [[nodiscard]] auto numVirtualOrders() const noexcept {
+    return mVirtualOrders.size();
+  }
+
   [[nodiscard]] auto hasBids() const noexcept {
     return !mBid.empty();
   }
@@ -359,9 +454,22 @@ class LimitOrderBook {
   }
 
  private:
+  // a real order was cancelled or executed in part or in full: less is ahead of the virtual orders
+  // that joined its level after it
+  void realOrderReduced(LimitOrder<Precision> const& order, int qty) {
+    if (mVirtualOrders.empty()) return;
+    auto& queues = order.direction() == Direction::Sell ? mVirtualAsk : mVirtualBid;
+    if (auto const queue = queues.find(order.level()); queue != queues.end()) queue->second.reduce(order.seq(), qty);
+  }
+
   UnorderedMapT<OrderId, typename std::list<LimitOrder<Precision>>::iterator> mOrders;
   MapT<LevelT, LevelOrders<Precision>, std::function<bool(LevelT, LevelT)>> mBid;
   MapT<LevelT, LevelOrders<Precision>, std::function<bool(LevelT, LevelT)>> mAsk;
+  uint64_t mNextSeq = 0;
+
+  UnorderedMapT<VirtualOrderId, std::pair<Direction, LevelT>> mVirtualOrders;
+  MapT<LevelT, VirtualQueue> mVirtualBid;
+  MapT<LevelT, VirtualQueue> mVirtualAsk;
 
   inline friend std::ostream& operator<<(std::ostream& ostr, LimitOrderBook const& book) noexcept {
     ostr << "[ LimitOrderBook begin ]" << std::endl;
@@ -0,0 +1,67 @@
+#include "FileSink.h"
+
+#include <format>
+#include <stdexcept>
+#include <system_error>
+
+logging::FileSink::FileSink(std::filesystem::path path, FileSinkOptions options) : mPath(std::move(path)), mOptions(options) {
+  mBuffer.reserve(mOptions.bufferSize + 4096);
+  open(!mOptions.append);
+}
+
+logging::FileSink::~FileSink() {
+  try {
+    flush();
+  } catch (...) {
+  }
+}
+
+void logging::FileSink::write(LogMessage const& msg) {
+  if (mBuffer.empty()) mOldestBuffered = std::chrono::steady_clock::now();
+  mBuffer += toString(msg);
+  mBuffer += '\n';
+  if (mBuffer.size() >= mOptions.bufferSize) flush();
+}
+
+void logging::FileSink::endBatch() {
+  if (!mBuffer.empty() && std::chrono::steady_clock::now() - mOldestBuffered >= mOptions.flushInterval) flush();
+}
+
+void logging::FileSink::flush() {
+  if (mBuffer.empty()) return;
+  if (mOptions.maxFileSize && mFileSize && mFileSize + mBuffer.size() > mOptions.maxFileSize) rotate();
+  if (mOut.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()))) {
+    mFileSize += mBuffer.size();
+  } else {
+    mOut.clear();
+    mNumFailedWrites.fetch_add(1, std::memory_order_relaxed);
+  }
+  mBuffer.clear();
+}
+
+void logging::FileSink::open(bool truncate) {
+  // unbuffered, so every flush is one write straight from mBuffer
+  mOut.rdbuf()->pubsetbuf(nullptr, 0);
+  mOut.open(mPath, std::ios::binary | (truncate ? std::ios::trunc : std::ios::app));
+  if (!mOut) throw std::runtime_error(std::format("Could not open log file '{}'", mPath.string()));
+  auto ec = std::error_code{};
+  auto const size = std::filesystem::file_size(mPath, ec);
+  mFileSize = ec ? 0 : static_cast<size_t>(size);
+}
+
+void logging::FileSink::rotate() {
+  mOut.close();
+  auto const numbered = [this](int i) {
+    auto path = mPath;
+    path += std::format(".{}", i);
+    return path;
+  };
+  auto ec = std::error_code{};
+  std::filesystem::remove(numbered(mOptions.maxFiles), ec);
+  for (int i = mOptions.maxFiles - 1; i >= 1; --i) {
+    std::filesystem::rename(numbered(i), numbered(i + 1), ec);
+  }
+  std::filesystem::rename(mPath, numbered(1), ec);
+  // appends rather than losing the file if it couldn't be renamed
+  open(false);
+}
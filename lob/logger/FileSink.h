@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "Logger.h"
+
+namespace logging {
+
+struct FileSinkOptions {
+  // buffered text is written once it reaches bufferSize, or once the oldest of it is flushInterval old
+  size_t bufferSize = 1 << 20;
+  std::chrono::milliseconds flushInterval = std::chrono::milliseconds(100);
+
+  // When a write would take the file past maxFileSize it is renamed to <path>.1, older ones shifted
+  // up to <path>.<maxFiles>, and a new file is started. 0 never rotates.
+  size_t maxFileSize = 0;
+  int maxFiles = 5;
+
+  // an existing file is truncated on start, unless appending to it
+  bool append = false;
+};
+
+// Formats messages into one large buffer and writes it to the file with a single unbuffered write
+// per flush, instead of a write and flush per line.
+class FileSink : public Sink {
+ public:
+  explicit FileSink(std::filesystem::path path, FileSinkOptions options = {});
+  ~FileSink() override;
+
+  FileSink(FileSink const&) = delete;
+  FileSink& operator=(FileSink const&) = delete;
+
+  void write(LogMessage const& msg) override;
+  void endBatch() override;
+
+  // writes out the buffer regardless of the thresholds
+  void flush();
+
+  // Flushes whose write failed, e.g. on a full disk. Their text is dropped and the next flush
+  // tries again, as throwing would end the logger thread.
+  [[nodiscard]] uint64_t numFailedWrites() const noexcept {
+    return mNumFailedWrites.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void open(bool truncate);
+  void rotate();
+
+  std::filesystem::path mPath;
+  FileSinkOptions mOptions;
+  std::ofstream mOut;
+  std::string mBuffer;
+  size_t mFileSize = 0;
+  std::chrono::steady_clock::time_point mOldestBuffered = {};
+  std::atomic<uint64_t> mNumFailedWrites = 0;
+};
+
+}  // namespace logging
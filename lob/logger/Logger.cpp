@@ -1,6 +1,6 @@
 #include "Logger.h"
 
-#include <bit>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -10,81 +10,108 @@
 
 namespace {
 
-constexpr uint64_t next_pow2(uint64_t x) noexcept {
-  return x == 1 ? 1 : 1 << (64 - std::countl_zero(x - 1));
-}
+constexpr size_t MaxBatchSize = 4096;
+
+void loggerLoop(logging::Queue& queue, logging::Sink& sink, std::stop_token stopToken, std::chrono::milliseconds maxIdleSleep) {
+  auto const drain = [&] {
+    size_t numMessages = 0;
+    while (numMessages != MaxBatchSize) {
+      auto msg = queue.pop();
+      if (!msg) break;
+      sink.write(*msg);
+      ++numMessages;
+    }
+    if (numMessages) sink.endBatch();
+    return numMessages;
+  };
 
-void loggerLoop(auto& queue, std::stop_token stopToken, std::function<void(logging::LogMessage const&)> const& logMessageHandler, auto sleepDuration) {
+  // spin, then yield, then sleep for doubling periods up to maxIdleSleep
+  auto idleSleep = std::chrono::microseconds(0);
+  size_t numIdle = 0;
   while (!stopToken.stop_requested()) {
-    if (auto msg = queue.pop()) {
-      // std::println("Got message!");
-      logMessageHandler(*msg);
-    } else {
-      // std::println("Got no message...");
-      std::this_thread::sleep_for(sleepDuration);
+    if (drain()) {
+      numIdle = 0;
+      idleSleep = std::chrono::microseconds(0);
+      continue;
     }
+    ++numIdle;
+    if (numIdle < 64) continue;
+    if (numIdle < 128) {
+      std::this_thread::yield();
+      continue;
+    }
+    sink.endBatch();
+    idleSleep = std::min<std::chrono::microseconds>(std::max<std::chrono::microseconds>(idleSleep * 2, std::chrono::microseconds(10)), maxIdleSleep);
+    std::this_thread::sleep_for(idleSleep);
+  }
+
+  // what was logged before the stop is still written
+  while (drain()) {
   }
-  // std::println("Stop requested, all done!");
+  sink.endBatch();
 }
 
-auto toString(std::chrono::system_clock::time_point tp) {
+class HandlerSink : public logging::Sink {
+ public:
+  explicit HandlerSink(std::function<void(logging::LogMessage const&)> handler) : mHandler(std::move(handler)) {}
+
+  void write(logging::LogMessage const& msg) override {
+    mHandler(msg);
+  }
+
+ private:
+  std::function<void(logging::LogMessage const&)> mHandler;
+};
+
+auto timeToString(std::chrono::system_clock::time_point tp) {
     auto tt = std::chrono::system_clock::to_time_t(tp);
     auto s = std::string(std::ctime(&tt));
     s.pop_back();
     return s;
 }
 
-auto messageToString(logging::LogMessage const& msg) {
-  return std::format("{}: {}", toString(msg.timestamp), msg.msg);
-}
-
 }  // namespace
 
+std::string logging::toString(LogMessage const& msg) {
+  return std::format("{}: {}", timeToString(msg.timestamp), msg.msg);
+}
+
 logging::handlers::HandlerT logging::handlers::createCoutHandler() noexcept {
-  return [](logging::LogMessage const& msg) { std::cout << messageToString(msg) << std::endl; };
+  return [](logging::LogMessage const& msg) { std::cout << toString(msg) << std::endl; };
 }
 
 logging::handlers::HandlerT logging::handlers::createFileHandler(std::ofstream& out) {
-  return [&out](logging::LogMessage const& msg) { out << messageToString(msg) << std::endl; };
+  return [&out](logging::LogMessage const& msg) { out << toString(msg) << std::endl; };
 }
 
-logging::Queue::Queue(size_t size) : mSize(next_pow2(size)), mMessages(mSize) {}
+logging::Queue::Queue(size_t size, FullPolicy policy) : mRecords(size, policy) {}
 
 void logging::Queue::push(std::string msg) noexcept {
-  auto const writeIdx = mask(mNextWrite++);
-  auto& [done, slot] = mMessages[writeIdx];
-  if (slot.overflow = done) {
-    done = false;
-    // std::format("Buffer overflow! writeIdx: {}, mNextWrite: {}, mNextRead: {}, size: {}", writeIdx, mNextWrite.load(), mNextRead, mSize);
-  }
-  slot.timestamp = std::chrono::system_clock::now();
-  slot.msg = std::move(msg);
-  done = true;
+  push([&msg](LogRecord& record) {
+    record.format = nullptr;
+    record.msg = std::move(msg);
+  });
 }
 
 std::optional<logging::LogMessage> logging::Queue::pop() noexcept {
-  if (mNextRead == mNextWrite) return {};
-  auto const numMissed = static_cast<int>(mNextWrite) - static_cast<int>(mNextRead) - static_cast<int>(mSize);
-  if (numMissed > 0) {
-    mNextRead += numMissed;
-    return LogMessage{std::chrono::system_clock::now(), std::format("Missed {} message{}", numMissed, numMissed == 1 ? "" : "s"), false};
+  if (auto const numDropped = mRecords.numDropped(); numDropped != mNumReported) {
+    auto const numMissed = numDropped - mNumReported;
+    mNumReported = numDropped;
+    return LogMessage{std::chrono::system_clock::now(), std::format("Missed {} message{}", numMissed, numMissed == 1 ? "" : "s"), true};
   }
-  auto readIdx = mask(mNextRead);
-  auto& [done, msg] = mMessages[readIdx];
-  if (!done) return {};
-  done = false;
-  ++mNextRead;
-  return msg;
-}
 
-size_t constexpr logging::Queue::mask(size_t idx) const noexcept {
-  return idx & (mSize - 1);
+  // deferred messages are formatted here, on the handler thread
+  auto msg = std::optional<LogMessage>{};
+  static_cast<void>(mRecords.pop([&msg](LogRecord const& record) { msg = record.toMessage(); }));
+  return msg;
 }
 
 logging::Logger::Logger() : Logger(1024, handlers::createCoutHandler(), 1ms) {}
 
-logging::Logger::Logger(size_t queueSize, std::function<void(LogMessage const&)> messageHandler, std::chrono::milliseconds sleepDuration)
-    : mQueue(queueSize),
-      mHandler([this,
-                messageHandler = std::move(messageHandler),
-                sleepDuration](std::stop_token stopToken) { loggerLoop(mQueue, stopToken, messageHandler, sleepDuration); }) {}
+logging::Logger::Logger(size_t queueSize, std::function<void(LogMessage const&)> messageHandler, std::chrono::milliseconds sleepDuration, FullPolicy policy)
+    : Logger(queueSize, std::make_unique<HandlerSink>(std::move(messageHandler)), sleepDuration, policy) {}
+
+logging::Logger::Logger(size_t queueSize, std::unique_ptr<Sink> sink, std::chrono::milliseconds maxIdleSleep, FullPolicy policy)
+    : mQueue(queueSize, policy),
+      mSink(std::move(sink)),
+      mHandler([this, maxIdleSleep](std::stop_token stopToken) { loggerLoop(mQueue, *mSink, stopToken, maxIdleSleep); }) {}
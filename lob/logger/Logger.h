@@ -1,12 +1,25 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <format>
 #include <functional>
+#include <memory>
+#include <new>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <fstream>
 
+#include "MpscQueue.h"
+
 namespace logging {
 
 struct LogMessage {
@@ -15,26 +28,111 @@ struct LogMessage {
   bool overflow = false;
 };
 
+// "<local time>: <message>", as written by the handlers
+[[nodiscard]] std::string toString(LogMessage const& msg);
+
+// Receives the messages on the logger thread. The thread drains the queue in batches: write is
+// called for every message of a batch and endBatch after it, so a sink can buffer in between and
+// write once per batch. endBatch is also called now and then while the queue is idle.
+class Sink {
+ public:
+  virtual ~Sink() = default;
+  virtual void write(LogMessage const& msg) = 0;
+  virtual void endBatch() {}
+};
+
 namespace handlers {
 using HandlerT = std::function<void(logging::LogMessage const& msg)>;
 HandlerT createCoutHandler() noexcept;
 HandlerT createFileHandler(std::ofstream& out);
 }  // namespace handlers
 
+namespace detail {
+
+inline constexpr size_t MaxArgsSize = 64;
+
+template <class T>
+inline constexpr bool isView = false;
+template <class CharT, class Traits>
+inline constexpr bool isView<std::basic_string_view<CharT, Traits>> = true;
+template <class T, size_t N>
+inline constexpr bool isView<std::span<T, N>> = true;
+
+// Values that can be copied as raw bytes and formatted later on another thread. Pointers and views
+// are excluded: what they point to may be gone by then.
+template <class T>
+concept Deferrable = std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !std::is_array_v<T> && !isView<T>;
+
+template <class... Args>
+[[nodiscard]] consteval auto argOffsets() {
+  auto offsets = std::array<size_t, sizeof...(Args) + 1>{};
+  size_t offset = 0;
+  size_t i = 0;
+  ((offset = (offset + alignof(Args) - 1) / alignof(Args) * alignof(Args), offsets[i++] = offset, offset += sizeof(Args)), ...);
+  offsets[i] = offset;
+  return offsets;
+}
+
+template <class... Args>
+inline constexpr bool fitsRecord = (Deferrable<Args> && ...) && argOffsets<Args...>().back() <= MaxArgsSize && ((alignof(Args) <= alignof(std::max_align_t)) && ...);
+
+// The producer memcpy'd the arguments into place, which for trivially copyable types creates them.
+template <class... Args, size_t... Is>
+std::string formatArgs(std::string_view fmt, std::byte const* bytes, std::index_sequence<Is...>) {
+  constexpr auto offsets = argOffsets<Args...>();
+  return std::vformat(fmt, std::make_format_args(*std::launder(reinterpret_cast<Args const*>(bytes + offsets[Is]))...));
+}
+
+template <class... Args>
+std::string formatArgs(std::string_view fmt, std::byte const* bytes) {
+  return formatArgs<Args...>(fmt, bytes, std::index_sequence_for<Args...>{});
+}
+
+}  // namespace detail
+
+// Queue entry. Either a message formatted by the producer, or a format string with the raw bytes
+// of its arguments and the function that formats them, run on the handler thread.
+struct LogRecord {
+  using FormatFn = std::string (*)(std::string_view fmt, std::byte const* args);
+
+  std::chrono::system_clock::time_point timestamp = {};
+  FormatFn format = nullptr;
+  std::string_view fmt = {};
+  alignas(std::max_align_t) std::array<std::byte, detail::MaxArgsSize> args = {};
+  std::string msg = {};
+
+  [[nodiscard]] LogMessage toMessage() const {
+    return {timestamp, format ? format(fmt, args.data()) : msg, false};
+  }
+};
+
+// Log records from any number of threads to the handler thread.
 class Queue {
  public:
-  explicit Queue(size_t size);
+  explicit Queue(size_t size, FullPolicy policy = FullPolicy::OverwriteOldest);
+
+  // fill writes the record in place, so nothing is allocated unless it does
+  template <class Fill>
+  void push(Fill const& fill) noexcept {
+    mRecords.push([&fill](LogRecord& record) {
+      record.timestamp = std::chrono::system_clock::now();
+      fill(record);
+    });
+  }
 
   void push(std::string msg) noexcept;
+
+  // Single consumer. Reports drops since the last call as a message of its own, with overflow set.
   [[nodiscard]] std::optional<LogMessage> pop() noexcept;
 
- private:
-  [[nodiscard]] size_t constexpr mask(size_t idx) const noexcept;
+  // messages dropped because the queue was full
+  [[nodiscard]] uint64_t numDropped() const noexcept {
+    return mRecords.numDropped();
+  }
 
-  size_t mSize;
-  std::vector<std::pair<std::atomic<bool>, LogMessage>> mMessages;
-  size_t mNextRead = 0;                // single consumer
-  std::atomic<size_t> mNextWrite = 0;  // multiple producers
+ private:
+  MpscQueue<LogRecord> mRecords;
+  uint64_t mNumReported = 0;
 };
 
 using namespace std::chrono_literals;
@@ -42,20 +140,48 @@ using namespace std::chrono_literals;
 class Logger {
  public:
   Logger();
-  Logger(size_t queueSize, std::function<void(LogMessage const&)> messageHandler, std::chrono::milliseconds sleepDuration);
+  Logger(size_t queueSize, std::function<void(LogMessage const&)> messageHandler, std::chrono::milliseconds sleepDuration, FullPolicy policy = FullPolicy::OverwriteOldest);
+
+  // When the queue is empty the logger thread spins, then yields, then sleeps for increasing
+  // periods of at most maxIdleSleep, so a burst after a quiet period is picked up quickly.
+  Logger(size_t queueSize, std::unique_ptr<Sink> sink, std::chrono::milliseconds maxIdleSleep, FullPolicy policy = FullPolicy::OverwriteOldest);
 
   Logger(Logger&) = delete;
   Logger(Logger&&) = delete;
   Logger& operator=(Logger&) = delete;
   Logger& operator=(Logger&&) = delete;
 
+  // When all arguments are plain values (numbers, enums, other trivially copyable types) only the
+  // format string and their bytes are copied into the queue and the handler thread formats them:
+  // no allocation and no formatting on the caller. Anything else is formatted here.
   template <class... Args>
   void log(std::format_string<Args...> fmt, Args&&... args) {
+    if constexpr (detail::fitsRecord<std::remove_cvref_t<Args>...>) {
+      mQueue.push([&](LogRecord& record) {
+        constexpr auto offsets = detail::argOffsets<std::remove_cvref_t<Args>...>();
+        size_t i = 0;
+        ((std::memcpy(record.args.data() + offsets[i++], &args, sizeof(args))), ...);
+        record.fmt = fmt.get();
+        record.format = &detail::formatArgs<std::remove_cvref_t<Args>...>;
+      });
+    } else {
+      logFormatted(fmt, std::forward<Args>(args)...);
+    }
+  }
+
+  // Formats on the calling thread.
+  template <class... Args>
+  void logFormatted(std::format_string<Args...> fmt, Args&&... args) {
     mQueue.push(std::format(fmt, std::forward<Args>(args)...));
   }
 
+  [[nodiscard]] uint64_t numDropped() const noexcept {
+    return mQueue.numDropped();
+  }
+
  private:
   Queue mQueue;
+  std::unique_ptr<Sink> mSink;
   std::jthread mHandler;
 };
 
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace logging {
+
+// What push does when the queue is full.
+enum class FullPolicy : uint8_t {
+  DropNewest,       // the pushed value is discarded and counted, the producer never waits
+  OverwriteOldest,  // the oldest value is discarded and counted to make room
+  Block             // the producer spins until the consumer frees a slot
+};
+
+// Bounded multi-producer queue with a sequence number per slot (Vyukov). A producer claims a
+// position with a CAS only when the slot's sequence says it is free, writes the value in place and
+// publishes it by storing the next sequence with release semantics; the consumer reads a slot only
+// once its sequence says it was published. So a value is never read while being written and a
+// slot is never written while being read, whatever the number of producers. Slots are cache line
+// aligned so producers writing neighbouring slots do not share a line.
+//
+// The consumer side also claims with a CAS, as OverwriteOldest producers free the oldest value the
+// same way the consumer does; with the other policies it is never contended.
+template <class T>
+class MpscQueue {
+ public:
+  explicit MpscQueue(size_t capacity, FullPolicy policy = FullPolicy::DropNewest)
+      : mCapacity(std::bit_ceil(std::max<size_t>(capacity, 2))), mPolicy(policy), mSlots(std::make_unique<Slot[]>(mCapacity)) {
+    for (size_t i = 0; i != mCapacity; ++i) {
+      mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(MpscQueue const&) = delete;
+  MpscQueue& operator=(MpscQueue const&) = delete;
+
+  // fill(T&) writes the value in place. Returns false if the value was dropped (DropNewest only).
+  template <class Fill>
+  bool push(Fill const& fill) noexcept {
+    auto pos = mEnqueuePos.load(std::memory_order_relaxed);
+    int numWaits = 0;
+    while (true) {
+      auto& slot = mSlots[pos & (mCapacity - 1)];
+      auto const sequence = slot.sequence.load(std::memory_order_acquire);
+      auto const diff = static_cast<int64_t>(sequence - pos);
+      if (diff == 0) {
+        if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          fill(slot.value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // full: the slot still holds the value pushed one lap ago
+        switch (mPolicy) {
+          case FullPolicy::DropNewest:
+            mNumDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+          case FullPolicy::OverwriteOldest:
+            if (discard(pos - mCapacity)) mNumDropped.fetch_add(1, std::memory_order_relaxed);
+            else wait(numWaits);
+            break;
+          case FullPolicy::Block:
+            wait(numWaits);
+            break;
+        }
+        pos = mEnqueuePos.load(std::memory_order_relaxed);
+      } else {
+        // another producer claimed pos first
+        pos = mEnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Single consumer. read(T&) is called on the oldest value in place. Returns false if empty.
+  template <class Read>
+  bool pop(Read const& read) {
+    auto pos = mDequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      auto& slot = mSlots[pos & (mCapacity - 1)];
+      auto const sequence = slot.sequence.load(std::memory_order_acquire);
+      auto const diff = static_cast<int64_t>(sequence - (pos + 1));
+      if (diff < 0) return false;
+      if (diff == 0 && mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        read(slot.value);
+        slot.sequence.store(pos + mCapacity, std::memory_order_release);
+        return true;
+      }
+      if (diff > 0) pos = mDequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  // values discarded because the queue was full
+  [[nodiscard]] uint64_t numDropped() const noexcept {
+    return mNumDropped.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t capacity() const noexcept {
+    return mCapacity;
+  }
+
+  [[nodiscard]] FullPolicy policy() const noexcept {
+    return mPolicy;
+  }
+
+ private:
+  static constexpr size_t CacheLineSize = 64;
+
+  struct alignas(CacheLineSize) Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // Yields at first, then sleeps, so waiting producers leave the core to the consumer when they
+  // outnumber the cores.
+  static void wait(int& numWaits) noexcept {
+    if (++numWaits < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+
+  // Frees the value at pos like the consumer would, without reading it, if it is the oldest. False
+  // if the consumer or another producer claimed it first; it may still be being read then.
+  bool discard(size_t pos) noexcept {
+    auto& slot = mSlots[pos & (mCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+    if (!mDequeuePos.compare_exchange_strong(pos, pos + 1, std::memory_order_relaxed)) return false;
+    slot.sequence.store(pos + mCapacity, std::memory_order_release);
+    return true;
+  }
+
+  size_t const mCapacity;
+  FullPolicy const mPolicy;
+  std::unique_ptr<Slot[]> mSlots;
+  alignas(CacheLineSize) std::atomic<size_t> mEnqueuePos = 0;
+  alignas(CacheLineSize) std::atomic<size_t> mDequeuePos = 0;
+  alignas(CacheLineSize) std::atomic<uint64_t> mNumDropped = 0;
+};
+
+}  // namespace logging
@@ -0,0 +1,252 @@
+#include "ItchGenerator.h"
+
+#include <md/itch/ItchWriter.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+
+using namespace md::itch::messages;
+using md::itch::types::BUY_SELL;
+
+// splitmix64: tiny and fast, and unlike the std distributions gives the same sequence everywhere.
+class Rng {
+ public:
+  explicit Rng(uint64_t seed) : mState(seed) {}
+
+  uint64_t next() noexcept {
+    auto z = (mState += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  // [0, n)
+  uint64_t uniform(uint64_t n) noexcept {
+    return next() % n;
+  }
+
+  bool chance(double p) noexcept {
+    return static_cast<double>(next() >> 11) * 0x1.0p-53 < p;
+  }
+
+ private:
+  uint64_t mState;
+};
+
+// Live orders of one symbol. Orders are kept in a vector for uniform picks and indexed by price
+// level per side for executions at the touch; both are updated with swap-and-pop.
+class SymbolBook {
+ public:
+  struct Order {
+    oid_t oid;
+    uint32_t qty;
+    uint32_t price;
+    BUY_SELL buy;
+    uint32_t levelPos;
+  };
+
+  SymbolBook(uint16_t locate, uint32_t mid) : mLocate(locate), mMid(mid) {}
+
+  [[nodiscard]] uint16_t locate() const noexcept { return mLocate; }
+  [[nodiscard]] uint32_t mid() const noexcept { return mMid; }
+  void setMid(uint32_t mid) noexcept { mMid = mid; }
+
+  [[nodiscard]] size_t size() const noexcept { return mOrders.size(); }
+  [[nodiscard]] Order& order(size_t slot) noexcept { return mOrders[slot]; }
+
+  void add(oid_t oid, uint32_t qty, uint32_t price, BUY_SELL buy) {
+    auto& level = side(buy)[price];
+    mOrders.push_back({oid, qty, price, buy, static_cast<uint32_t>(level.size())});
+    level.push_back(static_cast<uint32_t>(mOrders.size() - 1));
+  }
+
+  void remove(size_t slot) {
+    auto const& order = mOrders[slot];
+    auto& levels = side(order.buy);
+    auto const levelIt = levels.find(order.price);
+    auto& level = levelIt->second;
+    mOrders[level.back()].levelPos = order.levelPos;
+    level[order.levelPos] = level.back();
+    level.pop_back();
+    if (level.empty()) levels.erase(levelIt);
+
+    if (slot != mOrders.size() - 1) {
+      auto const& moved = mOrders.back();
+      side(moved.buy)[moved.price][moved.levelPos] = static_cast<uint32_t>(slot);
+      mOrders[slot] = moved;
+    }
+    mOrders.pop_back();
+  }
+
+  // Slot of an order at the best price of the side, if the side has orders.
+  [[nodiscard]] std::optional<size_t> best(BUY_SELL buy) const {
+    if (buy == BUY_SELL::BUY) {
+      if (mBids.empty()) return {};
+      return mBids.rbegin()->second.front();
+    }
+    if (mAsks.empty()) return {};
+    return mAsks.begin()->second.front();
+  }
+
+ private:
+  std::map<uint32_t, std::vector<uint32_t>>& side(BUY_SELL buy) noexcept {
+    return buy == BUY_SELL::BUY ? mBids : mAsks;
+  }
+
+  uint16_t mLocate;
+  uint32_t mMid;
+  std::vector<Order> mOrders;
+  std::map<uint32_t, std::vector<uint32_t>> mBids;
+  std::map<uint32_t, std::vector<uint32_t>> mAsks;
+};
+
+void validate(md::ItchGeneratorConfig const& config) {
+  auto const numSymbols = config.symbols.empty() ? config.numSymbols : static_cast<int>(config.symbols.size());
+  if (numSymbols < 1 || numSymbols > 65534) throw std::runtime_error("ItchGenerator: need between 1 and 65534 symbols");
+  if (config.messagesPerSecond <= 0) throw std::runtime_error("ItchGenerator: message rate must be positive");
+  if (config.tickSize == 0 || config.numLevels < 1) throw std::runtime_error("ItchGenerator: need a tick size and at least one level");
+  if (config.startPrice <= static_cast<uint64_t>(config.tickSize) * (config.numLevels + 1)) throw std::runtime_error("ItchGenerator: start price too close to zero");
+  if (config.minOrderQty == 0 || config.minOrderQty > config.maxOrderQty) throw std::runtime_error("ItchGenerator: invalid order quantities");
+  if (config.cancelRatio < 0 || config.cancelRatio > 1) throw std::runtime_error("ItchGenerator: cancel ratio must be in [0, 1]");
+}
+
+}  // namespace
+
+md::ItchGeneratorStats md::generateItch(std::ostream& out, ItchGeneratorConfig const& config) {
+  validate(config);
+
+  auto writer = md::itch::ItchWriter(out);
+  auto rng = Rng(config.seed);
+  auto stats = ItchGeneratorStats{};
+
+  auto timestamp = std::chrono::nanoseconds(std::chrono::hours(3));
+  auto const sysEvent = [&](char code) { writer.write(itch_message<MessageType::SYSEVENT>(timestamp_t(timestamp), code)); };
+
+  auto books = std::vector<SymbolBook>();
+  auto const numSymbols = config.symbols.empty() ? config.numSymbols : static_cast<int>(config.symbols.size());
+  sysEvent('O');
+  for (int i = 0; i != numSymbols; ++i) {
+    auto const locate = static_cast<uint16_t>(i + 1);
+    auto const name = config.symbols.empty() ? std::format("SYM{:04}", i) : config.symbols[i];
+    writer.write(itch_message<MessageType::STOCK_DIRECTORY>(locate, timestamp_t(timestamp), 'Q', name));
+    books.emplace_back(locate, config.startPrice);
+  }
+  timestamp = std::chrono::hours(4);
+  sysEvent('S');
+  timestamp = std::chrono::hours(9) + std::chrono::minutes(30);
+  sysEvent('Q');
+
+  // Half of the messages remove an order, so an order rests for size / (symbol rate / 2) on
+  // average. Keeping every book near this size gives the configured lifetime.
+  auto const symbolRate = config.messagesPerSecond / numSymbols;
+  auto const targetSize = std::max<size_t>(1, static_cast<size_t>(std::chrono::duration<double>(config.meanOrderLifetime).count() * symbolRate / 2));
+  auto const meanGap = std::max<uint64_t>(1, static_cast<uint64_t>(1e9 / config.messagesPerSecond));
+  auto const minMid = config.tickSize * static_cast<uint32_t>(config.numLevels + 1);
+  uint64_t nextOid = 1;
+
+  auto const done = [&] { return stats.numMessages >= config.numMessages; };
+
+  auto const newQty = [&] {
+    return config.minOrderQty + static_cast<uint32_t>(rng.uniform(config.maxOrderQty - config.minOrderQty + 1));
+  };
+
+  // skewed towards the touch
+  auto const newPrice = [&](SymbolBook const& book, BUY_SELL buy) {
+    auto const u = static_cast<double>(rng.next() >> 11) * 0x1.0p-53;
+    auto const distance = config.tickSize * (1 + static_cast<uint32_t>(u * u * config.numLevels));
+    return buy == BUY_SELL::BUY ? book.mid() - distance : book.mid() + distance;
+  };
+
+  auto const execute = [&](SymbolBook& book, size_t slot, uint32_t qty) {
+    auto& order = book.order(slot);
+    writer.write(itch_message<MessageType::EXECUTE_ORDER>(order.oid, timestamp_t(timestamp), qty_t(qty), book.locate()));
+    ++stats.numExecutes;
+    ++stats.numMessages;
+    if (qty == order.qty) book.remove(slot);
+    else order.qty -= qty;
+  };
+
+  while (!done()) {
+    timestamp += std::chrono::nanoseconds(1 + rng.uniform(2 * meanGap - 1));
+    auto const ts = timestamp_t(timestamp);
+    auto& book = books[rng.uniform(books.size())];
+
+    if (rng.chance(config.priceMoveProbability)) {
+      // the mid moves by a tick and orders on the far side of it are executed
+      auto const up = rng.uniform(2) == 0 || book.mid() - config.tickSize < minMid;
+      book.setMid(up ? book.mid() + config.tickSize : book.mid() - config.tickSize);
+      auto const side = up ? BUY_SELL::SELL : BUY_SELL::BUY;
+      while (!done()) {
+        auto const slot = book.best(side);
+        if (!slot) break;
+        auto const price = book.order(*slot).price;
+        if (up ? price > book.mid() : price < book.mid()) break;
+        execute(book, *slot, book.order(*slot).qty);
+      }
+      continue;
+    }
+
+    if (book.size() == 0 || rng.chance(book.size() < targetSize ? 0.6 : 0.4)) {
+      auto const buy = rng.uniform(2) == 0 ? BUY_SELL::BUY : BUY_SELL::SELL;
+      auto const oid = oid_t(nextOid++);
+      auto const qty = newQty();
+      auto const price = newPrice(book, buy);
+      writer.write(itch_message<MessageType::ADD_ORDER>(ts, oid, price_t(price), qty_t(qty), book.locate(), buy));
+      book.add(oid, qty, price, buy);
+      ++stats.numAdds;
+      ++stats.numMessages;
+      continue;
+    }
+
+    if (!rng.chance(config.cancelRatio)) {
+      auto const slot = book.best(rng.uniform(2) == 0 ? BUY_SELL::BUY : BUY_SELL::SELL).value_or(rng.uniform(book.size()));
+      auto const qty = book.order(slot).qty;
+      execute(book, slot, rng.uniform(2) == 0 ? qty : 1 + static_cast<uint32_t>(rng.uniform(qty)));
+      continue;
+    }
+
+    auto const slot = rng.uniform(book.size());
+    auto& order = book.order(slot);
+    auto const kind = rng.uniform(100);
+    if (kind < 15 && order.qty > 1) {
+      auto const qty = 1 + static_cast<uint32_t>(rng.uniform(order.qty - 1));
+      writer.write(itch_message<MessageType::REDUCE_ORDER>(order.oid, ts, qty_t(qty), book.locate()));
+      order.qty -= qty;
+      ++stats.numReduces;
+    } else if (kind < 30) {
+      auto const buy = order.buy;
+      auto const newOid = oid_t(nextOid++);
+      auto const qty = newQty();
+      auto const price = newPrice(book, buy);
+      writer.write(itch_message<MessageType::REPLACE_ORDER>(ts, order.oid, newOid, qty_t(qty), price_t(price), book.locate()));
+      book.remove(slot);
+      book.add(newOid, qty, price, buy);
+      ++stats.numReplaces;
+    } else {
+      writer.write(itch_message<MessageType::DELETE_ORDER>(order.oid, ts, book.locate()));
+      book.remove(slot);
+      ++stats.numDeletes;
+    }
+    ++stats.numMessages;
+  }
+
+  stats.lastTimestamp = timestamp;
+  sysEvent('M');
+  sysEvent('E');
+  sysEvent('C');
+  writer.flush();
+  stats.numBytes = writer.numBytes();
+  return stats;
+}
+
+md::ItchGeneratorStats md::generateItchFile(std::string const& filename, ItchGeneratorConfig const& config) {
+  auto out = std::ofstream(filename, std::ios::binary);
+  if (!out) throw std::runtime_error(std::format("Could not open {}", filename));
+  return generateItch(out, config);
+}
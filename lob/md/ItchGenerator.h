@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace md {
+
+// Synthetic order flow for one trading day. Every symbol has a mid price doing a random walk in
+// ticks; orders rest within numLevels ticks of the mid and are executed when the mid moves
+// through them. Prices are in ITCH units (1/10000 dollar).
+struct ItchGeneratorConfig {
+  uint64_t seed = 42;
+
+  // symbols are named SYM0000, SYM0001, ... unless names are given
+  int numSymbols = 8;
+  std::vector<std::string> symbols = {};
+
+  // number of order messages (add, execute, reduce, delete, replace), system events excluded
+  uint64_t numMessages = 10000000;
+  // mean rate over all symbols, starting at the market open
+  double messagesPerSecond = 1e6;
+
+  uint32_t startPrice = 1000000;
+  uint32_t tickSize = 100;
+  // chance per message on a symbol that its mid moves by a tick
+  double priceMoveProbability = 0.001;
+  int numLevels = 10;
+
+  // fraction of the removals that are cancels (delete, reduce, replace) rather than executions
+  double cancelRatio = 0.9;
+  // mean time an order rests before it is cancelled or executed
+  std::chrono::nanoseconds meanOrderLifetime = std::chrono::milliseconds(5);
+
+  uint32_t minOrderQty = 100;
+  uint32_t maxOrderQty = 500;
+};
+
+struct ItchGeneratorStats {
+  uint64_t numMessages = 0;
+  uint64_t numBytes = 0;
+  uint64_t numAdds = 0;
+  uint64_t numExecutes = 0;
+  uint64_t numReduces = 0;
+  uint64_t numDeletes = 0;
+  uint64_t numReplaces = 0;
+  std::chrono::nanoseconds lastTimestamp{0};
+};
+
+// Writes a complete day: system events, stock directory and config.numMessages order messages.
+// The output only depends on the config, so the same seed gives the same bytes on every platform.
+ItchGeneratorStats generateItch(std::ostream& out, ItchGeneratorConfig const& config);
+ItchGeneratorStats generateItchFile(std::string const& filename, ItchGeneratorConfig const& config);
+
+}  // namespace md
@@ -0,0 +1,108 @@
+#include "ItchReplay.h"
+
+#include <stdexcept>
+
+namespace {
+
+// Touches every page of the mapping so the replay thread doesn't stall on page faults
+// when it switches to this file.
+void prefault(md::MappedFile const& file, std::atomic<bool> const& cancel) noexcept {
+  constexpr size_t pageSize = 4096;
+  auto const* data = file.data();
+  auto const size = file.size();
+  char volatile sink = 0;
+  for (size_t offset = 0; offset < size && !cancel.load(std::memory_order_relaxed); offset += pageSize) {
+    sink = data[offset];
+  }
+  static_cast<void>(sink);
+}
+
+}  // namespace
+
+md::ItchReplay::ItchReplay(std::vector<std::string> filenames) : mFilenames(std::move(filenames)) {
+  if (mFilenames.empty()) throw std::runtime_error("ItchReplay: no files to replay");
+  mDay = std::make_unique<Day>(mFilenames.front());
+  remap(*mDay);
+  prefetch(1);
+}
+
+md::ItchReplay::~ItchReplay() {
+  cancelPrefetch();
+}
+
+bool md::ItchReplay::nextDay() {
+  if (mDayIndex + 1 >= mFilenames.size()) return false;
+
+  mDay = mNextDay.get();
+  ++mDayIndex;
+  remap(*mDay);
+  prefetch(mDayIndex + 1);
+  return true;
+}
+
+void md::ItchReplay::rewind() {
+  if (mDayIndex == 0) {
+    mDay->reader.reset(mDay->marketStart);
+    return;
+  }
+
+  cancelPrefetch();
+  mDayIndex = 0;
+  mDay = std::make_unique<Day>(mFilenames.front());
+  remap(*mDay);
+  prefetch(1);
+}
+
+uint16_t md::ItchReplay::byName(std::string const& name) const {
+  auto const it = mNameToGlobal.find(name);
+  if (it == mNameToGlobal.end()) throw std::runtime_error("Symbol not found");
+  return it->second;
+}
+
+std::string const& md::ItchReplay::byId(uint16_t id) const {
+  if (mGlobalToName[id].empty()) throw std::runtime_error("Id not found");
+  return mGlobalToName[id];
+}
+
+void md::ItchReplay::prefetch(size_t dayIndex) {
+  if (dayIndex >= mFilenames.size()) return;
+
+  mCancelPrefetch = false;
+  mNextDay = std::async(std::launch::async, [&filename = mFilenames[dayIndex], &cancel = mCancelPrefetch] {
+    auto day = std::make_unique<Day>(filename);
+    prefault(day->file, cancel);
+    return day;
+  });
+}
+
+void md::ItchReplay::cancelPrefetch() noexcept {
+  if (!mNextDay.valid()) return;
+  mCancelPrefetch = true;
+  mNextDay.wait();
+  mNextDay = {};
+}
+
+// Ids of symbols seen on an earlier day are kept. A new symbol gets its locate of the day it first
+// appears as id when that id is still free, so a single day replays with its original locates.
+// Locates themselves are only valid for their day: those of the previous one are forgotten.
+void md::ItchReplay::remap(Day const& day) {
+  mLocateToGlobal.fill(0);
+  for (auto const& [name, locate] : day.symbols) {
+    auto it = mNameToGlobal.find(name);
+    if (it == mNameToGlobal.end()) {
+      auto const id = mGlobalToName[locate].empty() ? static_cast<uint16_t>(locate) : nextFreeGlobalId();
+      mGlobalToName[id] = name;
+      it = mNameToGlobal.emplace(name, id).first;
+    }
+    mLocateToGlobal[locate] = it->second;
+  }
+}
+
+// 0 is never handed out, it stands for no symbol
+uint16_t md::ItchReplay::nextFreeGlobalId() {
+  while (!mGlobalToName[mNextFreeGlobalId].empty()) {
+    if (mNextFreeGlobalId == 1) throw std::runtime_error("ItchReplay: ran out of symbol ids");
+    --mNextFreeGlobalId;
+  }
+  return mNextFreeGlobalId;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <md/BinaryDataReader.h>
+#include <md/MappedFile.h>
+#include <md/Symbols.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace md {
+
+// Replays a sequence of ITCH files (one per trading day) as a single continuous stream.
+// Stock locates are assigned per day by NASDAQ, so every day is remapped onto stable ids through
+// its Symbols directory. The next file is mapped, paged in and has its directory parsed on a
+// background thread while the current day is being replayed.
+class ItchReplay {
+ public:
+  explicit ItchReplay(std::vector<std::string> filenames);
+  ~ItchReplay();
+
+  ItchReplay(ItchReplay const&) = delete;
+  ItchReplay(ItchReplay&&) = delete;
+  ItchReplay& operator=(ItchReplay const&) = delete;
+  ItchReplay& operator=(ItchReplay&&) = delete;
+
+  [[nodiscard]] BinaryDataReader& reader() noexcept { return mDay->reader; }
+  [[nodiscard]] size_t dayIndex() const noexcept { return mDayIndex; }
+  [[nodiscard]] size_t numDays() const noexcept { return mFilenames.size(); }
+
+  // ITCH timestamps are nanoseconds since midnight; every day is shifted by a whole day so that
+  // timestamps keep increasing across the run.
+  [[nodiscard]] std::chrono::nanoseconds dayOffset() const noexcept {
+    return std::chrono::days(mDayIndex);
+  }
+
+  // 0, which no symbol has, for a locate missing from the current day's directory
+  [[nodiscard]] uint16_t toGlobal(uint16_t locate) const noexcept {
+    return mLocateToGlobal[locate];
+  }
+
+  // Switches to the next day. Returns false when the last day has been replayed.
+  bool nextDay();
+
+  // Restarts the replay at the start of system hours of the first day. Ids stay stable.
+  void rewind();
+
+  [[nodiscard]] auto count() const noexcept {
+    return mNameToGlobal.size();
+  }
+
+  [[nodiscard]] uint16_t byName(std::string const& name) const;
+  [[nodiscard]] std::string const& byId(uint16_t id) const;
+
+ private:
+  struct Day {
+    explicit Day(std::string const& filename)
+        : file(filename), reader(file.data(), file.size()), symbols(reader), marketStart(reader.curr()) {}
+
+    MappedFile file;
+    BinaryDataReader reader;
+    utils::Symbols symbols;
+    size_t marketStart;
+  };
+
+  void prefetch(size_t dayIndex);
+  void cancelPrefetch() noexcept;
+  void remap(Day const& day);
+  [[nodiscard]] uint16_t nextFreeGlobalId();
+
+  std::vector<std::string> mFilenames;
+  std::unique_ptr<Day> mDay;
+  size_t mDayIndex = 0;
+
+  std::future<std::unique_ptr<Day>> mNextDay;
+  std::atomic<bool> mCancelPrefetch = false;
+
+  std::array<uint16_t, std::numeric_limits<uint16_t>::max() + 1> mLocateToGlobal = {};
+  std::vector<std::string> mGlobalToName = std::vector<std::string>(std::numeric_limits<uint16_t>::max() + 1);
+  std::unordered_map<std::string, uint16_t> mNameToGlobal = {};
+  uint16_t mNextFreeGlobalId = std::numeric_limits<uint16_t>::max();
+};
+
+}  // namespace md
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "BinaryDataReader.h"
-#include "md/itch/MessageReaders.h"
+#include "md/itch/Dispatch.h"
 #include <limits>
 #include <string>
 #include <vector>
@@ -12,26 +12,23 @@ namespace md::utils {
 class Symbols {
  public:
   explicit Symbols(md::BinaryDataReader& reader) {
+    using md::itch::messages::itch_message;
+    using md::itch::messages::MessageType;
+
     bool preTrading = true;
 
-    while (preTrading) {
-      auto const currentMessageType = md::itch::currentMessageType(reader);
-      switch (currentMessageType) {
-        case md::itch::messages::MessageType::SYSEVENT: {
-          auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::SYSEVENT>(reader);
+    auto visitor = md::itch::overloaded{
+        [&](itch_message<MessageType::SYSEVENT> const& msg) {
           if (msg.eventCode == 'S') preTrading = false;
-          break;
-        }
-        case md::itch::messages::MessageType::STOCK_DIRECTORY: {
-          auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::STOCK_DIRECTORY>(reader);
+        },
+        [&](itch_message<MessageType::STOCK_DIRECTORY> const& msg) {
           auto const name = boost::algorithm::trim_right_copy(msg.stock);
           mIdToName[msg.stock_locate] = name;
           mNameToId[name] = msg.stock_locate;
-          break;
-        }
-        default:
-          md::itch::skipCurrentMessage(reader);
-      }
+        }};
+
+    while (preTrading) {
+      md::itch::dispatch(reader, visitor);
     }
   }
 
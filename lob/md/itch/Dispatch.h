@@ -0,0 +1,72 @@
+#pragma once
+
+#include <md/BinaryDataReader.h>
+#include <md/itch/MessageReaders.h>
+#include <md/itch/messages.h>
+
+#include <array>
+#include <cassert>
+#include <type_traits>
+
+namespace md::itch {
+
+template <class... Ts>
+struct overloaded : Ts... {
+  using Ts::operator()...;
+};
+
+namespace detail {
+
+template <class Visitor, md::itch::types::MessageType messageType>
+void parseAndVisit(Visitor& visitor, char const* ptr) {
+  visitor(md::itch::messages::itch_message<messageType>::parse(ptr));
+}
+
+template <class Visitor>
+struct DispatchTable {
+  using HandlerT = void (*)(Visitor&, char const*);
+
+  struct Entry {
+    unsigned char netlen = 0;  // 0 for types unknown to netlen<>
+    HandlerT handler = nullptr;  // nullptr when the visitor has no overload for the type
+  };
+
+  template <md::itch::types::MessageType messageType>
+  static consteval HandlerT handlerFor() {
+    if constexpr (std::is_invocable_v<Visitor&, md::itch::messages::itch_message<messageType> const&>) {
+      return &parseAndVisit<Visitor, messageType>;
+    } else {
+      return nullptr;
+    }
+  }
+
+  template <md::itch::types::MessageType... messageTypes>
+  static consteval auto make(md::itch::messages::MessageTypeList<messageTypes...>) {
+    std::array<Entry, 256> entries = {};
+    ((entries[static_cast<unsigned char>(messageTypes)] = Entry{md::itch::messages::netlen<messageTypes>, handlerFor<messageTypes>()}), ...);
+    return entries;
+  }
+
+  static constexpr auto entries = make(md::itch::messages::KnownMessageTypes{});
+};
+
+}  // namespace detail
+
+// Reads the current message and passes it to visitor if visitor has an overload for its
+// itch_message<> type. Everything else is skipped using the table length, without parsing.
+// Returns whether the visitor was called.
+template <class Visitor>
+bool dispatch(md::BinaryDataReader& reader, Visitor& visitor) {
+  auto const& entry = detail::DispatchTable<Visitor>::entries[static_cast<unsigned char>(*reader.get(2))];
+  if (entry.netlen == 0) {
+    skipCurrentMessage(reader);
+    return false;
+  }
+
+  assert(md::itch::read_bytes::read_two(reader.get(0)) == entry.netlen);
+  if (entry.handler) entry.handler(visitor, reader.get(2));
+  reader.advance(2 + entry.netlen);
+  return entry.handler != nullptr;
+}
+
+}  // namespace md::itch
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <md/itch/messages.h>
+
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace md::itch {
+
+// Writes length-prefixed ITCH 5.0 frames through the itch_message<> layouts. Fields that the
+// message doesn't carry (tracking number, attribution, ...) are written as zeros. Frames are
+// collected in a buffer and written to the stream in blocks of bufferSize bytes.
+class ItchWriter {
+ public:
+  explicit ItchWriter(std::ostream& out, size_t bufferSize = 1 << 20) : mOut(out), mBuffer(std::max<size_t>(bufferSize, 2 + 255)) {}
+
+  ~ItchWriter() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  ItchWriter(ItchWriter const&) = delete;
+  ItchWriter& operator=(ItchWriter const&) = delete;
+
+  template <md::itch::types::MessageType messageType>
+  void write(md::itch::messages::itch_message<messageType> const& msg) {
+    constexpr size_t msglen = md::itch::messages::netlen<messageType>;
+    if (mBuffer.size() - mSize < 2 + msglen) flush();
+
+    auto* const ptr = mBuffer.data() + mSize;
+    md::itch::read_bytes::store_be<uint16_t>(ptr, msglen);
+    std::fill_n(ptr + 2, msglen, '\0');
+    ptr[2] = static_cast<char>(messageType);
+    msg.write(ptr + 2);
+
+    mSize += 2 + msglen;
+    ++mNumMessages;
+  }
+
+  void flush() {
+    if (mSize == 0) return;
+    if (!mOut.write(mBuffer.data(), static_cast<std::streamsize>(mSize))) throw std::runtime_error("ItchWriter: write failed");
+    mNumBytes += mSize;
+    mSize = 0;
+  }
+
+  [[nodiscard]] size_t numMessages() const noexcept { return mNumMessages; }
+  [[nodiscard]] size_t numBytes() const noexcept { return mNumBytes + mSize; }
+
+ private:
+  std::ostream& mOut;
+  std::vector<char> mBuffer;
+  size_t mSize = 0;
+  size_t mNumMessages = 0;
+  size_t mNumBytes = 0;
+};
+
+}  // namespace md::itch
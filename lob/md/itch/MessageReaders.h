@@ -12,7 +12,7 @@ namespace md::itch {
 
 template <md::itch::types::MessageType messageType>
 inline md::itch::messages::itch_message<messageType> readItchMessage(md::BinaryDataReader& buf) {
-  auto const msglen = be16toh(*(uint16_t*)buf.get(0));
+  auto const msglen = md::itch::read_bytes::read_two(buf.get(0));
   buf.advance(2);
   assert(msglen == md::itch::messages::netlen<messageType>);
 
@@ -30,7 +30,7 @@ inline auto currentMessageTimestamp(md::BinaryDataReader const& reader) {
 }
 
 inline void skipCurrentMessage(md::BinaryDataReader& reader) {
-  auto const msglen = be16toh(*(uint16_t*)reader.get(0));
+  auto const msglen = md::itch::read_bytes::read_two(reader.get(0));
   reader.advance(msglen + 2);
 }
 
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <md/BinaryDataReader.h>
+#include <md/itch/messages.h>
+
+#include <algorithm>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace md::itch {
+
+namespace detail {
+
+// Follows up to numMessages frames starting at offset. A frame is valid when its length prefix
+// matches netlen of its type byte and timestamps don't go backwards. Running exactly into the end
+// of the data also counts as valid.
+inline bool isValidFrameChain(char const* data, size_t len, size_t offset, size_t numMessages) noexcept {
+  uint64_t prevTimestamp = 0;
+  for (size_t i = 0; i != numMessages; ++i) {
+    if (offset == len) return true;
+    if (len - offset < 3) return false;
+    auto const msglen = md::itch::read_bytes::read_two(data + offset);
+    auto const type = static_cast<unsigned char>(data[offset + 2]);
+    if (msglen == 0 || msglen != md::itch::messages::netlenByType[type] || len - offset - 2 < msglen) return false;
+    auto const timestamp = static_cast<uint64_t>(md::itch::messages::read_timestamp(data + offset + 2 + 5).count());
+    if (timestamp < prevTimestamp) return false;
+    prevTimestamp = timestamp;
+    offset += 2 + msglen;
+  }
+  return true;
+}
+
+}  // namespace detail
+
+// Finds the first message boundary at or after offset without walking from the start of the file.
+// Candidates are accepted once a chain of consecutive frames validates against netlen<>.
+// The end of the data counts as a boundary.
+[[nodiscard]] inline std::optional<size_t> findMessageBoundary(char const* data, size_t len, size_t offset, size_t chainLength = 16) noexcept {
+  constexpr size_t maxMessageLength = 2 + 255;
+  auto const end = std::min(len, offset + chainLength * maxMessageLength);
+  for (auto candidate = offset; candidate <= end; ++candidate) {
+    if (detail::isValidFrameChain(data, len, candidate, chainLength)) return candidate;
+  }
+  return {};
+}
+
+// Splits the data into numChunks ranges that each start on a message boundary.
+// Returns the numChunks + 1 chunk offsets, starting at 0 and ending at len.
+[[nodiscard]] inline std::vector<size_t> splitIntoChunks(char const* data, size_t len, size_t numChunks) {
+  auto boundaries = std::vector<size_t>{0};
+  for (size_t i = 1; i < numChunks; ++i) {
+    auto const boundary = findMessageBoundary(data, len, std::max(boundaries.back(), len / numChunks * i));
+    if (!boundary) throw std::runtime_error("splitIntoChunks: could not resynchronize on a message boundary");
+    boundaries.push_back(*boundary);
+  }
+  boundaries.push_back(len);
+  return boundaries;
+}
+
+// Decodes the data on numChunks threads. decodeChunk is called with a reader over each chunk and
+// its results are returned in file order, so blocks of decoded events can be consumed in sequence.
+template <class F>
+[[nodiscard]] auto decodeParallel(char const* data, size_t len, size_t numChunks, F const& decodeChunk) {
+  using ResultT = std::invoke_result_t<F const&, md::BinaryDataReader&>;
+
+  auto const boundaries = splitIntoChunks(data, len, numChunks);
+
+  auto futures = std::vector<std::future<ResultT>>{};
+  for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+    futures.push_back(std::async(std::launch::async, [&decodeChunk, begin = data + boundaries[i], size = boundaries[i + 1] - boundaries[i]] {
+      auto reader = md::BinaryDataReader(begin, size);
+      return decodeChunk(reader);
+    }));
+  }
+
+  auto results = std::vector<ResultT>{};
+  results.reserve(futures.size());
+  for (auto& future : futures) {
+    results.push_back(future.get());
+  }
+  return results;
+}
+
+}  // namespace md::itch
@@ -40,6 +40,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "read_bytes.h"
 #include "types.h"
 
+#include <algorithm>
+#include <array>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
 namespace md::itch::messages {
 
 using namespace md::itch::types;
@@ -90,6 +96,30 @@ inline constexpr unsigned char netlen<MessageType::RETAIL_PRICE_IMPROVEMENT> = 2
 template <>
 inline constexpr unsigned char netlen<MessageType::PROCESS_LULD_AUCTION_COLLAR_MESSAGE> = 35;
 
+template <MessageType... messageTypes>
+struct MessageTypeList {};
+
+using KnownMessageTypes = MessageTypeList<
+    MessageType::SYSEVENT, MessageType::STOCK_DIRECTORY, MessageType::TRADING_ACTION, MessageType::REG_SHO_RESTRICT,
+    MessageType::MPID_POSITION, MessageType::MWCB_DECLINE, MessageType::MWCB_STATUS, MessageType::IPO_QUOTE_UPDATE,
+    MessageType::ADD_ORDER, MessageType::ADD_ORDER_MPID, MessageType::EXECUTE_ORDER, MessageType::EXECUTE_ORDER_WITH_PRICE,
+    MessageType::REDUCE_ORDER, MessageType::DELETE_ORDER, MessageType::REPLACE_ORDER, MessageType::TRADE,
+    MessageType::CROSS_TRADE, MessageType::BROKEN_TRADE, MessageType::NET_ORDER_IMBALANCE, MessageType::RETAIL_PRICE_IMPROVEMENT,
+    MessageType::PROCESS_LULD_AUCTION_COLLAR_MESSAGE>;
+
+template <MessageType... messageTypes>
+consteval auto makeNetlenTable(MessageTypeList<messageTypes...>) {
+  std::array<unsigned char, 256> table = {};
+  ((table[static_cast<unsigned char>(messageTypes)] = netlen<messageTypes>), ...);
+  return table;
+}
+
+// netlen by message type byte, 0 for unknown types
+inline constexpr auto netlenByType = makeNetlenTable(KnownMessageTypes{});
+
+static_assert(netlenByType['A'] == 36);
+static_assert(netlenByType['Z'] == 0);
+
 template <MessageType messageType>
 struct itch_message {
   static itch_message parse(char const *ptr) {
@@ -98,13 +128,95 @@ struct itch_message {
   }
 };
 
-static timestamp_t read_timestamp(char const *src) {
+inline timestamp_t read_timestamp(char const *src) {
   return timestamp_t(read_six(src));
 }
-static oid_t read_oid(char const *src) { return oid_t(read_eight(src)); }
-static price_t read_price(char const *src) { return price_t(read_four(src)); }
-static qty_t read_qty(char const *src) { return qty_t(read_four(src)); }
-static uint16_t read_locate(char const *src) { return read_two(src); }
+inline oid_t read_oid(char const *src) { return oid_t(read_eight(src)); }
+inline price_t read_price(char const *src) { return price_t(read_four(src)); }
+inline qty_t read_qty(char const *src) { return qty_t(read_four(src)); }
+inline uint16_t read_locate(char const *src) { return read_two(src); }
+
+template <class MemberPointer>
+struct MemberOf;
+
+template <class C, class T>
+struct MemberOf<T C::*> {
+  using type = std::remove_cv_t<T>;
+};
+
+// The message's Member, stored as Width big-endian bytes at Offset into the message (relative to
+// its type byte). Strings are Width characters, padded with spaces.
+template <auto Member, size_t Offset, size_t Width = sizeof(typename MemberOf<decltype(Member)>::type)>
+struct Field {
+  using type = typename MemberOf<decltype(Member)>::type;
+  static constexpr auto member = Member;
+  static constexpr size_t offset = Offset;
+  static constexpr size_t width = Width;
+
+  [[nodiscard]] static type read(char const *ptr) noexcept(!std::is_same_v<type, std::string>) {
+    if constexpr (std::is_same_v<type, std::string>) {
+      return std::string(ptr + Offset, Width);
+    } else if constexpr (std::is_enum_v<type>) {
+      return static_cast<type>(load_be<std::make_unsigned_t<std::underlying_type_t<type>>, Width>(ptr + Offset));
+    } else if constexpr (std::is_integral_v<type>) {
+      return static_cast<type>(load_be<std::make_unsigned_t<type>, Width>(ptr + Offset));
+    } else {
+      return type(load_be<uint64_t, Width>(ptr + Offset));
+    }
+  }
+
+  static void write(char *ptr, type const &value) noexcept {
+    if constexpr (std::is_same_v<type, std::string>) {
+      auto const n = std::min(value.size(), Width);
+      std::copy_n(value.data(), n, ptr + Offset);
+      std::fill_n(ptr + Offset + n, Width - n, ' ');
+    } else if constexpr (std::is_enum_v<type>) {
+      using U = std::make_unsigned_t<std::underlying_type_t<type>>;
+      store_be<U, Width>(ptr + Offset, static_cast<U>(value));
+    } else if constexpr (std::is_integral_v<type>) {
+      store_be<std::make_unsigned_t<type>, Width>(ptr + Offset, static_cast<std::make_unsigned_t<type>>(value));
+    } else {
+      store_be<uint64_t, Width>(ptr + Offset, static_cast<uint64_t>(value.count()));
+    }
+  }
+};
+
+// The message's Member, a message of its own at the start of this one, like the add order of an
+// add order with MPID. Its own layout is checked against its own length.
+template <auto Member>
+struct Embedded {
+  using type = typename MemberOf<decltype(Member)>::type;
+  static constexpr auto member = Member;
+  static constexpr size_t offset = 0;
+  static constexpr size_t width = 0;
+
+  [[nodiscard]] static type read(char const *ptr) {
+    return type::parse(ptr);
+  }
+
+  static void write(char *ptr, type const &value) {
+    value.write(ptr);
+  }
+};
+
+template <MessageType messageType, class... Fields>
+consteval bool fitsMessage(std::tuple<Fields...>) {
+  return ((Fields::offset + Fields::width <= netlen<messageType>) && ...);
+}
+
+// Each message lists its fields once, in a layout() tuple in the order of its constructor. Parsing
+// constructs the message from the fields read, writing stores its members back.
+template <MessageType messageType>
+[[nodiscard]] itch_message<messageType> parseLayout(char const *ptr) {
+  using Message = itch_message<messageType>;
+  static_assert(fitsMessage<messageType>(Message::layout()), "field past the end of the message");
+  return std::apply([ptr](auto... fields) { return Message(decltype(fields)::read(ptr)...); }, Message::layout());
+}
+
+template <MessageType messageType>
+void writeLayout(itch_message<messageType> const &msg, char *ptr) {
+  std::apply([&msg, ptr](auto... fields) { (decltype(fields)::write(ptr, msg.*decltype(fields)::member), ...); }, itch_message<messageType>::layout());
+}
 
 template <>
 struct itch_message<MessageType::SYSEVENT> {
@@ -112,23 +224,41 @@ struct itch_message<MessageType::SYSEVENT> {
   
   timestamp_t const timeStamp;
   char const eventCode;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timeStamp, 5, 6>{}, Field<&itch_message::eventCode, 11>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_timestamp(ptr + 5), ptr[11]);
+    return parseLayout<MessageType::SYSEVENT>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
 template <>
 struct itch_message<MessageType::STOCK_DIRECTORY> {
   itch_message(uint16_t stock_locate, timestamp_t timestamp, char marketCategory, std::string stock)
-      : stock_locate(stock_locate), timestamp(timestamp), marketCategory(marketCategory), stock(stock) {}
+      : stock_locate(stock_locate), timestamp(timestamp), stock(stock), marketCategory(marketCategory) {}
 
   uint16_t const stock_locate;
   timestamp_t const timestamp;
   std::string const stock;
   char const marketCategory;
 
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::stock_locate, 1>{}, Field<&itch_message::timestamp, 5, 6>{},
+                      Field<&itch_message::marketCategory, 19>{}, Field<&itch_message::stock, 11, 8>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_locate(ptr + 1), read_timestamp(ptr + 5), ptr[19], std::string{&ptr[11], 8});
+    return parseLayout<MessageType::STOCK_DIRECTORY>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
@@ -149,21 +279,38 @@ struct itch_message<MessageType::ADD_ORDER> {
   qty_t const qty;
   uint16_t const stock_locate;
   BUY_SELL const buy;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::oid, 11>{}, Field<&itch_message::price, 32>{},
+                      Field<&itch_message::qty, 20>{}, Field<&itch_message::stock_locate, 1>{}, Field<&itch_message::buy, 19>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_timestamp(ptr + 5), read_oid(ptr + 11),
-                        read_price(ptr + 32), read_qty(ptr + 20),
-                        read_locate(ptr + 1), BUY_SELL(*(ptr + 19)));
+    return parseLayout<MessageType::ADD_ORDER>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
 template <>
 struct itch_message<MessageType::ADD_ORDER_MPID> {
   using add_order_t = itch_message<MessageType::ADD_ORDER>;
-  itch_message(add_order_t const __base) : add_msg(__base) {}
+  explicit itch_message(add_order_t const __base) : add_msg(__base) {}
 
   add_order_t const add_msg;
+
+  static constexpr auto layout() {
+    return std::tuple(Embedded<&itch_message::add_msg>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(add_order_t::parse(ptr));
+    return parseLayout<MessageType::ADD_ORDER_MPID>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
@@ -176,20 +323,41 @@ struct itch_message<MessageType::EXECUTE_ORDER> {
   timestamp_t const timestamp;
   qty_t const qty;
   uint16_t const stock_locate;
+
+  // the match number at 23 is not kept
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::oid, 11>{}, Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::qty, 19>{},
+                      Field<&itch_message::stock_locate, 1>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_oid(ptr + 11), read_timestamp(ptr + 5),
-                        read_qty(ptr + 19), read_locate(ptr + 1));
+    return parseLayout<MessageType::EXECUTE_ORDER>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
 template <>
 struct itch_message<MessageType::EXECUTE_ORDER_WITH_PRICE> {
   using execute_order_t = itch_message<MessageType::EXECUTE_ORDER>;
-  itch_message(execute_order_t const __base) : exec(__base) {}
+  itch_message(execute_order_t const __base, char __printable, price_t __price) : exec(__base), printable(__printable), price(__price) {}
 
   execute_order_t const exec;
+  char const printable;
+  price_t const price;
+
+  static constexpr auto layout() {
+    return std::tuple(Embedded<&itch_message::exec>{}, Field<&itch_message::printable, 31>{}, Field<&itch_message::price, 32>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(execute_order_t::parse(ptr));
+    return parseLayout<MessageType::EXECUTE_ORDER_WITH_PRICE>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
@@ -202,9 +370,18 @@ struct itch_message<MessageType::REDUCE_ORDER> {
   timestamp_t const timestamp;
   qty_t const qty;
   uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::oid, 11>{}, Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::qty, 19>{},
+                      Field<&itch_message::stock_locate, 1>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_oid(ptr + 11), read_timestamp(ptr + 5),
-                        read_qty(ptr + 19), read_locate(ptr + 1));
+    return parseLayout<MessageType::REDUCE_ORDER>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
@@ -215,8 +392,17 @@ struct itch_message<MessageType::DELETE_ORDER> {
   oid_t const oid;
   timestamp_t const timestamp;
   uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::oid, 11>{}, Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::stock_locate, 1>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_oid(ptr + 11), read_timestamp(ptr + 5), read_locate(ptr + 1));
+    return parseLayout<MessageType::DELETE_ORDER>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
@@ -231,9 +417,144 @@ struct itch_message<MessageType::REPLACE_ORDER> {
   qty_t const new_qty;
   price_t const new_price;
   uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::oid, 11>{}, Field<&itch_message::new_order_id, 19>{},
+                      Field<&itch_message::new_qty, 27>{}, Field<&itch_message::new_price, 31>{}, Field<&itch_message::stock_locate, 1>{});
+  }
+
+  static itch_message parse(char const *ptr) {
+    return parseLayout<MessageType::REPLACE_ORDER>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
+  }
+};
+
+template <>
+struct itch_message<MessageType::TRADE> {
+  itch_message(timestamp_t __timestamp, oid_t __oid, BUY_SELL __buy, qty_t __qty, price_t __price, uint64_t __match_number, uint16_t __stock_locate)
+      : timestamp(__timestamp),
+        oid(__oid),
+        buy(__buy),
+        qty(__qty),
+        price(__price),
+        match_number(__match_number),
+        stock_locate(__stock_locate) {}
+
+  timestamp_t const timestamp;
+  oid_t const oid;
+  BUY_SELL const buy;
+  qty_t const qty;
+  price_t const price;
+  uint64_t const match_number;
+  uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::oid, 11>{}, Field<&itch_message::buy, 19>{},
+                      Field<&itch_message::qty, 20>{}, Field<&itch_message::price, 32>{}, Field<&itch_message::match_number, 36>{},
+                      Field<&itch_message::stock_locate, 1>{});
+  }
+
   static itch_message parse(char const *ptr) {
-    return itch_message(read_timestamp(ptr + 5), read_oid(ptr + 11), read_oid(ptr + 19),
-                        read_qty(ptr + 27), read_price(ptr + 31), read_locate(ptr + 1));
+    return parseLayout<MessageType::TRADE>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
+  }
+};
+
+template <>
+struct itch_message<MessageType::CROSS_TRADE> {
+  itch_message(timestamp_t __timestamp, uint64_t __shares, price_t __price, uint64_t __match_number, char __cross_type, uint16_t __stock_locate)
+      : timestamp(__timestamp),
+        shares(__shares),
+        price(__price),
+        match_number(__match_number),
+        cross_type(__cross_type),
+        stock_locate(__stock_locate) {}
+
+  timestamp_t const timestamp;
+  uint64_t const shares;
+  price_t const price;
+  uint64_t const match_number;
+  char const cross_type;
+  uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::shares, 11>{}, Field<&itch_message::price, 27>{},
+                      Field<&itch_message::match_number, 31>{}, Field<&itch_message::cross_type, 39>{}, Field<&itch_message::stock_locate, 1>{});
+  }
+
+  static itch_message parse(char const *ptr) {
+    return parseLayout<MessageType::CROSS_TRADE>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
+  }
+};
+
+template <>
+struct itch_message<MessageType::BROKEN_TRADE> {
+  itch_message(timestamp_t __timestamp, uint64_t __match_number, uint16_t __stock_locate)
+      : timestamp(__timestamp), match_number(__match_number), stock_locate(__stock_locate) {}
+
+  timestamp_t const timestamp;
+  uint64_t const match_number;
+  uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::match_number, 11>{}, Field<&itch_message::stock_locate, 1>{});
+  }
+
+  static itch_message parse(char const *ptr) {
+    return parseLayout<MessageType::BROKEN_TRADE>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
+  }
+};
+
+template <>
+struct itch_message<MessageType::NET_ORDER_IMBALANCE> {
+  itch_message(timestamp_t __timestamp, uint64_t __paired_shares, uint64_t __imbalance_shares, char __imbalance_direction,
+               price_t __far_price, price_t __near_price, price_t __reference_price, char __cross_type, uint16_t __stock_locate)
+      : timestamp(__timestamp),
+        paired_shares(__paired_shares),
+        imbalance_shares(__imbalance_shares),
+        imbalance_direction(__imbalance_direction),
+        far_price(__far_price),
+        near_price(__near_price),
+        reference_price(__reference_price),
+        cross_type(__cross_type),
+        stock_locate(__stock_locate) {}
+
+  timestamp_t const timestamp;
+  uint64_t const paired_shares;
+  uint64_t const imbalance_shares;
+  char const imbalance_direction;
+  price_t const far_price;
+  price_t const near_price;
+  price_t const reference_price;
+  char const cross_type;
+  uint16_t const stock_locate;
+
+  static constexpr auto layout() {
+    return std::tuple(Field<&itch_message::timestamp, 5, 6>{}, Field<&itch_message::paired_shares, 11>{}, Field<&itch_message::imbalance_shares, 19>{},
+                      Field<&itch_message::imbalance_direction, 27>{}, Field<&itch_message::far_price, 36>{}, Field<&itch_message::near_price, 40>{},
+                      Field<&itch_message::reference_price, 44>{}, Field<&itch_message::cross_type, 48>{}, Field<&itch_message::stock_locate, 1>{});
+  }
+
+  static itch_message parse(char const *ptr) {
+    return parseLayout<MessageType::NET_ORDER_IMBALANCE>(ptr);
+  }
+
+  void write(char *ptr) const {
+    writeLayout(*this, ptr);
   }
 };
 
@@ -1,12 +1,10 @@
 #pragma once
 
-#ifdef _WIN32
-#include "betoh.h"
-#else
-#include <sys/types.h>
-#endif
-
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <cstring>
+#include <type_traits>
 
 /* 
 BSD 3-Clause License
@@ -46,28 +44,52 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace md::itch::read_bytes {
 
-  static uint64_t read_eight(char const *src)
+  // Loads Width big-endian bytes from src into an unsigned T. The bytes are copied into a
+  // zero-initialised buffer, so src needs no alignment and narrow fields need no shifting.
+  template <class T, size_t Width = sizeof(T)>
+  [[nodiscard]] inline T load_be(char const *src) noexcept
+  {
+    static_assert(std::is_unsigned_v<T> && Width >= 1 && Width <= sizeof(T));
+    std::array<char, sizeof(T)> bytes = {};
+    std::memcpy(bytes.data() + sizeof(T) - Width, src, Width);
+    auto const value = std::bit_cast<T>(bytes);
+    if constexpr (std::endian::native == std::endian::little) {
+      return std::byteswap(value);
+    } else {
+      return value;
+    }
+  }
+
+  // Stores the low Width bytes of value at dst in big-endian order. Inverse of load_be.
+  template <class T, size_t Width = sizeof(T)>
+  inline void store_be(char *dst, T value) noexcept
+  {
+    static_assert(std::is_unsigned_v<T> && Width >= 1 && Width <= sizeof(T));
+    if constexpr (std::endian::native == std::endian::little) {
+      value = std::byteswap(value);
+    }
+    auto const bytes = std::bit_cast<std::array<char, sizeof(T)>>(value);
+    std::memcpy(dst, bytes.data() + sizeof(T) - Width, Width);
+  }
+
+  [[nodiscard]] inline uint64_t read_eight(char const *src) noexcept
   {
-    return be64toh(*(uint64_t const *)src);
+    return load_be<uint64_t>(src);
   }
 
-  static uint64_t read_six(char const *src)
+  [[nodiscard]] inline uint64_t read_six(char const *src) noexcept
   {
-    uint64_t ret;
-    char *pun = (char *)&ret;
-    // it's not clear whether this is faster than six separate char assignments
-    std::memcpy(pun, src, 6);
-    return (be64toh(ret) >> 16);
+    return load_be<uint64_t, 6>(src);
   }
 
-  static uint32_t read_four(char const *src)
+  [[nodiscard]] inline uint32_t read_four(char const *src) noexcept
   {
-    return be32toh(*(uint32_t const *)src);
+    return load_be<uint32_t>(src);
   }
 
-  static uint16_t read_two(char const *src)
+  [[nodiscard]] inline uint16_t read_two(char const *src) noexcept
   {
-    return be16toh(*(uint16_t const *)src);
+    return load_be<uint16_t>(src);
   }
 
 } // md::itch::read_bytes
@@ -7,13 +7,24 @@
 #include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <simulator/Backtest.h>
 #include <simulator/ItchBooksManager.h>
+#include <simulator/OMS.h>
 #include <simulator/Simulator.h>
+#include <simulator/Sweep.h>
+#include <simulator/TopOfBookRecording.h>
 #include <simulator/functions.h>
+#include <strategies/MeanReversionBlock.h>
+#include <strategies/Registry.h>
 #include <strategies/Strategies.h>
 
+#include <algorithm>
+#include <format>
 #include <memory>
 #include <print>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace py = pybind11;
 
@@ -41,35 +52,44 @@ class LOBReference {
   return std::format("{:.1f}{}", count, suffixes[s]);
 }
 
+template <class S>
 void testStrategies(
     md::BinaryDataReader reader,
-    std::unordered_map<int, std::vector<std::reference_wrapper<strategies::TestStrategy>>> strategiesBySymbolId,
+    simulator::OMS& oms,
+    std::unordered_map<int, std::vector<std::reference_wrapper<S>>> strategiesBySymbolId,
     unsigned int numIters) {
 
   auto bmgr = simulator::ItchBooksManager{};
   auto simulator = simulator::Simulator{[&] { return simulator::getNextMarketDataEvent(reader, bmgr); }};
+  oms.connect(simulator, bmgr);
 
-  auto prevTopById = boost::unordered_map<int, lob::LimitOrderBook::TopOfBook>{};
-  for (auto const& [symbolId, strategies] : strategiesBySymbolId) {
-    prevTopById[symbolId] = bmgr.bookById(symbolId).top();
-  }
+  for (auto const& [symbolId, strategies] : strategiesBySymbolId) bmgr.subscribe(symbolId);
 
-  for (int i : std::views::iota(0u, numIters)) {
+  // runs stop at top of book changes, and often enough to pick up a keyboard interrupt
+  constexpr size_t MaxRun = 1 << 16;
+  for (size_t n = 0; n < numIters;) {
     if (PyErr_CheckSignals() != 0)
       throw py::error_already_set();
 
-    auto const timestamp = simulator.step();
+    auto const run = simulator.runFor(std::min<size_t>(numIters - n, MaxRun), [&bmgr] { return bmgr.topsChanged(); });
+    n += run.numEvents;
 
-    for (auto const& [symbolId, strategies] : strategiesBySymbolId) {
-      auto& prevTop = prevTopById.at(symbolId);
-      auto const& currTop = bmgr.bookById(symbolId).top();
-      if (prevTop != currTop) {
-        for (auto& strategy : strategies) {
-          strategy.get().onUpdate(timestamp, currTop);
-        }
-        prevTop = currTop;
+    bmgr.takeChangedTops([&](int symbolId, auto const& book) {
+      for (auto& strategy : strategiesBySymbolId.at(symbolId)) {
+        strategy.get().onUpdate(run.timestamp, book.top());
       }
-    }
+    });
+    oms.processRequests();
+  }
+}
+
+// testStrategies on a recording instead of the book engine
+template <class S>
+void replayStrategies(simulator::TopOfBookRecording const& recording, std::unordered_map<int, std::vector<std::reference_wrapper<S>>> strategiesBySymbolId) {
+  for (auto const& record : recording.records()) {
+    auto const it = strategiesBySymbolId.find(record.symbolId);
+    if (it == strategiesBySymbolId.end()) continue;
+    for (auto& strategy : it->second) strategy.get().onUpdate(simulator::Simulator::TimestampT(record.timestamp), record.top());
   }
 }
 
@@ -81,30 +101,90 @@ auto getTopOfBookData(
   auto bmgr = simulator::ItchBooksManager{};
   auto simulator = simulator::Simulator{[&] { return simulator::getNextMarketDataEvent(reader, bmgr); }};
 
-  auto prevTop = bmgr.bookById(symbolId).top();
+  bmgr.subscribe(symbolId);
 
   auto timestamps = std::vector<std::chrono::nanoseconds>{};
   auto bids = std::vector<double>{};
   auto asks = std::vector<double>{};
 
-  for (int i : std::views::iota(0u, numIters)) {
+  constexpr size_t MaxRun = 1 << 16;
+  for (size_t n = 0; n < numIters;) {
     if (PyErr_CheckSignals() != 0)
       throw py::error_already_set();
 
-    auto const timestamp = simulator.step();
+    auto const run = simulator.runFor(std::min<size_t>(numIters - n, MaxRun), [&bmgr] { return bmgr.topsChanged(); });
+    n += run.numEvents;
 
-    auto const& currTop = bmgr.bookById(symbolId).top();
-    if (prevTop != currTop) {
-      timestamps.push_back(timestamp);
-      bids.push_back(static_cast<double>(currTop.bid));
-      asks.push_back(static_cast<double>(currTop.ask));
-      prevTop = currTop;
-    }
+    bmgr.takeChangedTops([&](int, auto const& book) {
+      auto const& top = book.top();
+      timestamps.push_back(run.timestamp);
+      bids.push_back(static_cast<double>(top.bid));
+      asks.push_back(static_cast<double>(top.ask));
+    });
   }
 
   return std::tuple{timestamps, bids, asks};
 }
 
+// Binds a registered strategy as <name>, with its parameters as <name>.Params taking them as
+// keyword arguments and exposing them as properties, and testStrategies and replayStrategies for
+// lists of it.
+template <class Entry>
+void bindStrategy(py::module_& m) {
+  using S = typename Entry::StrategyT;
+  using P = typename Entry::ParamsT;
+  auto const name = std::string(Entry::name);
+
+  auto strategy = py::class_<S>(m, name.c_str());
+
+  auto params = py::class_<P>(strategy, "Params");
+  params.def(py::init([](py::kwargs const& kwargs) {
+    auto p = P{};
+    size_t numSet = 0;
+    strategies::forEachField(p, [&](std::string_view field, auto& value) {
+      auto const key = py::str(field.data(), field.size());
+      if (!kwargs.contains(key)) return;
+      value = kwargs[key].template cast<std::remove_cvref_t<decltype(value)>>();
+      ++numSet;
+    });
+    if (numSet != kwargs.size()) throw py::type_error(std::format("unknown parameters for {}: {}", Entry::name, py::str(kwargs).cast<std::string>()));
+    return p;
+  }));
+  auto defaults = P{};
+  strategies::forEachField(defaults, [&params](std::string_view field, auto const& value) {
+    using T = std::remove_cvref_t<decltype(value)>;
+    auto const find = [field](P& p) {
+      T* found = nullptr;
+      strategies::forEachField(p, [&](std::string_view other, auto& v) {
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(v)>, T>) {
+          if (other == field) found = &v;
+        }
+      });
+      return found;
+    };
+    params.def_property(std::string(field).c_str(), [find](P& p) { return *find(p); }, [find](P& p, T value) { *find(p) = value; });
+  });
+  params.def("__str__", [name](P const& p) {
+    auto s = std::format("<{}.Params(", name);
+    auto first = true;
+    strategies::forEachField(p, [&](std::string_view field, auto const& value) {
+      s += std::format("{}{}={}", first ? "" : ", ", field, value);
+      first = false;
+    });
+    return s + ")>";
+  });
+
+  strategy
+      .def(py::init([](simulator::OMS& oms, int symbolId, P const& params, logging::Logger* logger) { return std::make_unique<S>(oms, symbolId, params, logger); }),
+           py::arg("oms"), py::arg("symbolId"), py::arg("params") = P{}, py::arg("logger") = nullptr, py::keep_alive<1, 2>())
+      .def("__str__", [name](S const& s) { return std::format("<{} at {}>", name, static_cast<void const*>(&s)); })
+      .def_property_readonly("position", &S::position)
+      .def_property_readonly("diagnostics", [](S const& s) { return s.diagnostics(); });
+
+  m.def("testStrategies", &testStrategies<S>);
+  m.def("replayStrategies", &replayStrategies<S>);
+}
+
 #define LOG(...) logger.log(__VA_ARGS__);
 
 void loggerTest() {
@@ -218,23 +298,110 @@ PYBIND11_MODULE(pymd, m) {
 
   py::class_<simulator::OMS>(m, "OMS")
       .def(py::init<>())
-      .def("__str__", [](simulator::OMS const& oms) { return std::format("<OMS(...) at {}>", static_cast<void const*>(&oms)); });
+      .def(py::init([](std::chrono::nanoseconds latency) { return std::make_unique<simulator::OMS>(simulator::OMSOptions{.latency = latency}); }))
+      .def_property_readonly("numOrders", &simulator::OMS::numOrders)
+      .def_property_readonly("numFills", &simulator::OMS::numFills)
+      .def("__str__", [](simulator::OMS const& oms) { return std::format("<OMS(orders={}, fills={}) at {}>", oms.numOrders(), oms.numFills(), static_cast<void const*>(&oms)); });
 
   py::class_<strategies::StrategyDiagnostics>(m, "StrategyDiagnostics")
       .def("__str__", [](strategies::StrategyDiagnostics const& sd) { return std::format("<StrategyDiagnostics at {}>", static_cast<void const*>(&sd)); })
       .def("toString", &strategies::StrategyDiagnostics::toString);
 
-  py::class_<strategies::TestStrategy>(m, "TestStrategy")
-      .def(py::init<simulator::OMS&, int, int, logging::Logger*>())
-      .def("__str__", [](strategies::TestStrategy const& s) { return std::format("<TestStrategy at {}>", static_cast<void const*>(&s)); })
-      .def_property_readonly("diagnostics", [](strategies::TestStrategy const& s) { return s.diagnostics(); });
+  py::class_<strategies::MeanReversionParams>(m, "MeanReversionParams")
+      .def(py::init<>())
+      .def(py::init([](size_t k, double entry, int qty) { return strategies::MeanReversionParams{k, entry, qty}; }), py::arg("k"), py::arg("entry") = 2.0, py::arg("qty") = 1)
+      .def_readwrite("k", &strategies::MeanReversionParams::k)
+      .def_readwrite("entry", &strategies::MeanReversionParams::entry)
+      .def_readwrite("qty", &strategies::MeanReversionParams::qty)
+      .def("__str__", &strategies::MeanReversionParams::toString);
+
+  py::class_<strategies::MeanReversionResult>(m, "MeanReversionResult")
+      .def_readonly("params", &strategies::MeanReversionResult::params)
+      .def_readonly("numOrders", &strategies::MeanReversionResult::numOrders)
+      .def_readonly("numFills", &strategies::MeanReversionResult::numFills)
+      .def_readonly("position", &strategies::MeanReversionResult::position)
+      .def_readonly("cash", &strategies::MeanReversionResult::cash)
+      .def("__str__", [](strategies::MeanReversionResult const& r) { return std::format("<MeanReversionResult({}: orders={}, fills={}, position={}, cash={})>", r.params.toString(), r.numOrders, r.numFills, r.position, r.cash); });
+
+  py::class_<simulator::TopOfBookRecording>(m, "TopOfBookRecording")
+      .def(py::init<std::string>())
+      .def_property_readonly("size", &simulator::TopOfBookRecording::size)
+      .def("__len__", &simulator::TopOfBookRecording::size)
+      .def("__str__", [](simulator::TopOfBookRecording const& r) { return std::format("<TopOfBookRecording(size={}) at {}>", r.size(), static_cast<void const*>(&r)); });
+
+  py::class_<simulator::StrategyConfig>(m, "StrategyConfig")
+      .def(py::init([](std::string strategy, py::kwargs const& params) {
+             auto config = simulator::StrategyConfig{std::move(strategy)};
+             for (auto const& [name, value] : params) config.params.emplace_back(name.cast<std::string>(), value.cast<double>());
+             return config;
+           }),
+           py::arg("strategy") = "TestStrategy")
+      .def_readwrite("strategy", &simulator::StrategyConfig::strategy)
+      .def_readwrite("params", &simulator::StrategyConfig::params)
+      .def("__str__", &simulator::StrategyConfig::toString);
+
+  py::class_<simulator::BacktestJob>(m, "BacktestJob")
+      .def(py::init([](std::string file, std::vector<std::string> symbols, simulator::StrategyConfig config) { return simulator::BacktestJob{std::move(file), std::move(symbols), std::move(config)}; }),
+           py::arg("file"), py::arg("symbols"), py::arg("config") = simulator::StrategyConfig{})
+      .def_readwrite("file", &simulator::BacktestJob::file)
+      .def_readwrite("symbols", &simulator::BacktestJob::symbols)
+      .def_readwrite("config", &simulator::BacktestJob::config);
+
+  py::class_<simulator::BacktestResult>(m, "BacktestResult")
+      .def_readonly("job", &simulator::BacktestResult::job)
+      .def_readonly("file", &simulator::BacktestResult::file)
+      .def_readonly("symbol", &simulator::BacktestResult::symbol)
+      .def_readonly("config", &simulator::BacktestResult::config)
+      .def_readonly("numUpdates", &simulator::BacktestResult::numUpdates)
+      .def_readonly("numOrders", &simulator::BacktestResult::numOrders)
+      .def_readonly("numFills", &simulator::BacktestResult::numFills)
+      .def_readonly("position", &simulator::BacktestResult::position)
+      .def_readonly("cash", &simulator::BacktestResult::cash)
+      .def_readonly("pnl", &simulator::BacktestResult::pnl)
+      .def_readonly("seconds", &simulator::BacktestResult::seconds)
+      .def_readonly("error", &simulator::BacktestResult::error)
+      .def("__str__", [](simulator::BacktestResult const& r) { return std::format("<BacktestResult({} {} {}: orders={}, fills={}, pnl={})>", r.file, r.symbol, r.config, r.numOrders, r.numFills, r.pnl); });
+
+  py::class_<simulator::BacktestReport>(m, "BacktestReport")
+      .def_readonly("results", &simulator::BacktestReport::results)
+      .def_readonly("numThreads", &simulator::BacktestReport::numThreads)
+      .def_readonly("seconds", &simulator::BacktestReport::seconds)
+      .def("save", &simulator::BacktestReport::save)
+      .def("toString", &simulator::BacktestReport::toString);
 
   py::class_<logging::Logger>(m, "Logger")
       .def(py::init([](int queueSize, std::chrono::milliseconds sleepDuration) { return std::make_unique<logging::Logger>(queueSize, logging::handlers::createCoutHandler(), sleepDuration); }))
       .def("__str__", [](logging::Logger const& l) { return std::format("<Logger at {}>", static_cast<void const*>(&l)); })
       .def("log", [](logging::Logger& l, std::string const& m) { l.log("{}", m); });
 
-  m.def("testStrategies", &testStrategies);
+  // one class and one testStrategies overload per registered strategy
+  strategies::RegisteredStrategies::forEach([&m]<class Entry>() { bindStrategy<Entry>(m); });
+
+  m.def("makeGrid", [](std::vector<size_t> const& ks, std::vector<double> const& entries, std::vector<int> const& qtys) { return strategies::makeGrid(ks, entries, qtys); });
+  m.def(
+      "sweep",
+      [](md::BinaryDataReader reader, int symbolId, std::vector<strategies::MeanReversionParams> const& grid, size_t numIters, size_t numWorkers, std::chrono::nanoseconds latency) {
+        // the replay and the workers touch no Python objects
+        py::gil_scoped_release release;
+        return simulator::runSweep(reader, symbolId, grid, numIters, {.numWorkers = numWorkers, .latency = latency});
+      },
+      py::arg("reader"), py::arg("symbolId"), py::arg("grid"), py::arg("numIters"), py::arg("numWorkers") = 4, py::arg("latency") = std::chrono::nanoseconds(std::chrono::microseconds(50)));
+  m.def(
+      "recordTopOfBook",
+      [](md::BinaryDataReader reader, std::vector<int> const& symbolIds, size_t numIters, std::string const& filename) {
+        py::gil_scoped_release release;
+        return simulator::recordTopOfBook(reader, symbolIds, numIters, filename);
+      },
+      py::arg("reader"), py::arg("symbolIds"), py::arg("numIters"), py::arg("filename"));
+  m.def("makeBacktestJobs", [](std::vector<std::string> const& files, std::vector<std::vector<std::string>> const& symbolSets, std::vector<simulator::StrategyConfig> const& configs) { return simulator::makeBacktestJobs(files, symbolSets, configs); });
+  m.def(
+      "runBacktests",
+      [](std::vector<simulator::BacktestJob> const& jobs, size_t numThreads, size_t numIters) {
+        // the jobs touch no Python objects
+        py::gil_scoped_release release;
+        return simulator::runBacktests(jobs, {.numThreads = numThreads, .numEvents = numIters});
+      },
+      py::arg("jobs"), py::arg("numThreads") = simulator::BacktestOptions{}.numThreads, py::arg("numIters") = simulator::BacktestOptions{}.numEvents);
   m.def("getTopOfBookData", &getTopOfBookData);
   m.def("loggerTest", &loggerTest);
 }
@@ -0,0 +1,234 @@
+#include "Backtest.h"
+
+#include <md/BinaryDataReader.h>
+#include <md/MappedFile.h>
+#include <md/Symbols.h>
+#include <strategies/Registry.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exec/static_thread_pool.hpp>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <latch>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <stdexec/execution.hpp>
+#include <string_view>
+#include <type_traits>
+
+#include "ItchBooksManager.h"
+#include "OMS.h"
+#include "Simulator.h"
+#include "functions.h"
+
+namespace {
+
+// A trading day, mapped once and read by every job replaying it.
+struct Day {
+  explicit Day(std::string const& filename) : file(filename), reader(file.data(), file.size()), symbols(reader) {}
+
+  md::MappedFile file;
+  md::BinaryDataReader reader;  // at the start of system hours, past the symbol directory
+  md::utils::Symbols symbols;
+};
+
+template <class Entry>
+typename Entry::ParamsT makeParams(simulator::StrategyConfig const& config) {
+  auto params = typename Entry::ParamsT{};
+  for (auto const& [name, value] : config.params) {
+    auto found = false;
+    strategies::forEachField(params, [&](std::string_view field, auto& member) {
+      if (field != name) return;
+      member = static_cast<std::remove_cvref_t<decltype(member)>>(value);
+      found = true;
+    });
+    if (!found) throw std::invalid_argument(std::format("{} has no parameter {}", Entry::name, name));
+  }
+  return params;
+}
+
+// Calls f.template operator()<Entry>() for the config's strategy.
+void visitStrategy(simulator::StrategyConfig const& config, auto&& f) {
+  if (!strategies::RegisteredStrategies::visit(config.strategy, f)) throw std::invalid_argument(std::format("unknown strategy {}", config.strategy));
+}
+
+template <class Entry>
+void runJob(Day const& day, simulator::BacktestJob const& job, simulator::BacktestOptions const& options, std::vector<simulator::BacktestResult>& results) {
+  using StrategyT = typename Entry::StrategyT;
+  using TimestampT = simulator::Simulator::TimestampT;
+
+  // the end of the day's messages runs as an empty event at the end of time
+  constexpr auto EndOfDay = TimestampT::max();
+  auto reader = day.reader;
+  auto bmgr = simulator::ItchBooksManager{};
+  auto simulator = simulator::Simulator{[&]() -> simulator::Simulator::EventT {
+    if (auto event = simulator::tryGetNextMarketDataEvent(reader, bmgr)) return std::move(*event);
+    return {EndOfDay, [] {}};
+  }};
+  auto oms = simulator::OMS({.latency = options.latency});
+  oms.connect(simulator, bmgr);
+
+  auto const params = makeParams<Entry>(job.config);
+  auto byId = std::map<int, std::unique_ptr<StrategyT>>();
+  auto numUpdates = std::map<int, size_t>();
+  for (auto const& symbol : job.symbols) {
+    auto const id = day.symbols.byName(symbol);
+    byId.emplace(id, std::make_unique<StrategyT>(oms, id, params));
+    bmgr.subscribe(id);
+  }
+
+  for (size_t n = 0; n < options.numEvents;) {
+    auto const run = simulator.runFor(options.numEvents - n, [&] { return bmgr.topsChanged() || simulator.now() == EndOfDay; });
+    n += run.numEvents;
+    if (run.timestamp == EndOfDay) break;
+    bmgr.takeChangedTops([&](int id, auto const& book) {
+      byId.at(id)->onUpdate(run.timestamp, book.top());
+      ++numUpdates[id];
+    });
+    oms.processRequests();
+  }
+
+  for (auto& result : results) {
+    auto const id = day.symbols.byName(result.symbol);
+    auto const& diagnostics = byId.at(id)->diagnostics();
+    result.numUpdates = numUpdates[id];
+    result.numOrders = diagnostics.numOrders;
+    result.numFills = diagnostics.numFills;
+    result.position = diagnostics.position;
+    result.cash = diagnostics.cash;
+    auto const top = bmgr.bookById(id).top();
+    auto const hasMid = static_cast<int>(top.bid) != 0 && static_cast<int>(top.ask) != 0;
+    auto const mid = hasMid ? (static_cast<double>(top.bid) + static_cast<double>(top.ask)) / 2 : 0.0;
+    result.pnl = result.cash + static_cast<double>(result.position) * mid;
+  }
+}
+
+}  // namespace
+
+std::string simulator::StrategyConfig::toString() const {
+  auto s = strategy;
+  for (auto const& [name, value] : params) s += std::format(" {}={}", name, value);
+  return s;
+}
+
+std::vector<simulator::BacktestJob> simulator::makeBacktestJobs(std::span<std::string const> files, std::span<std::vector<std::string> const> symbolSets, std::span<StrategyConfig const> configs) {
+  auto jobs = std::vector<BacktestJob>();
+  jobs.reserve(files.size() * symbolSets.size() * configs.size());
+  for (auto const& file : files) {
+    for (auto const& symbols : symbolSets) {
+      for (auto const& config : configs) jobs.push_back({file, symbols, config});
+    }
+  }
+  return jobs;
+}
+
+std::vector<simulator::BacktestSummary> simulator::BacktestReport::summaries() const {
+  auto summaries = std::vector<BacktestSummary>();
+  auto byConfig = std::map<std::string, size_t>();
+  for (auto const& result : results) {
+    auto const [it, inserted] = byConfig.try_emplace(result.config, summaries.size());
+    if (inserted) summaries.push_back({result.config});
+    auto& summary = summaries[it->second];
+    ++summary.numResults;
+    if (!result.error.empty()) {
+      ++summary.numFailed;
+      continue;
+    }
+    summary.numOrders += result.numOrders;
+    summary.numFills += result.numFills;
+    summary.pnl += result.pnl;
+  }
+  return summaries;
+}
+
+std::string simulator::BacktestReport::toString() const {
+  std::stringstream ss;
+  ss << std::format("{} results on {} threads in {:.1f}s", results.size(), numThreads, seconds) << std::endl;
+  for (auto const& summary : summaries()) {
+    ss << std::format("{}: {} results, {} failed, orders/fills {}/{}, pnl {:.2f}", summary.config, summary.numResults, summary.numFailed, summary.numOrders, summary.numFills, summary.pnl) << std::endl;
+  }
+  for (auto const& result : results) {
+    if (!result.error.empty()) ss << std::format("{} {} {}: {}", result.file, result.symbol, result.config, result.error) << std::endl;
+  }
+  return ss.str();
+}
+
+void simulator::BacktestReport::save(std::string const& filename) const {
+  nlohmann::json j;
+  j["numThreads"] = numThreads;
+  j["seconds"] = seconds;
+  for (auto const& summary : summaries()) {
+    j["summaries"].push_back({{"config", summary.config}, {"numResults", summary.numResults}, {"numFailed", summary.numFailed}, {"numOrders", summary.numOrders}, {"numFills", summary.numFills}, {"pnl", summary.pnl}});
+  }
+  for (auto const& result : results) {
+    j["results"].push_back({{"job", result.job}, {"file", result.file}, {"symbol", result.symbol}, {"config", result.config}, {"numUpdates", result.numUpdates}, {"numOrders", result.numOrders}, {"numFills", result.numFills}, {"position", result.position}, {"cash", result.cash}, {"pnl", result.pnl}, {"seconds", result.seconds}, {"error", result.error}});
+  }
+
+  auto file = std::ofstream(filename);
+  if (!file.is_open()) throw std::runtime_error(std::format("Could not open output file '{}'", filename));
+  file << j.dump();
+}
+
+simulator::BacktestReport simulator::runBacktests(std::span<BacktestJob const> jobs, BacktestOptions const& options) {
+  auto const start = std::chrono::steady_clock::now();
+
+  // mapped once per file and checked up front, on this thread
+  auto days = std::map<std::string, std::unique_ptr<Day const>>();
+  for (auto const& job : jobs) {
+    auto& day = days[job.file];
+    if (!day) day = std::make_unique<Day const>(job.file);
+    for (auto const& symbol : job.symbols) {
+      if (std::ranges::find(day->symbols, symbol, [](auto const& entry) { return entry.first; }) == day->symbols.end()) throw std::invalid_argument(std::format("no symbol {} in {}", symbol, job.file));
+    }
+    visitStrategy(job.config, [&job]<class Entry>() { static_cast<void>(makeParams<Entry>(job.config)); });
+  }
+
+  auto byJob = std::vector<std::vector<BacktestResult>>(jobs.size());
+  for (size_t i = 0; i != jobs.size(); ++i) {
+    for (auto const& symbol : jobs[i].symbols) byJob[i].push_back({.job = i, .file = jobs[i].file, .symbol = symbol, .config = jobs[i].config.toString()});
+  }
+
+  // Biggest days first, so the last jobs to start are the short ones. The pool balances the jobs
+  // over its threads by stealing.
+  auto order = std::vector<size_t>(jobs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, std::greater{}, [&](size_t i) { return days.at(jobs[i].file)->file.size(); });
+
+  // outlives the pool, whose threads count it down
+  auto remaining = std::latch(static_cast<std::ptrdiff_t>(jobs.size()));
+  auto const numThreads = std::max<size_t>(options.numThreads, 1);
+  auto pool = exec::static_thread_pool(static_cast<uint32_t>(numThreads));
+  auto const& sched = pool.get_scheduler();
+
+  namespace ex = stdexec;
+
+  for (auto const i : order) {
+    ex::start_detached(ex::schedule(sched) | ex::then([&, i]() noexcept {
+      auto& results = byJob[i];
+      auto const jobStart = std::chrono::steady_clock::now();
+      try {
+        visitStrategy(jobs[i].config, [&]<class Entry>() { runJob<Entry>(*days.at(jobs[i].file), jobs[i], options, results); });
+      } catch (std::exception const& error) {
+        for (auto& result : results) result.error = error.what();
+      } catch (...) {
+        for (auto& result : results) result.error = "unknown exception";
+      }
+      auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+      for (auto& result : results) result.seconds = seconds;
+      remaining.count_down();
+    }));
+  }
+  remaining.wait();
+
+  auto report = BacktestReport{.numThreads = numThreads};
+  for (auto& results : byJob) std::ranges::move(results, std::back_inserter(report.results));
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return report;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace simulator {
+
+// A registered strategy and the fields of its params that differ from their defaults, by name.
+struct StrategyConfig {
+  std::string strategy = "TestStrategy";
+  std::vector<std::pair<std::string, double>> params = {};
+
+  [[nodiscard]] std::string toString() const;
+};
+
+// One trading day of ITCH, the symbols to trade on it and what to trade them with. Every symbol
+// gets its own strategy.
+struct BacktestJob {
+  std::string file;
+  std::vector<std::string> symbols;
+  StrategyConfig config;
+};
+
+// Every combination, day by day.
+[[nodiscard]] std::vector<BacktestJob> makeBacktestJobs(std::span<std::string const> files, std::span<std::vector<std::string> const> symbolSets, std::span<StrategyConfig const> configs);
+
+struct BacktestOptions {
+  // threads of the pool the jobs are spread over
+  size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  // market data events per job, the whole day by default
+  size_t numEvents = std::numeric_limits<size_t>::max();
+  std::chrono::nanoseconds latency = std::chrono::microseconds(50);
+};
+
+// Of one symbol of one job.
+struct BacktestResult {
+  size_t job = 0;
+  std::string file;
+  std::string symbol;
+  std::string config;
+  size_t numUpdates = 0;
+  size_t numOrders = 0;
+  size_t numFills = 0;
+  int64_t position = 0;  // signed, bought minus sold
+  double cash = 0.0;     // received for sales minus paid for buys
+  double pnl = 0.0;      // cash, with the position marked at the last mid
+  double seconds = 0.0;  // the job's, shared by its symbols
+  std::string error;     // what stopped the job, if it failed
+};
+
+// Totals over days and symbols of one strategy config.
+struct BacktestSummary {
+  std::string config;
+  size_t numResults = 0;
+  size_t numFailed = 0;
+  size_t numOrders = 0;
+  size_t numFills = 0;
+  double pnl = 0.0;
+};
+
+struct BacktestReport {
+  std::vector<BacktestResult> results;  // by job, then symbol
+  size_t numThreads = 0;
+  double seconds = 0.0;  // wall time of the whole run
+
+  // in the order the configs first appear
+  [[nodiscard]] std::vector<BacktestSummary> summaries() const;
+  [[nodiscard]] std::string toString() const;
+  void save(std::string const& filename) const;
+};
+
+// Runs the jobs in parallel on a thread pool, each with its own books, simulator and OMS. Every
+// input file is mapped once and shared read-only by the jobs replaying it. Jobs are checked before
+// any runs: unknown strategies, params, files or symbols throw. A job failing while running is
+// reported in its results instead.
+[[nodiscard]] BacktestReport runBacktests(std::span<BacktestJob const> jobs, BacktestOptions const& options = {});
+
+}  // namespace simulator
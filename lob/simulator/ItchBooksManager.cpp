@@ -1,5 +1,6 @@
 #include "ItchBooksManager.h"
 
+#include <lob/Tsc.h>
 #include <md/itch/TypeFormatters.h>
 
 #include <chrono>
@@ -7,64 +8,67 @@
 #include <print>
 
 #include "ItchToLobType.h"
+#include "OMS.h"
+#include "TopOfBookRecording.h"
 
 void simulator::ItchBooksManager::addOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::BUY_SELL buy, md::itch::types::qty_t qty, md::itch::types::price_t price) {
   if (!mStocks.contains(stockLocate)) return;
-  auto& book = mBooks[stockLocate];
+  countBookOp(BookOp::Add);
+  auto& book = *mBooks[stockLocate];
   auto before = book.top();
   book.addOrder(toOrderId(oid), toDirection(buy), toInt(qty), toLevel<LobT::Precision>(price));
   // std::println("Added order {}. Size: {}", oid, (int)qty);
-  if (before != book.top()) {
-    mTopOfBookBuffers[stockLocate].push({std::chrono::high_resolution_clock::now(), book.top()});
-  }
+  if (before != book.top()) publishTop(stockLocate, book);
 }
 
 void simulator::ItchBooksManager::deleteOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid) {
   if (!mStocks.contains(stockLocate)) return;
-  auto& book = mBooks[stockLocate];
+  countBookOp(BookOp::Delete);
+  auto& book = *mBooks[stockLocate];
   auto before = book.top();
   if (book.deleteOrder(toOrderId(oid))) {
     // std::println("Deleted order {}", oid);
   } else {
     throw std::runtime_error(std::format("Could not delete order {}", oid));
   }
-  if (before != book.top()) {
-    mTopOfBookBuffers[stockLocate].push({std::chrono::high_resolution_clock::now(), book.top()});
-  }
+  if (before != book.top()) publishTop(stockLocate, book);
 }
 
 void simulator::ItchBooksManager::replaceOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::oid_t newOid, md::itch::types::qty_t newQty, md::itch::types::price_t newPrice) {
   if (!mStocks.contains(stockLocate)) return;
-  auto& book = mBooks[stockLocate];
+  countBookOp(BookOp::Replace);
+  auto& book = *mBooks[stockLocate];
   auto before = book.top();
   if (book.replaceOrder(toOrderId(oid), toOrderId(newOid), toInt(newQty), toLevel<LobT::Precision>(newPrice))) {
     // std::println("Replaced order {} with {}", oid, newOid);
   } else {
     throw std::runtime_error(std::format("Could not replace order {} with {}", oid, newOid));
   }
-  if (before != book.top()) {
-    mTopOfBookBuffers[stockLocate].push({std::chrono::high_resolution_clock::now(), book.top()});
-  }
+  if (before != book.top()) publishTop(stockLocate, book);
 }
 
 void simulator::ItchBooksManager::reduceOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::qty_t qty) {
   if (!mStocks.contains(stockLocate)) return;
-  auto& book = mBooks[stockLocate];
+  countBookOp(BookOp::Reduce);
+  auto& book = *mBooks[stockLocate];
   auto before = book.top();
   if (book.reduceOrder(toOrderId(oid), toInt(qty))) {
     // std::println("Reduced order {} by {}", oid, (int)qty);
   } else {
     throw std::runtime_error(std::format("Could not reduce order {} in book!!", oid, stockLocate));
   }
-  if (before != book.top()) {
-    mTopOfBookBuffers[stockLocate].push({std::chrono::high_resolution_clock::now(), book.top()});
-  }
+  if (before != book.top()) publishTop(stockLocate, book);
 }
 
 void simulator::ItchBooksManager::executeOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::qty_t qty) {
   if (!mStocks.contains(stockLocate)) return;
-  auto& book = mBooks[stockLocate];
+  countBookOp(BookOp::Execute);
+  auto& book = *mBooks[stockLocate];
   auto before = book.top();
+  if (auto const level = book.orderLevel(toOrderId(oid))) {
+    mTradeBuffers[stockLocate].push({ClockT::now(), Trade{Trade::Kind::Execution, *level, toInt(qty)}});
+  }
+  if (mOMS) mOMS->onExecute(stockLocate, book, toOrderId(oid), toInt(qty));
   switch (book.executeOrder(toOrderId(oid), toInt(qty))) {
     case lob::ExecuteOrderResult::FULL:
       // std::println("Executed order {} (full: {})", oid, (int)qty);
@@ -75,7 +79,80 @@ void simulator::ItchBooksManager::executeOrder(md::itch::types::locate_t stockLo
     case lob::ExecuteOrderResult::ERROR:
       throw std::runtime_error(std::format("Could not execute order {} (qty: {})", oid, (int)qty));
   }
-  if (before != book.top()) {
-    mTopOfBookBuffers[stockLocate].push({std::chrono::high_resolution_clock::now(), book.top()});
+  if (before != book.top()) publishTop(stockLocate, book);
+}
+
+void simulator::ItchBooksManager::executeOrderWithPrice(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::qty_t qty, md::itch::types::price_t price, bool printable) {
+  if (!mStocks.contains(stockLocate)) return;
+  countBookOp(BookOp::Execute);
+  auto& book = *mBooks[stockLocate];
+  auto before = book.top();
+  // non-printable executions are reported in volume through a later cross or trade message
+  if (printable) {
+    mTradeBuffers[stockLocate].push({ClockT::now(), Trade{Trade::Kind::Execution, toLevel<LobT::Precision>(price), toInt(qty)}});
+  }
+  if (mOMS) mOMS->onExecute(stockLocate, book, toOrderId(oid), toInt(qty));
+  if (book.executeOrder(toOrderId(oid), toInt(qty)) == lob::ExecuteOrderResult::ERROR) {
+    throw std::runtime_error(std::format("Could not execute order {} (qty: {})", oid, (int)qty));
+  }
+  if (before != book.top()) publishTop(stockLocate, book);
+}
+
+void simulator::ItchBooksManager::trade(md::itch::types::locate_t stockLocate, md::itch::types::qty_t qty, md::itch::types::price_t price, uint64_t matchNumber) {
+  if (!mStocks.contains(stockLocate)) return;
+  countBookOp(BookOp::Trade);
+  mTradeBuffers[stockLocate].push({ClockT::now(), Trade{Trade::Kind::Hidden, toLevel<LobT::Precision>(price), toInt(qty), matchNumber}});
+}
+
+void simulator::ItchBooksManager::crossTrade(md::itch::types::locate_t stockLocate, uint64_t shares, md::itch::types::price_t price, uint64_t matchNumber) {
+  if (!mStocks.contains(stockLocate)) return;
+  countBookOp(BookOp::Trade);
+  mTradeBuffers[stockLocate].push({ClockT::now(), Trade{Trade::Kind::Cross, toLevel<LobT::Precision>(price), static_cast<int64_t>(shares), matchNumber}});
+}
+
+void simulator::ItchBooksManager::brokenTrade(md::itch::types::locate_t stockLocate, uint64_t matchNumber) {
+  if (!mStocks.contains(stockLocate)) return;
+  countBookOp(BookOp::Trade);
+  mTradeBuffers[stockLocate].push({ClockT::now(), Trade{Trade::Kind::Broken, LobT::LevelT{0}, 0, matchNumber}});
+}
+
+void simulator::ItchBooksManager::netOrderImbalance(md::itch::types::locate_t stockLocate, uint64_t pairedShares, uint64_t imbalanceShares, char direction, md::itch::types::price_t farPrice, md::itch::types::price_t nearPrice, md::itch::types::price_t referencePrice, char crossType) {
+  if (!mStocks.contains(stockLocate)) return;
+  countBookOp(BookOp::Imbalance);
+  auto const imbalance = Imbalance{
+      toLevel<LobT::Precision>(farPrice),
+      toLevel<LobT::Precision>(nearPrice),
+      toLevel<LobT::Precision>(referencePrice),
+      static_cast<int64_t>(pairedShares),
+      static_cast<int64_t>(imbalanceShares),
+      direction,
+      crossType};
+  mImbalanceBuffers[stockLocate].push({ClockT::now(), imbalance});
+}
+
+void simulator::ItchBooksManager::resetBooks() {
+  countBookOp(BookOp::Reset);
+  if (mOMS) mOMS->onBooksReset();
+  for (auto& [stockLocate, book] : mBooks) {
+    auto before = book->top();
+    *book = LobT{};
+    if (before != book->top()) publishTop(stockLocate, *book);
+  }
+}
+
+void simulator::ItchBooksManager::publishTop(md::itch::types::locate_t stockLocate, LobT const& book) {
+  if (mMetrics) mMetrics->publish(stockLocate);
+  if (auto const it = mSubscribed.find(stockLocate); it != mSubscribed.end() && !it->second) {
+    it->second = true;
+    mChangedTops.push_back(stockLocate);
+  }
+  if (mRecorder) mRecorder->record(stockLocate, book.top());
+  if (!mPublishLatency) {
+    mTopOfBookBuffers[stockLocate]->push({ClockT::now(), book.top()});
+    return;
   }
+
+  auto const start = lob::rdtsc();
+  mTopOfBookBuffers[stockLocate]->push({ClockT::now(), book.top()});
+  mPublishLatency->record(lob::ticksToNs(lob::rdtsc() - start));
 }
@@ -1,51 +1,194 @@
 #pragma once
 
+#include <lob/LatencyHistogram.h>
 #include <lob/RingBuffer.h>
+#include <lob/Tsc.h>
 #include <lob/lob.h>
 #include <md/itch/types.h>
 
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
 
+#include <format>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Metrics.h"
+#include "NodeLocal.h"
+
 namespace simulator {
 
+class OMS;
+class TopOfBookRecorder;
+
 class ItchBooksManager {
  public:
   using LobT = lob::LimitOrderBook;
-  using TopOfBookBuffer = RingBuffer<std::pair<std::chrono::high_resolution_clock::time_point, LobT::TopOfBook>, 64>;
+  using ClockT = lob::PublishClock;
+  using TopOfBookBuffer = RingBuffer<std::pair<ClockT::time_point, LobT::TopOfBook>, 64>;
+
+  struct Trade {
+    enum class Kind : char {
+      Execution = 'E',  // execution against a displayed order
+      Hidden = 'P',     // execution against a non-displayed order
+      Cross = 'Q',      // opening/closing/halt cross
+      Broken = 'B'      // earlier trade with matchNumber was broken, consumers should reverse it
+    };
+
+    Kind kind = Kind::Execution;
+    LobT::LevelT price{0};
+    int64_t qty = 0;
+    uint64_t matchNumber = 0;
+  };
+
+  struct Imbalance {
+    LobT::LevelT farPrice{0};
+    LobT::LevelT nearPrice{0};
+    LobT::LevelT referencePrice{0};
+    int64_t pairedShares = 0;
+    int64_t imbalanceShares = 0;
+    char direction = 'O';
+    char crossType = 'O';
+  };
+
+  using TradeBuffer = RingBuffer<std::pair<ClockT::time_point, Trade>, 64>;
+  using ImbalanceBuffer = RingBuffer<std::pair<ClockT::time_point, Imbalance>, 16>;
 
   void addOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::BUY_SELL buy, md::itch::types::qty_t qty, md::itch::types::price_t price);
   void deleteOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid);
   void replaceOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::oid_t newOid, md::itch::types::qty_t newQty, md::itch::types::price_t newPrice);
   void reduceOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::qty_t qty);
   void executeOrder(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::qty_t qty);
+  void executeOrderWithPrice(md::itch::types::locate_t stockLocate, md::itch::types::oid_t oid, md::itch::types::qty_t qty, md::itch::types::price_t price, bool printable);
+  void trade(md::itch::types::locate_t stockLocate, md::itch::types::qty_t qty, md::itch::types::price_t price, uint64_t matchNumber);
+  void crossTrade(md::itch::types::locate_t stockLocate, uint64_t shares, md::itch::types::price_t price, uint64_t matchNumber);
+  void brokenTrade(md::itch::types::locate_t stockLocate, uint64_t matchNumber);
+  void netOrderImbalance(md::itch::types::locate_t stockLocate, uint64_t pairedShares, uint64_t imbalanceShares, char direction, md::itch::types::price_t farPrice, md::itch::types::price_t nearPrice, md::itch::types::price_t referencePrice, char crossType);
+
+  // Clears all books at a day boundary. Opt-ins and buffers are kept so consumers see an empty top
+  // of book followed by the next day's updates.
+  void resetBooks();
 
   [[nodiscard]] auto& bookById(int id) {
     optIn(id);
-    return mBooks[id];
+    return *mBooks[id];
   }
 
   [[nodiscard]] auto const& bookById(int id) const {
-    return mBooks.at(id);
+    return *mBooks.at(id);
   }
 
   [[nodiscard]] auto& bufferById(int id) {
     optIn(id);
-    return mTopOfBookBuffers[id];
+    return *mTopOfBookBuffers[id];
   }
 
   [[nodiscard]] auto const& bufferById(int id) const {
-    return mTopOfBookBuffers.at(id);
+    return *mTopOfBookBuffers.at(id);
+  }
+
+  [[nodiscard]] auto& tradeBufferById(int id) {
+    optIn(id);
+    return mTradeBuffers[id];
+  }
+
+  [[nodiscard]] auto const& tradeBufferById(int id) const {
+    return mTradeBuffers.at(id);
+  }
+
+  [[nodiscard]] auto& imbalanceBufferById(int id) {
+    optIn(id);
+    return mImbalanceBuffers[id];
+  }
+
+  [[nodiscard]] auto const& imbalanceBufferById(int id) const {
+    return mImbalanceBuffers.at(id);
   }
 
   void optIn(int id) {
     mStocks.insert(id);
   }
 
+  // messages of other symbols are ignored, so decoders can skip them
+  [[nodiscard]] bool optedIn(md::itch::types::locate_t id) const noexcept {
+    return mStocks.contains(id);
+  }
+
+  // Unlike bookById, never opts in: a symbol opted into mid-day would get messages for orders its
+  // book never saw.
+  [[nodiscard]] LobT& optedInBook(int id) {
+    if (!optedIn(id)) throw std::out_of_range(std::format("Symbol {} is not opted in", id));
+    return *mBooks[id];
+  }
+
+  // Top of book changes of subscribed symbols are collected until taken, so a simulation run can
+  // stop on them.
+  void subscribe(int id) {
+    optIn(id);
+    mSubscribed.try_emplace(id, false);
+  }
+
+  [[nodiscard]] bool topsChanged() const noexcept {
+    return !mChangedTops.empty();
+  }
+
+  // Calls f(id, book) for the subscribed symbols whose top changed since the last call, in the
+  // order they first changed.
+  template <class F>
+  void takeChangedTops(F&& f) {
+    for (auto const id : mChangedTops) {
+      mSubscribed[id] = false;
+      f(id, std::as_const(*mBooks[id]));
+    }
+    mChangedTops.clear();
+  }
+
+  // Publishes are only timed while a histogram is set. nullptr turns timing off.
+  void setPublishLatency(lob::LatencyHistogram* latency) noexcept {
+    mPublishLatency = latency;
+  }
+
+  // Counters of the thread applying the messages, nullptr to not count. Also used by the decoder
+  // feeding this manager, which runs on the same thread.
+  void setMetrics(ThreadMetrics* metrics) noexcept {
+    mMetrics = metrics;
+  }
+
+  [[nodiscard]] ThreadMetrics* metrics() const noexcept {
+    return mMetrics;
+  }
+
+  // Executions are reported to the OMS to fill its resting orders, nullptr for none. Set by
+  // OMS::connect.
+  void setOMS(OMS* oms) noexcept {
+    mOMS = oms;
+  }
+
+  // Every published top of book is also written to the recorder, nullptr to not record.
+  void setRecorder(TopOfBookRecorder* recorder) noexcept {
+    mRecorder = recorder;
+  }
+
  private:
-  boost::unordered_map<int, LobT> mBooks;
-  boost::unordered_map<int, TopOfBookBuffer> mTopOfBookBuffers;
+  void publishTop(md::itch::types::locate_t stockLocate, LobT const& book);
+
+  void countBookOp(BookOp op) noexcept {
+    if (mMetrics) mMetrics->bookOp(op);
+  }
+
+  // in pages of their own, placed on the node of the thread that first looks them up
+  boost::unordered_map<int, NodeLocal<LobT>> mBooks;
+  boost::unordered_map<int, NodeLocal<TopOfBookBuffer>> mTopOfBookBuffers;
+  boost::unordered_map<int, TradeBuffer> mTradeBuffers;
+  boost::unordered_map<int, ImbalanceBuffer> mImbalanceBuffers;
   boost::unordered_set<md::itch::types::locate_t> mStocks;
+  boost::unordered_map<int, bool> mSubscribed;  // whether in mChangedTops
+  std::vector<int> mChangedTops;
+  lob::LatencyHistogram* mPublishLatency = nullptr;
+  ThreadMetrics* mMetrics = nullptr;
+  OMS* mOMS = nullptr;
+  TopOfBookRecorder* mRecorder = nullptr;
 };
 
 }  // namespace simulator
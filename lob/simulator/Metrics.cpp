@@ -0,0 +1,115 @@
+#include "Metrics.h"
+
+#include <logger/Logger.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+
+namespace {
+
+nlohmann::json toJson(simulator::MetricsSnapshot const& curr, simulator::MetricsSnapshot const& prev, std::chrono::steady_clock::time_point start) {
+  auto const seconds = std::chrono::duration<double>(curr.time - prev.time).count();
+  auto const rate = [seconds](uint64_t c, uint64_t p) { return seconds > 0 ? static_cast<double>(c - p) / seconds : 0.0; };
+
+  auto messages = nlohmann::json::object();
+  for (size_t type = 0; type != curr.messagesByType.size(); ++type) {
+    if (curr.messagesByType[type]) messages[std::string(1, static_cast<char>(type))] = curr.messagesByType[type];
+  }
+
+  auto bookOps = nlohmann::json::object();
+  for (size_t op = 0; op != simulator::NumBookOps; ++op) {
+    bookOps[simulator::BookOpNames[op]] = curr.bookOps[op];
+  }
+
+  auto publishes = nlohmann::json::object();
+  for (size_t locate = 0; locate != curr.publishesBySymbol.size(); ++locate) {
+    if (curr.publishesBySymbol[locate]) publishes[std::to_string(locate)] = curr.publishesBySymbol[locate];
+  }
+
+  auto const sum = [](auto const& counts) { return std::accumulate(counts.begin(), counts.end(), uint64_t(0)); };
+
+  return {
+      {"elapsed_seconds", std::chrono::duration<double>(curr.time - start).count()},
+      {"messages", curr.messages()},
+      {"messages_per_second", rate(curr.messages(), prev.messages())},
+      {"messages_by_type", messages},
+      {"book_ops", bookOps},
+      {"book_ops_per_second", rate(sum(curr.bookOps), sum(prev.bookOps))},
+      {"publishes", curr.publishes()},
+      {"publishes_per_second", rate(curr.publishes(), prev.publishes())},
+      {"publishes_by_symbol", publishes},
+      {"ring_overruns", curr.ringOverruns},
+      {"ring_overruns_per_second", rate(curr.ringOverruns, prev.ringOverruns)},
+      {"logger_drops", curr.loggerDrops},
+      {"strategy_callbacks", curr.strategyCallbacks},
+      {"strategy_callbacks_per_second", rate(curr.strategyCallbacks, prev.strategyCallbacks)}};
+}
+
+void write(std::filesystem::path const& path, nlohmann::json const& snapshot) {
+  auto tmp = path;
+  tmp += ".tmp";
+  {
+    auto out = std::ofstream(tmp);
+    if (!out) return;
+    out << snapshot.dump(2) << std::endl;
+  }
+  auto ec = std::error_code{};
+  std::filesystem::rename(tmp, path, ec);
+}
+
+}  // namespace
+
+uint64_t simulator::MetricsSnapshot::messages() const noexcept {
+  return std::accumulate(messagesByType.begin(), messagesByType.end(), uint64_t(0));
+}
+
+uint64_t simulator::MetricsSnapshot::publishes() const noexcept {
+  return std::accumulate(publishesBySymbol.begin(), publishesBySymbol.end(), uint64_t(0));
+}
+
+simulator::ThreadMetrics& simulator::MetricsRegistry::add(std::string name, size_t numSymbols) {
+  auto lock = std::scoped_lock(mMutex);
+  return *mThreads.emplace_back(std::make_unique<ThreadMetrics>(std::move(name), numSymbols));
+}
+
+simulator::MetricsSnapshot simulator::MetricsRegistry::snapshot() const {
+  auto snapshot = MetricsSnapshot{std::chrono::steady_clock::now()};
+  auto lock = std::scoped_lock(mMutex);
+  for (auto const& thread : mThreads) {
+    for (size_t i = 0; i != thread->messagesByType.size(); ++i) {
+      snapshot.messagesByType[i] += thread->messagesByType[i].load();
+    }
+    for (size_t i = 0; i != NumBookOps; ++i) {
+      snapshot.bookOps[i] += thread->bookOps[i].load();
+    }
+    if (snapshot.publishesBySymbol.size() < thread->publishesBySymbol.size()) snapshot.publishesBySymbol.resize(thread->publishesBySymbol.size());
+    for (size_t i = 0; i != thread->publishesBySymbol.size(); ++i) {
+      snapshot.publishesBySymbol[i] += thread->publishesBySymbol[i].load();
+    }
+    snapshot.ringOverruns += thread->ringOverruns.load();
+    snapshot.strategyCallbacks += thread->strategyCallbacks.load();
+  }
+  if (mLogger) snapshot.loggerDrops = mLogger->numDropped();
+  return snapshot;
+}
+
+simulator::MetricsSampler::MetricsSampler(MetricsRegistry const& registry, std::filesystem::path path, std::chrono::milliseconds interval)
+    : mThread([&registry, path = std::move(path), interval](std::stop_token stopToken) {
+        auto mutex = std::mutex{};
+        auto cv = std::condition_variable_any{};
+        auto const start = std::chrono::steady_clock::now();
+        auto prev = registry.snapshot();
+        while (!stopToken.stop_requested()) {
+          {
+            auto lock = std::unique_lock(mutex);
+            cv.wait_for(lock, stopToken, interval, [] { return false; });
+          }
+          // a last snapshot is written on stop, so the file ends with the totals of the run
+          auto curr = registry.snapshot();
+          write(path, toJson(curr, prev, start));
+          prev = std::move(curr);
+        }
+      }) {}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logging {
+class Logger;
+}
+
+namespace simulator {
+
+inline constexpr size_t CacheLineSize = 64;
+
+// Counter with a single writer. The increment is a relaxed load and store rather than a locked
+// read-modify-write, so it costs the same as a plain add; other threads read it with relaxed loads.
+class RelaxedCounter {
+ public:
+  void add(uint64_t n = 1) noexcept {
+    mValue.store(mValue.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] uint64_t load() const noexcept {
+    return mValue.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> mValue = 0;
+};
+
+enum class BookOp : uint8_t {
+  Add,
+  Delete,
+  Replace,
+  Reduce,
+  Execute,
+  Trade,
+  Imbalance,
+  Reset,
+  Count
+};
+
+inline constexpr size_t NumBookOps = static_cast<size_t>(BookOp::Count);
+inline constexpr auto BookOpNames = std::array<char const*, NumBookOps>{"add", "delete", "replace", "reduce", "execute", "trade", "imbalance", "reset"};
+
+// Counters of one thread, only ever written by that thread. Cache line aligned so that no two
+// threads write to the same line.
+struct alignas(CacheLineSize) ThreadMetrics {
+  ThreadMetrics(std::string name, size_t numSymbols) : name(std::move(name)), publishesBySymbol(numSymbols) {}
+
+  std::string name;
+  std::array<RelaxedCounter, 256> messagesByType;  // decoded ITCH messages, by message type
+  std::array<RelaxedCounter, NumBookOps> bookOps;
+  std::vector<RelaxedCounter> publishesBySymbol;   // top of book publishes, by stock locate
+  RelaxedCounter ringOverruns;                     // top of book updates overwritten before being read
+  RelaxedCounter strategyCallbacks;
+
+  void bookOp(BookOp op) noexcept {
+    bookOps[static_cast<size_t>(op)].add();
+  }
+
+  void publish(size_t stockLocate) noexcept {
+    if (stockLocate < publishesBySymbol.size()) publishesBySymbol[stockLocate].add();
+  }
+};
+
+// Totals over all threads at one point in time.
+struct MetricsSnapshot {
+  std::chrono::steady_clock::time_point time = {};
+  std::array<uint64_t, 256> messagesByType = {};
+  std::array<uint64_t, NumBookOps> bookOps = {};
+  std::vector<uint64_t> publishesBySymbol = {};
+  uint64_t ringOverruns = 0;
+  uint64_t loggerDrops = 0;
+  uint64_t strategyCallbacks = 0;
+
+  [[nodiscard]] uint64_t messages() const noexcept;
+  [[nodiscard]] uint64_t publishes() const noexcept;
+};
+
+// Owns the counters of every thread taking part in a run. Threads register once before their
+// loop starts and keep the reference; registration is the only locked operation.
+class MetricsRegistry {
+ public:
+  // numSymbols is the number of per symbol publish counters; only the publishing thread needs them.
+  [[nodiscard]] ThreadMetrics& add(std::string name, size_t numSymbols = 0);
+
+  void setLogger(logging::Logger const* logger) noexcept {
+    mLogger = logger;
+  }
+
+  [[nodiscard]] MetricsSnapshot snapshot() const;
+
+ private:
+  mutable std::mutex mMutex;
+  std::vector<std::unique_ptr<ThreadMetrics>> mThreads;
+  logging::Logger const* mLogger = nullptr;
+};
+
+// Every interval, writes the totals and rates since the previous snapshot as JSON to path. The
+// file is written next to path and renamed over it, so a tool polling it never sees a partial
+// snapshot. The hot threads are never touched, the sampler only reads their counters.
+class MetricsSampler {
+ public:
+  MetricsSampler(MetricsRegistry const& registry, std::filesystem::path path, std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+  MetricsSampler(MetricsSampler const&) = delete;
+  MetricsSampler& operator=(MetricsSampler const&) = delete;
+
+ private:
+  std::jthread mThread;
+};
+
+}  // namespace simulator
@@ -0,0 +1,47 @@
+#include "NodeLocal.h"
+
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+size_t pageSize() noexcept {
+#ifndef _WIN32
+  static auto const size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+#else
+  return 4096;
+#endif
+}
+
+size_t roundUpToPages(size_t size) noexcept {
+  return (size + pageSize() - 1) / pageSize() * pageSize();
+}
+
+}  // namespace
+
+void* simulator::detail::allocateTouchedPages(size_t size) {
+  auto const length = roundUpToPages(size);
+#ifndef _WIN32
+  auto* const pages = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pages == MAP_FAILED) throw std::bad_alloc();
+#else
+  auto* const pages = ::operator new(length, std::align_val_t(pageSize()));
+#endif
+  // the first write faults each page in, on the node of the CPU taking the fault
+  for (size_t offset = 0; offset < length; offset += pageSize()) static_cast<char volatile*>(pages)[offset] = 0;
+  return pages;
+}
+
+void simulator::detail::freePages(void* pages, size_t size) noexcept {
+#ifndef _WIN32
+  munmap(pages, roundUpToPages(size));
+#else
+  static_cast<void>(size);
+  ::operator delete(pages, std::align_val_t(pageSize()));
+#endif
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace simulator {
+
+namespace detail {
+
+// Whole pages for size bytes, mapped and written to by the calling thread. Throws std::bad_alloc.
+[[nodiscard]] void* allocateTouchedPages(size_t size);
+void freePages(void* pages, size_t size) noexcept;
+
+}  // namespace detail
+
+// A T in pages of its own, mapped and first touched by the thread constructing it, so the kernel's
+// default local policy puts it on that thread's node. Heap memory doesn't promise that: malloc
+// hands out chunks from arenas shared between threads, already touched by whoever used them
+// before. What T allocates itself still comes from the heap.
+template <class T>
+class NodeLocal {
+ public:
+  NodeLocal() : mValue(static_cast<T*>(detail::allocateTouchedPages(sizeof(T)))) {
+    try {
+      std::construct_at(mValue);
+    } catch (...) {
+      detail::freePages(mValue, sizeof(T));
+      throw;
+    }
+  }
+
+  ~NodeLocal() {
+    if (!mValue) return;
+    std::destroy_at(mValue);
+    detail::freePages(mValue, sizeof(T));
+  }
+
+  NodeLocal(NodeLocal const&) = delete;
+  NodeLocal& operator=(NodeLocal const&) = delete;
+
+  // the value stays where it is; the moved from holder is empty
+  NodeLocal(NodeLocal&& other) noexcept : mValue(std::exchange(other.mValue, nullptr)) {}
+
+  NodeLocal& operator=(NodeLocal&& other) noexcept {
+    std::swap(mValue, other.mValue);
+    return *this;
+  }
+
+  [[nodiscard]] T& operator*() noexcept {
+    return *mValue;
+  }
+
+  [[nodiscard]] T const& operator*() const noexcept {
+    return *mValue;
+  }
+
+  [[nodiscard]] T* operator->() noexcept {
+    return mValue;
+  }
+
+  [[nodiscard]] T const* operator->() const noexcept {
+    return mValue;
+  }
+
+ private:
+  T* mValue;
+};
+
+}  // namespace simulator
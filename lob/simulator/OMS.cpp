@@ -0,0 +1,196 @@
+#include "OMS.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <thread>
+
+#include "ItchBooksManager.h"
+#include "Simulator.h"
+
+simulator::OMS::OMS(OMSOptions options)
+    : mOptions(options), mInbox(options.inboxSize, logging::FullPolicy::DropNewest), mClients(options.maxClients) {}
+
+void simulator::OMS::connect(Simulator& simulator, ItchBooksManager& bmgr) {
+  mSimulatorThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  mSimulator = &simulator;
+  mBooks = &bmgr;
+  bmgr.setOMS(this);
+}
+
+simulator::OMS::ClientId simulator::OMS::addClient() {
+  auto const client = mNumClients.fetch_add(1, std::memory_order_relaxed);
+  if (client >= mClients.size()) throw std::runtime_error(std::format("OMS: more than {} clients", mClients.size()));
+  // published to the simulator thread by the client's first request
+  mClients[client] = std::make_unique<Client>(mOptions.eventQueueSize);
+  return client;
+}
+
+simulator::OMS::OrderId simulator::OMS::limitOrder(ClientId client, int symbolId, lob::Direction direction, int qty, LevelT price) {
+  auto const orderId = mNextOrderId.fetch_add(1, std::memory_order_relaxed);
+  send({OrderType::Limit, client, orderId, symbolId, direction, qty, price});
+  return orderId;
+}
+
+simulator::OMS::OrderId simulator::OMS::marketOrder(ClientId client, int symbolId, lob::Direction direction, int qty) {
+  auto const orderId = mNextOrderId.fetch_add(1, std::memory_order_relaxed);
+  send({OrderType::Market, client, orderId, symbolId, direction, qty, LevelT{0}});
+  return orderId;
+}
+
+void simulator::OMS::cancel(ClientId client, OrderId orderId) {
+  send({OrderType::Cancel, client, orderId});
+}
+
+void simulator::OMS::send(Request const& request) {
+  // Full: the simulator thread, sending from a strategy it runs itself, would wait for itself, so it
+  // picks the requests up now, on the same clock as after the step. Other threads wait for it.
+  while (!mInbox.push([&request](Request& slot) { slot = request; })) {
+    if (mSimulatorThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) processRequests();
+    else std::this_thread::yield();
+  }
+  mNumSent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void simulator::OMS::processRequests() {
+  mSimulatorThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  auto const arrival = mSimulator->now() + mOptions.latency;
+  auto const process = [this, arrival](Request const& request) {
+    // the events capture no more than the order id, so they fit std::function's small buffer
+    if (request.type == OrderType::Cancel) {
+      if (request.orderId < mOrders.size() && mOrders[request.orderId].client == request.client) {
+        mSimulator->addSimulationEvent({arrival, [this, orderId = request.orderId] { arriveCancel(orderId); }});
+      }
+      return;
+    }
+    if (request.orderId >= mOrders.size()) mOrders.resize(request.orderId + 1);
+    mOrders[request.orderId] = {request.client, request.symbolId, request.type, Status::Pending, false, request.direction, request.price, request.qty};
+    mSimulator->addSimulationEvent({arrival, [this, orderId = request.orderId] { arrive(orderId); }});
+  };
+  while (mInbox.pop(process)) ++mNumProcessed;
+}
+
+void simulator::OMS::arrive(OrderId orderId) {
+  auto& order = mOrders[orderId];
+  // there is no book to match against, and opting in now would break the replay of the symbol
+  if (!mBooks->optedIn(order.symbolId)) {
+    auto const qty = order.leaves;
+    order.leaves = 0;
+    order.status = Status::Done;
+    report(orderId, OrderEvent::Kind::Expired, order.price, qty);
+    return;
+  }
+  auto& book = mBooks->optedInBook(order.symbolId);
+
+  // take the liquidity on the other side, best price first
+  auto const crosses = [&order](LevelT level) {
+    if (order.type == OrderType::Market) return true;
+    return order.direction == lob::Direction::Buy ? level <= order.price : level >= order.price;
+  };
+  auto const opposite = order.direction == lob::Direction::Buy ? lob::Direction::Sell : lob::Direction::Buy;
+  book.forEachLevel(opposite, [&](LevelT level, int depth) {
+    if (!crosses(level)) return false;
+    fill(orderId, level, std::min(order.leaves, depth));
+    return order.leaves != 0;
+  });
+
+  if (order.leaves == 0) return;
+  if (order.type == OrderType::Market || order.cancelRequested) {
+    auto const qty = order.leaves;
+    order.leaves = 0;
+    order.status = Status::Done;
+    report(orderId, order.type == OrderType::Market ? OrderEvent::Kind::Expired : OrderEvent::Kind::Cancelled, order.price, qty);
+    return;
+  }
+
+  // joins the back of the queue at its level
+  order.status = Status::Resting;
+  book.addVirtualOrder(orderId, order.direction, order.price);
+  if (mResting.size() <= static_cast<size_t>(order.symbolId)) mResting.resize(order.symbolId + 1);
+  mResting[order.symbolId].insert(orderId);
+}
+
+void simulator::OMS::arriveCancel(OrderId orderId) {
+  auto& order = mOrders[orderId];
+  switch (order.status) {
+    case Status::Pending:
+      // sent after the order but arrived first, the order is cancelled once it has matched
+      order.cancelRequested = true;
+      break;
+    case Status::Resting: {
+      auto const qty = order.leaves;
+      order.leaves = 0;
+      order.status = Status::Done;
+      report(orderId, OrderEvent::Kind::Cancelled, order.price, qty);
+      removeResting(orderId);
+      break;
+    }
+    case Status::Done:
+      break;
+  }
+}
+
+void simulator::OMS::matchExecution(lob::LimitOrderBook const& book, lob::OrderId orderId, int qty) {
+  auto const level = book.orderLevel(orderId);
+  if (!level) return;
+  auto const direction = *book.orderDirection(orderId);
+
+  // The executed quantity goes to the resting orders that would have been executed before the real
+  // one, in the order they would have been: those at better prices, which the other side went
+  // through, then those that joined the level before it.
+  auto remaining = qty;
+  auto filled = std::vector<OrderId>();
+  auto const take = [&](lob::LimitOrderBook::VirtualOrderId id) {
+    auto const& order = mOrders[id];
+    auto const fillQty = std::min(order.leaves, remaining);
+    fill(static_cast<OrderId>(id), order.price, fillQty);
+    remaining -= fillQty;
+    if (order.status == Status::Done) filled.push_back(static_cast<OrderId>(id));
+    return remaining != 0;
+  };
+  book.forEachVirtualOrderThrough(direction, *level, take);
+  if (remaining != 0) book.forEachVirtualOrderAhead(orderId, take);
+
+  // not while the book's queues were being visited
+  for (auto const id : filled) removeResting(id);
+}
+
+void simulator::OMS::onBooksReset() {
+  for (auto& resting : mResting) {
+    for (auto const orderId : resting) {
+      auto& order = mOrders[orderId];
+      auto const qty = order.leaves;
+      order.leaves = 0;
+      order.status = Status::Done;
+      report(orderId, OrderEvent::Kind::Expired, order.price, qty);
+    }
+    resting.clear();
+  }
+}
+
+void simulator::OMS::fill(OrderId orderId, LevelT price, int qty) {
+  auto& order = mOrders[orderId];
+  order.leaves -= qty;
+  if (order.leaves == 0) order.status = Status::Done;
+  ++mNumFills;
+  report(orderId, OrderEvent::Kind::Fill, price, qty);
+}
+
+void simulator::OMS::report(OrderId orderId, OrderEvent::Kind kind, LevelT price, int qty) {
+  auto const& order = mOrders[orderId];
+  auto const event = OrderEvent{kind, orderId, order.symbolId, order.direction, price, qty, order.leaves, mSimulator->now()};
+  auto& client = *mClients[order.client];
+  while (!client.events.push([&event](OrderEvent& slot) { slot = event; })) {
+    // a client polling on this thread cannot poll before this returns
+    if (client.poller.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+      throw std::runtime_error(std::format("OMS: {} events of client {} not polled, poll between steps or raise eventQueueSize", client.events.capacity(), order.client));
+    }
+    std::this_thread::yield();
+  }
+}
+
+void simulator::OMS::removeResting(OrderId orderId) {
+  auto const symbolId = mOrders[orderId].symbolId;
+  mBooks->optedInBook(symbolId).deleteVirtualOrder(orderId);
+  mResting[symbolId].erase(orderId);
+}
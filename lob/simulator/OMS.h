@@ -1,16 +1,199 @@
 #pragma once
 
-#include <print>
+#include <lob/lob.h>
+#include <logger/MpscQueue.h>
+
+#include <boost/unordered_set.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
 
 namespace simulator {
 
+class ItchBooksManager;
+class Simulator;
+
+struct OMSOptions {
+  // from a strategy sending an order or cancel to it taking effect at the exchange
+  std::chrono::nanoseconds latency = std::chrono::microseconds(50);
+  // Orders and cancels sent but not yet picked up by the simulator. When it is full, senders on
+  // other threads wait and one on the simulator thread picks them up itself.
+  size_t inboxSize = 1 << 16;
+  // Order events per client not yet polled. When one is full, the simulator waits for the client on
+  // another thread and throws if the client polls on the simulator thread, which would never poll.
+  size_t eventQueueSize = 1 << 14;
+  size_t maxClients = 256;
+};
+
+// What happened to an order, reported to the client that sent it.
+struct OrderEvent {
+  enum class Kind : uint8_t {
+    Fill,       // qty filled at price
+    Cancelled,  // qty cancelled on request
+    Expired     // qty of a market order found no liquidity, was resting at the end of the day, or
+                // was for a symbol whose book is not replayed
+  };
+
+  Kind kind = Kind::Fill;
+  uint32_t orderId = 0;
+  int symbolId = 0;
+  lob::Direction direction = lob::Direction::Buy;
+  lob::LimitOrderBook::LevelT price{0};
+  int qty = 0;
+  int leaves = 0;                         // still open after the event
+  std::chrono::nanoseconds timestamp{0};  // simulation time
+};
+
+// Simulated exchange for strategy orders. Orders are sent from any thread into an inbox, which the
+// simulator thread drains with processRequests; each order then takes effect as a simulation event
+// latency later. On arrival an order takes the visible liquidity of the reconstructed book up to its
+// price and what is left of a limit order rests at its price, as a virtual order of the book. The
+// book tracks the real quantity ahead of it as real orders ahead are cancelled or executed; once a
+// real order that joined the level after it executes, it would have executed first and is filled.
+// An execution at a worse price on its side fills it regardless. An execution fills no more than its
+// quantity in all, better prices first, then in queue order.
+//
+// The replayed book is not changed by simulated orders: liquidity they take is still there for the
+// next order, and the remainder of a limit order that crossed the book only fills once real
+// executions reach it.
+//
+// Events go to a queue per client, which the client polls on its own thread.
 class OMS {
-public:
-    void limitOrder() noexcept {
-        std::println("Limit order");
-    }
-private:
+ public:
+  using LevelT = lob::LimitOrderBook::LevelT;
+  using OrderId = uint32_t;
+  using ClientId = uint32_t;
+
+  explicit OMS(OMSOptions options = {});
+
+  OMS(OMS const&) = delete;
+  OMS& operator=(OMS const&) = delete;
+
+  // Orders take effect on this simulator's clock and match against this manager's books, which
+  // report their changes back. Call before the replay starts.
+  void connect(Simulator& simulator, ItchBooksManager& bmgr);
+
+  // Thread safe. Every strategy registers once, on the thread it polls from, and sends its id with
+  // its orders.
+  [[nodiscard]] ClientId addClient();
+
+  // Thread safe.
+  OrderId limitOrder(ClientId client, int symbolId, lob::Direction direction, int qty, LevelT price);
+  OrderId marketOrder(ClientId client, int symbolId, lob::Direction direction, int qty);
+  void cancel(ClientId client, OrderId orderId);
+
+  // On the client's thread: calls f(OrderEvent const&) for the events since the last call.
+  template <class F>
+  size_t pollEvents(ClientId client, F&& f) {
+    auto& state = *mClients[client];
+    state.poller.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    size_t n = 0;
+    while (state.events.pop([&f](OrderEvent const& event) { f(event); })) ++n;
+    return n;
+  }
+
+  // Simulator thread: schedules the orders and cancels sent since the last call at now + latency.
+  void processRequests();
+
+  // Simulator thread: whether processRequests has anything to pick up. Cheap enough to check after
+  // every market data event.
+  [[nodiscard]] bool hasRequests() const noexcept {
+    return mNumSent.load(std::memory_order_relaxed) != mNumProcessed;
+  }
+
+  // Simulator thread, from the books manager before the real order executes. Fills no more than qty
+  // in all, visiting only the resting orders it fills and so cheap however many rest.
+  void onExecute(int symbolId, lob::LimitOrderBook const& book, lob::OrderId orderId, int qty) {
+    if (hasResting(symbolId)) matchExecution(book, orderId, qty);
+  }
+
+  // resting orders do not carry over to the next day
+  void onBooksReset();
+
+  [[nodiscard]] size_t numOrders() const noexcept {
+    return mNextOrderId.load(std::memory_order_relaxed);
+  }
+
+  // simulator thread
+  [[nodiscard]] uint64_t numFills() const noexcept {
+    return mNumFills;
+  }
+
+ private:
+  enum class OrderType : uint8_t {
+    Limit,
+    Market,
+    Cancel
+  };
+
+  struct Request {
+    OrderType type = OrderType::Limit;
+    ClientId client = 0;
+    OrderId orderId = 0;
+    int symbolId = 0;
+    lob::Direction direction = lob::Direction::Buy;
+    int qty = 0;
+    LevelT price{0};
+  };
+
+  enum class Status : uint8_t {
+    Pending,  // sent, not yet arrived
+    Resting,
+    Done
+  };
+
+  struct Order {
+    ClientId client = 0;
+    int symbolId = 0;
+    OrderType type = OrderType::Limit;
+    Status status = Status::Pending;
+    bool cancelRequested = false;
+    lob::Direction direction = lob::Direction::Buy;
+    LevelT price{0};
+    int leaves = 0;
+  };
+
+  // The queues never block in push: a full queue is handled by the OMS, which knows whether the
+  // thread pushing is the one that would empty it.
+  struct Client {
+    explicit Client(size_t eventQueueSize) : events(eventQueueSize, logging::FullPolicy::DropNewest) {}
+
+    logging::MpscQueue<OrderEvent> events;
+    std::atomic<std::thread::id> poller = std::this_thread::get_id();  // last thread to poll
+  };
+
+  [[nodiscard]] bool hasResting(int symbolId) const noexcept {
+    return static_cast<size_t>(symbolId) < mResting.size() && !mResting[symbolId].empty();
+  }
+
+  void send(Request const& request);
+  void arrive(OrderId orderId);
+  void arriveCancel(OrderId orderId);
+  void matchExecution(lob::LimitOrderBook const& book, lob::OrderId orderId, int qty);
+  void fill(OrderId orderId, LevelT price, int qty);
+  void report(OrderId orderId, OrderEvent::Kind kind, LevelT price, int qty);
+  void removeResting(OrderId orderId);
+
+  OMSOptions mOptions;
+  Simulator* mSimulator = nullptr;
+  ItchBooksManager* mBooks = nullptr;
+
+  logging::MpscQueue<Request> mInbox;
+  std::atomic<std::thread::id> mSimulatorThread;  // connecting, then last processing requests
+  std::vector<std::unique_ptr<Client>> mClients;
+  std::atomic<ClientId> mNumClients = 0;
+  std::atomic<OrderId> mNextOrderId = 0;
+  std::atomic<uint64_t> mNumSent = 0;
 
+  // simulator thread only
+  std::vector<Order> mOrders;                  // by order id
+  std::vector<boost::unordered_set<OrderId>> mResting;  // by symbol id, matched through the book's queues
+  uint64_t mNumFills = 0;
+  uint64_t mNumProcessed = 0;
 };
 
-}
+}  // namespace simulator
@@ -10,10 +10,9 @@
 #undef max
 #undef ERROR
 
-template <DWORD CoreId>
-inline void pin_to_core() {
+inline void pin_to_core(int coreId) {
   HANDLE thread = GetCurrentThread();
-  DWORD_PTR mask = 1 << CoreId;
+  DWORD_PTR mask = DWORD_PTR(1) << coreId;
   DWORD_PTR result = SetThreadAffinityMask(thread, mask);
   if (result == 0)
     throw std::runtime_error(std::string() + "Failed to set thread affinity. Last error code: " + std::to_string(GetLastError()));
@@ -23,11 +22,10 @@ inline void pin_to_core() {
 
 #include <pthread.h>
 
-template <int CoreId>
-inline void pin_to_core() {
+inline void pin_to_core(int coreId) {
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
-  CPU_SET(CoreId, &cpuset);
+  CPU_SET(coreId, &cpuset);
 
   pthread_t currentThread = pthread_self();
   int result = pthread_setaffinity_np(currentThread, sizeof(cpu_set_t), &cpuset);
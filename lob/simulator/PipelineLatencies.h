@@ -0,0 +1,31 @@
+#pragma once
+
+#include <lob/LatencyHistogram.h>
+
+#include <format>
+#include <string>
+
+namespace simulator {
+
+// Latencies in ns at the stages of the replay pipeline. Each stage is recorded by the thread that
+// runs it; strategy threads keep theirs in StrategyDiagnostics and are merged in afterwards.
+struct PipelineLatencies {
+  lob::LatencyHistogram decode;           // reading the next book message
+  lob::LatencyHistogram bookApply;        // applying it to the book, including the publish
+  lob::LatencyHistogram publish;          // pushing a changed top of book into its buffer
+  lob::LatencyHistogram strategyReceive;  // from publish until a strategy reads the update
+
+  void merge(PipelineLatencies const& other) noexcept {
+    decode.merge(other.decode);
+    bookApply.merge(other.bookApply);
+    publish.merge(other.publish);
+    strategyReceive.merge(other.strategyReceive);
+  }
+
+  [[nodiscard]] std::string toString() const {
+    return std::format("decode:           {}\nbook apply:       {}\npublish:          {}\nstrategy receive: {}",
+                       decode.summary(), bookApply.summary(), publish.summary(), strategyReceive.summary());
+  }
+};
+
+}  // namespace simulator
@@ -1,6 +1,5 @@
 #include "Simulator.h"
 
-#include <optional>
 #include <print>
 
 namespace {
@@ -29,23 +28,17 @@ simulator::Simulator::Simulator(std::function<EventT()> requestMarketDataEvent)
     : mRequestMarketDataEvent(std::move(requestMarketDataEvent)),
       mNextMarketDataEvent(mRequestMarketDataEvent()) {}
 
-void simulator::Simulator::addSimulationEvent(EventT event) {
-  mNextStrategyEvents.emplace(std::move(event));
+simulator::Simulator::EventHandle simulator::Simulator::addSimulationEvent(EventT event) {
+  return mStrategyEvents.schedule(static_cast<uint64_t>(event.first.count()), std::move(event.second));
+}
+
+bool simulator::Simulator::cancelSimulationEvent(EventHandle handle) {
+  return mStrategyEvents.cancel(handle);
 }
 
 simulator::Simulator::TimestampT simulator::Simulator::step() {
-  auto const marketDataTimestamp = mNextMarketDataEvent.first;
-  auto strategyTimestamp = mNextStrategyEvents.empty() ? std::optional<TimestampT>{} : mNextStrategyEvents.top().first;
-
-  if (!strategyTimestamp || marketDataTimestamp < *strategyTimestamp) {
-    //std::print("{} (M): ", toString(marketDataTimestamp));
-    mNextMarketDataEvent.second();
-    mNextMarketDataEvent = mRequestMarketDataEvent();
-    return marketDataTimestamp;
-  } else {
-    //std::print("{} (S):  ", toString(*strategyTimestamp));
-    mNextStrategyEvents.top().second();
-    mNextStrategyEvents.pop();
-    return *strategyTimestamp;
-  }
+  runSimulationEvents(mNextMarketDataEvent.first);
+  //std::print("{} (M): ", toString(mNextMarketDataEvent.first));
+  runMarketDataEvent();
+  return mNow;
 }
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <queue>
-#include <vector>
+#include <limits>
+#include <utility>
+
+#include "TimingWheel.h"
 
 namespace simulator {
 
@@ -11,21 +16,90 @@ class Simulator {
  public:
   using TimestampT = std::chrono::nanoseconds;
   using EventT = std::pair<TimestampT, std::function<void()>>;
+  using EventHandle = TimingWheel<std::function<void()>>::Handle;
+
+  enum class StopReason : uint8_t {
+    Until,             // the next event is after the given timestamp
+    NumEvents,         // the given number of market data events ran
+    SimulationEvents,  // simulation events ran, the market data event due after them did not yet
+    Stopped            // the stop predicate returned true
+  };
+
+  struct RunResult {
+    size_t numEvents = 0;  // market data events run
+    TimestampT timestamp{0};
+    StopReason reason = StopReason::Until;
+  };
+
+  struct NeverStop {
+    [[nodiscard]] constexpr bool operator()() const noexcept {
+      return false;
+    }
+  };
 
   explicit Simulator(std::function<EventT()> requestMarketDataEvent);
-  void addSimulationEvent(EventT event);
+  EventHandle addSimulationEvent(EventT event);
+
+  // False if the event already ran or was cancelled.
+  bool cancelSimulationEvent(EventHandle handle);
+
+  // Runs the simulation events due up to the next market data event, as one batch, then that
+  // event. Returns its timestamp.
   TimestampT step();
 
+  // Run market data events back to back, for callers to act between runs instead of after every
+  // event. A run ends before the next event would be after until, after numEvents market data
+  // events, after a batch of simulation events, so their effects are seen before the market moves
+  // on, or once stop() returns true; it is called after every market data event and typically
+  // checks for a top of book change. The timestamp returned is now().
+  template <class Stop = NeverStop>
+  RunResult runUntil(TimestampT until, Stop&& stop = {}) {
+    return run(until, std::numeric_limits<size_t>::max(), stop);
+  }
+
+  template <class Stop = NeverStop>
+  RunResult runFor(size_t numEvents, Stop&& stop = {}) {
+    return run(TimestampT::max(), numEvents, stop);
+  }
+
+  // timestamp of the event running or last run
+  [[nodiscard]] TimestampT now() const noexcept {
+    return mNow;
+  }
+
  private:
-  struct CompareEventTimestampGreater {
-    [[nodiscard]] auto constexpr operator()(EventT const& lhs, EventT const& rhs) const noexcept {
-      return lhs.first > rhs.first;
+  // simulation events go first on equal timestamps
+  size_t runSimulationEvents(TimestampT until) {
+    return mStrategyEvents.expireUntil(static_cast<uint64_t>(until.count()), [this](uint64_t timestamp, auto const& event) {
+      mNow = TimestampT(timestamp);
+      event();
+    });
+  }
+
+  void runMarketDataEvent() {
+    mNow = mNextMarketDataEvent.first;
+    mNextMarketDataEvent.second();
+    mNextMarketDataEvent = mRequestMarketDataEvent();
+  }
+
+  template <class Stop>
+  RunResult run(TimestampT until, size_t numEvents, Stop& stop) {
+    size_t n = 0;
+    while (n != numEvents) {
+      auto const next = mNextMarketDataEvent.first;
+      if (runSimulationEvents(std::min(next, until)) != 0) return {n, mNow, StopReason::SimulationEvents};
+      if (next > until) return {n, mNow, StopReason::Until};
+      runMarketDataEvent();
+      ++n;
+      if (stop()) return {n, mNow, StopReason::Stopped};
     }
-  };
+    return {n, mNow, StopReason::NumEvents};
+  }
 
   std::function<EventT()> mRequestMarketDataEvent;
   EventT mNextMarketDataEvent;
-  std::priority_queue<EventT, std::vector<EventT>, CompareEventTimestampGreater> mNextStrategyEvents;
+  TimingWheel<std::function<void()>> mStrategyEvents;
+  TimestampT mNow{0};
 };
 
 }  // namespace simulator
@@ -0,0 +1,118 @@
+#include "Sweep.h"
+
+#include <md/BinaryDataReader.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#include "ItchBooksManager.h"
+#include "OMS.h"
+#include "Simulator.h"
+#include "functions.h"
+
+namespace {
+
+constexpr size_t CacheLineSize = 64;
+
+// The top of book every worker applies before the replay goes on. Published by bumping seq, each
+// worker bumps done once its block has seen it.
+struct Broadcast {
+  alignas(CacheLineSize) std::atomic<uint64_t> seq = 0;
+  lob::LimitOrderBook::TopOfBook top = {};
+  alignas(CacheLineSize) std::atomic<uint64_t> done = 0;
+  alignas(CacheLineSize) std::atomic<bool> running = true;
+};
+
+// Spins first: the next update is usually microseconds away.
+void wait(int& numWaits) noexcept {
+  if (++numWaits > 1000) std::this_thread::yield();
+}
+
+// Stops the workers however the replay ends, before they are joined.
+struct StopOnExit {
+  Broadcast& broadcast;
+
+  ~StopOnExit() {
+    broadcast.running.store(false, std::memory_order_relaxed);
+  }
+};
+
+}  // namespace
+
+std::vector<strategies::MeanReversionResult> simulator::runSweep(md::BinaryDataReader reader, int symbolId, std::span<strategies::MeanReversionParams const> grid, size_t numEvents, SweepOptions const& options) {
+  auto const numWorkers = std::clamp<size_t>(options.numWorkers, 1, std::max<size_t>(grid.size(), 1));
+
+  // Blocks are contiguous in window length, so a block shares its windows among as many parameter
+  // sets as it can.
+  auto order = std::vector<size_t>(grid.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, {}, [&grid](size_t i) { return grid[i].k; });
+  auto const blockSize = (grid.size() + numWorkers - 1) / numWorkers;
+
+  auto bmgr = ItchBooksManager{};
+  auto simulator = Simulator{[&] { return getNextMarketDataEvent(reader, bmgr); }};
+  // every strategy has at most one order open, sent on one update, and fills or cancels it before
+  // the next: the queues hold what a whole grid or block sends in between
+  auto oms = OMS({
+      .latency = options.latency,
+      .inboxSize = std::bit_ceil(2 * grid.size() + 1024),
+      .eventQueueSize = std::bit_ceil(4 * blockSize + 1024),
+      .maxClients = numWorkers,
+  });
+  oms.connect(simulator, bmgr);
+  bmgr.subscribe(symbolId);
+
+  auto blocks = std::vector<std::unique_ptr<strategies::MeanReversionBlock>>();
+  auto params = std::vector<strategies::MeanReversionParams>();
+  for (size_t begin = 0; begin < grid.size(); begin += blockSize) {
+    params.clear();
+    for (auto i = begin; i != std::min(begin + blockSize, grid.size()); ++i) params.push_back(grid[order[i]]);
+    blocks.push_back(std::make_unique<strategies::MeanReversionBlock>(oms, symbolId, params));
+  }
+
+  auto broadcast = Broadcast{};
+  {
+    auto workers = std::vector<std::jthread>();
+    for (auto& block : blocks) {
+      workers.emplace_back([&broadcast, &block = *block] {
+        uint64_t seen = 0;
+        int numWaits = 0;
+        while (true) {
+          auto const seq = broadcast.seq.load(std::memory_order_acquire);
+          if (seq == seen) {
+            if (!broadcast.running.load(std::memory_order_relaxed)) return;
+            wait(numWaits);
+            continue;
+          }
+          numWaits = 0;
+          seen = seq;
+          block.onUpdate(broadcast.top);
+          broadcast.done.fetch_add(1, std::memory_order_release);
+        }
+      });
+    }
+    auto const stop = StopOnExit{broadcast};
+
+    for (size_t n = 0; n < numEvents;) {
+      auto const run = simulator.runFor(numEvents - n, [&bmgr] { return bmgr.topsChanged(); });
+      n += run.numEvents;
+      bmgr.takeChangedTops([&](int, auto const& book) {
+        broadcast.top = book.top();
+        auto const seq = broadcast.seq.fetch_add(1, std::memory_order_release) + 1;
+        int numWaits = 0;
+        while (broadcast.done.load(std::memory_order_acquire) != seq * blocks.size()) wait(numWaits);
+      });
+      oms.processRequests();
+    }
+  }
+
+  auto results = std::vector<strategies::MeanReversionResult>(grid.size());
+  for (size_t b = 0; b != blocks.size(); ++b) {
+    for (size_t i = 0; i != blocks[b]->size(); ++i) results[order[b * blockSize + i]] = blocks[b]->result(i);
+  }
+  return results;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <strategies/MeanReversionBlock.h>
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace md {
+class BinaryDataReader;
+}
+
+namespace simulator {
+
+struct SweepOptions {
+  // threads running the strategies, each owning one contiguous block of the grid
+  size_t numWorkers = 4;
+  std::chrono::nanoseconds latency = std::chrono::microseconds(50);
+};
+
+// Replays the market data once and runs every parameter set of grid on symbolId against it, for
+// at most numEvents market data events. The replay runs on the calling thread. On every top of book
+// change of the symbol each worker updates its block and the replay waits for all of them before
+// moving on, so the results do not depend on the number of workers. Results are in grid order.
+std::vector<strategies::MeanReversionResult> runSweep(md::BinaryDataReader reader, int symbolId, std::span<strategies::MeanReversionParams const> grid, size_t numEvents, SweepOptions const& options = {});
+
+}  // namespace simulator
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace simulator {
+
+// Hierarchical timing wheel over 64-bit nanosecond times: 8 levels of 256 slots, one per byte of
+// the time. An event goes to the level of the highest byte in which its time differs from the
+// wheel's current time, in the slot of that byte, so scheduling is O(1). Slots of level 0 hold a
+// single time each; when level 0 runs out, the next occupied slot of the lowest level that has one
+// is spread over the levels below, which every event goes through at most 7 times. Occupied slots
+// are found with a bitmap per level.
+//
+// Events with equal times run in the order they were scheduled. Events scheduled in the past run
+// with the next expiry. Cancelling by handle is O(1): the event is only marked and its storage
+// reused once its slot comes up. Nodes live in a deque, so a callback may schedule or cancel
+// events while it runs.
+template <class Callback>
+class TimingWheel {
+ public:
+  struct Handle {
+    uint32_t index = Invalid;
+    uint32_t generation = 0;
+  };
+
+  explicit TimingWheel(uint64_t now = 0) : mNow(now) {
+    for (auto& level : mSlots) level.fill({Invalid, Invalid});
+  }
+
+  TimingWheel(TimingWheel const&) = delete;
+  TimingWheel& operator=(TimingWheel const&) = delete;
+
+  Handle schedule(uint64_t time, Callback callback) {
+    auto const index = allocate();
+    auto& node = mNodes[index];
+    node.time = time;
+    node.callback = std::move(callback);
+    node.live = true;
+    link(index);
+    ++mSize;
+    return {index, node.generation};
+  }
+
+  // False if the event already ran or was cancelled.
+  bool cancel(Handle handle) {
+    if (handle.index >= mNodes.size()) return false;
+    auto& node = mNodes[handle.index];
+    if (node.generation != handle.generation || !node.live) return false;
+    node.live = false;
+    node.callback = Callback{};
+    --mSize;
+    return true;
+  }
+
+  // Runs f(time, callback) for the events due at or before limit, in time order. Events that f
+  // schedules run as well if they are due.
+  template <class F>
+  size_t expireUntil(uint64_t limit, F&& f) {
+    size_t n = 0;
+    while (auto const slot = nextDueSlot(limit)) {
+      // taken off the slot first, events f schedules for the same time go to a new list after it
+      auto index = mSlots[0][*slot].head;
+      mSlots[0][*slot] = {Invalid, Invalid};
+      clearOccupied(0, *slot);
+
+      while (index != Invalid) {
+        auto& node = mNodes[index];
+        auto const next = node.next;
+        if (node.live) {
+          node.live = false;
+          --mSize;
+          f(node.time, node.callback);
+          ++n;
+        }
+        release(index);
+        index = next;
+      }
+    }
+    return n;
+  }
+
+  // time of the earliest event, if any is due at or before limit
+  [[nodiscard]] std::optional<uint64_t> nextDue(uint64_t limit) {
+    // skipping cancelled events, so that an empty wheel reports nothing
+    while (auto const slot = nextDueSlot(limit)) {
+      for (auto index = mSlots[0][*slot].head; index != Invalid; index = mNodes[index].next) {
+        if (mNodes[index].live) return mNow;
+      }
+      expireUntil(mNow, [](uint64_t, Callback&) {});
+    }
+    return {};
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return mSize == 0;
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mSize;
+  }
+
+  [[nodiscard]] uint64_t now() const noexcept {
+    return mNow;
+  }
+
+ private:
+  static constexpr uint32_t Invalid = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t Bits = 8;
+  static constexpr size_t NumSlots = size_t{1} << Bits;
+  static constexpr size_t NumLevels = 64 / Bits;
+
+  struct Node {
+    uint64_t time = 0;
+    Callback callback = {};
+    uint32_t next = Invalid;
+    uint32_t generation = 0;
+    bool live = false;
+  };
+
+  struct Slot {
+    uint32_t head;
+    uint32_t tail;
+  };
+
+  [[nodiscard]] static size_t slotOf(uint64_t time, size_t level) noexcept {
+    return (time >> (level * Bits)) & (NumSlots - 1);
+  }
+
+  // the bytes of time above level
+  [[nodiscard]] static uint64_t above(uint64_t time, size_t level) noexcept {
+    auto const bits = (level + 1) * Bits;
+    return bits >= 64 ? 0 : time & ~((uint64_t{1} << bits) - 1);
+  }
+
+  uint32_t allocate() {
+    if (!mFree.empty()) {
+      auto const index = mFree.back();
+      mFree.pop_back();
+      return index;
+    }
+    mNodes.emplace_back();
+    return static_cast<uint32_t>(mNodes.size() - 1);
+  }
+
+  void release(uint32_t index) {
+    auto& node = mNodes[index];
+    node.callback = Callback{};
+    node.next = Invalid;
+    ++node.generation;
+    mFree.push_back(index);
+  }
+
+  void link(uint32_t index) {
+    auto& node = mNodes[index];
+    auto const time = std::max(node.time, mNow);
+    auto const diff = time ^ mNow;
+    auto const level = diff == 0 ? 0 : (static_cast<size_t>(std::bit_width(diff)) - 1) / Bits;
+    auto const slotIndex = slotOf(time, level);
+
+    auto& slot = mSlots[level][slotIndex];
+    node.next = Invalid;
+    if (slot.tail == Invalid) slot.head = index;
+    else mNodes[slot.tail].next = index;
+    slot.tail = index;
+    mOccupied[level][slotIndex / 64] |= uint64_t{1} << (slotIndex % 64);
+  }
+
+  void clearOccupied(size_t level, size_t slot) noexcept {
+    mOccupied[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+  }
+
+  [[nodiscard]] std::optional<size_t> findOccupied(size_t level, size_t from) const noexcept {
+    for (auto word = from / 64; word < NumSlots / 64; ++word) {
+      auto bits = mOccupied[level][word];
+      if (word == from / 64) bits &= ~uint64_t{0} << (from % 64);
+      if (bits) return word * 64 + static_cast<size_t>(std::countr_zero(bits));
+    }
+    return {};
+  }
+
+  // Advances the current time to the earliest occupied slot of level 0 if it is at or before limit,
+  // spreading higher level slots on the way, and returns it.
+  std::optional<size_t> nextDueSlot(uint64_t limit) {
+    for (size_t level = 0; level != NumLevels;) {
+      // slots of higher levels are always ahead of the current one
+      auto const current = slotOf(mNow, level);
+      auto const slot = findOccupied(level, level == 0 ? current : current + 1);
+      if (!slot) {
+        ++level;
+        continue;
+      }
+
+      auto const start = above(mNow, level) | (uint64_t{*slot} << (level * Bits));
+      if (start > limit) return {};
+      mNow = start;
+      if (level == 0) return slot;
+
+      auto index = mSlots[level][*slot].head;
+      mSlots[level][*slot] = {Invalid, Invalid};
+      clearOccupied(level, *slot);
+      while (index != Invalid) {
+        auto const next = mNodes[index].next;
+        if (mNodes[index].live) link(index);
+        else release(index);
+        index = next;
+      }
+      level = 0;
+    }
+    return {};
+  }
+
+  uint64_t mNow;
+  size_t mSize = 0;
+  std::deque<Node> mNodes;
+  std::vector<uint32_t> mFree;
+  std::array<std::array<Slot, NumSlots>, NumLevels> mSlots;
+  std::array<std::array<uint64_t, NumSlots / 64>, NumLevels> mOccupied = {};
+};
+
+}  // namespace simulator
@@ -0,0 +1,64 @@
+#include "TopOfBookRecording.h"
+
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+simulator::TopOfBookRecorder::TopOfBookRecorder(std::string const& filename, Simulator const& simulator, size_t chunkSize)
+    : mOut(filename, std::ios::binary | std::ios::trunc), mSimulator(simulator), mChunkSize(chunkSize) {
+  if (!mOut) throw std::runtime_error(std::format("Could not open output file '{}'", filename));
+  mChunk.reserve(mChunkSize);
+  writeHeader();
+}
+
+simulator::TopOfBookRecorder::~TopOfBookRecorder() {
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+void simulator::TopOfBookRecorder::close() {
+  if (!mOut.is_open()) return;
+  flushChunk();
+  mOut.seekp(0);
+  writeHeader();
+  mOut.close();
+}
+
+void simulator::TopOfBookRecorder::flushChunk() {
+  mOut.write(reinterpret_cast<char const*>(mChunk.data()), static_cast<std::streamsize>(mChunk.size() * sizeof(TopOfBookRecord)));
+  mSize += mChunk.size();
+  mChunk.clear();
+}
+
+void simulator::TopOfBookRecorder::writeHeader() {
+  auto header = TopOfBookRecordingHeader{};
+  std::memcpy(header.magic, TopOfBookRecordingHeader::Magic, sizeof(header.magic));
+  header.recordSize = sizeof(TopOfBookRecord);
+  header.precision = lob::LimitOrderBook::Precision;
+  header.count = mSize;
+  mOut.write(reinterpret_cast<char const*>(&header), sizeof(header));
+}
+
+simulator::TopOfBookRecording::TopOfBookRecording(std::string const& filename) : mFile(filename) {
+  auto header = TopOfBookRecordingHeader{};
+  if (mFile.size() < sizeof(header)) throw std::runtime_error(std::format("'{}' is not a top of book recording", filename));
+  std::memcpy(&header, mFile.data(), sizeof(header));
+  if (std::memcmp(header.magic, TopOfBookRecordingHeader::Magic, sizeof(header.magic)) != 0 || header.recordSize != sizeof(TopOfBookRecord)) {
+    throw std::runtime_error(std::format("'{}' is not a top of book recording", filename));
+  }
+  if (header.precision != lob::LimitOrderBook::Precision) {
+    throw std::runtime_error(std::format("'{}' has levels of precision {}, not {}", filename, header.precision, lob::LimitOrderBook::Precision));
+  }
+  if (sizeof(header) + header.count * sizeof(TopOfBookRecord) > mFile.size()) throw std::runtime_error(std::format("'{}' is truncated", filename));
+
+  // the mapping is page aligned and the header a multiple of the record alignment
+  mRecords = {reinterpret_cast<TopOfBookRecord const*>(mFile.data() + sizeof(header)), header.count};
+}
+
+std::vector<lob::LimitOrderBook::TopOfBook> simulator::TopOfBookRecording::tops(int symbolId) const {
+  auto tops = std::vector<lob::LimitOrderBook::TopOfBook>();
+  forEach(symbolId, [&tops](Simulator::TimestampT, auto const& top) { tops.push_back(top); });
+  return tops;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <lob/Tsc.h>
+#include <lob/lob.h>
+#include <md/MappedFile.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Simulator.h"
+
+namespace simulator {
+
+// Top of book streams as published by ItchBooksManager, recorded to a file so strategies can be
+// run and profiled on them without decoding and rebuilding the books. The file is a 32 byte header
+// followed by fixed size records in publish order, native endian, meant to be memory mapped.
+
+struct TopOfBookRecord {
+  int64_t timestamp;  // ns, simulation time of the market data event that changed the top
+  int32_t symbolId;
+  int32_t bid;
+  int32_t bidDepth;
+  int32_t ask;
+  int32_t askDepth;
+  int32_t reserved;
+
+  [[nodiscard]] lob::LimitOrderBook::TopOfBook top() const noexcept {
+    return {lob::LimitOrderBook::LevelT(bid), bidDepth, lob::LimitOrderBook::LevelT(ask), askDepth};
+  }
+};
+
+static_assert(sizeof(TopOfBookRecord) == 32 && std::is_trivially_copyable_v<TopOfBookRecord>);
+
+struct TopOfBookRecordingHeader {
+  static constexpr char Magic[8] = {'L', 'O', 'B', 'T', 'O', 'P', 'S', '1'};
+
+  char magic[8];
+  uint32_t recordSize;
+  int32_t precision;  // of the levels
+  uint64_t count;
+  uint64_t reserved;
+};
+
+static_assert(sizeof(TopOfBookRecordingHeader) == 32);
+
+// Writes the tops published while it is set on an ItchBooksManager, stamped with the simulator's
+// time. Records are buffered in chunks of chunkSize; the header is rewritten with the final count
+// on close, so a recording cut short by an exception is still complete up to its last chunk.
+class TopOfBookRecorder {
+ public:
+  TopOfBookRecorder(std::string const& filename, Simulator const& simulator, size_t chunkSize = 1 << 14);
+  ~TopOfBookRecorder();
+
+  TopOfBookRecorder(TopOfBookRecorder const&) = delete;
+  TopOfBookRecorder& operator=(TopOfBookRecorder const&) = delete;
+
+  void record(int symbolId, lob::LimitOrderBook::TopOfBook const& top) {
+    mChunk.push_back({mSimulator.now().count(), symbolId, static_cast<int>(top.bid), top.bidDepth, static_cast<int>(top.ask), top.askDepth, 0});
+    if (mChunk.size() == mChunkSize) flushChunk();
+  }
+
+  // Writes the buffered records and the final header. The file is complete after this.
+  void close();
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mSize + mChunk.size();
+  }
+
+ private:
+  void flushChunk();
+  void writeHeader();
+
+  std::ofstream mOut;
+  Simulator const& mSimulator;
+  size_t mChunkSize;
+  std::vector<TopOfBookRecord> mChunk;
+  size_t mSize = 0;
+};
+
+// A recorded top of book stream for StrategyBase::loop, in place of an ItchBooksManager buffer:
+// read returns the next chunk of updates of symbolId, stamped with the publish clock when read so
+// lags measure the strategy alone. Reads straight from the records, skipping other symbols as it
+// goes, so they must outlive it. Clears running once everything was read, which ends the loop.
+class RecordedTopOfBookBuffer {
+ public:
+  using DataT = std::pair<lob::PublishClock::time_point, lob::LimitOrderBook::TopOfBook>;
+
+  struct Updates {
+    std::span<DataT const> data;
+    size_t m = 0;
+    size_t M = 0;
+  };
+
+  RecordedTopOfBookBuffer(std::span<TopOfBookRecord const> records, int symbolId, std::atomic<bool>& running, size_t chunkSize = 64)
+      : mRecords(records),
+        mSymbolId(symbolId),
+        mSize(static_cast<size_t>(std::ranges::count(records, symbolId, &TopOfBookRecord::symbolId))),
+        mRunning(running),
+        mChunk(chunkSize) {
+    if constexpr (std::is_same_v<lob::PublishClock, lob::TscClock>) lob::calibrateTsc();
+  }
+
+  [[nodiscard]] Updates read(size_t idx) const {
+    if (idx >= mSize) {
+      mRunning.store(false);
+      return {};
+    }
+    // the loop reads in order; anything else starts over from the first record
+    if (idx < mIdx) mPos = mIdx = 0;
+    for (; mIdx != idx; ++mPos) {
+      if (mRecords[mPos].symbolId == mSymbolId) ++mIdx;
+    }
+
+    auto const now = lob::PublishClock::now();
+    size_t n = 0;
+    for (; n != mChunk.size() && mIdx != mSize; ++mPos) {
+      if (mRecords[mPos].symbolId != mSymbolId) continue;
+      mChunk[n++] = {now, mRecords[mPos].top()};
+      ++mIdx;
+    }
+    return {std::span(mChunk.data(), n), idx, idx + n - 1};
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mSize;
+  }
+
+ private:
+  std::span<TopOfBookRecord const> mRecords;
+  int mSymbolId;
+  size_t mSize;
+  std::atomic<bool>& mRunning;
+  mutable std::vector<DataT> mChunk;
+  // next record to look at and the index of the next update of the symbol from there
+  mutable size_t mPos = 0;
+  mutable size_t mIdx = 0;
+};
+
+// A recording, memory mapped.
+class TopOfBookRecording {
+ public:
+  // Throws if the file is not a recording of this build's levels.
+  explicit TopOfBookRecording(std::string const& filename);
+
+  [[nodiscard]] std::span<TopOfBookRecord const> records() const noexcept {
+    return mRecords;
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mRecords.size();
+  }
+
+  // Calls f(timestamp, top) for every record of symbolId, in order.
+  template <class F>
+  void forEach(int symbolId, F&& f) const {
+    for (auto const& record : mRecords) {
+      if (record.symbolId == symbolId) f(Simulator::TimestampT(record.timestamp), record.top());
+    }
+  }
+
+  // Feeds the strategy's onUpdate directly. Its orders go to its OMS, but nothing fills them.
+  template <class S>
+  void replay(int symbolId, S& strategy) const {
+    forEach(symbolId, [&strategy](Simulator::TimestampT timestamp, auto const& top) { strategy.onUpdate(timestamp, top); });
+  }
+
+  // A copy of the tops of symbolId, for checks; strategies read them through buffer().
+  [[nodiscard]] std::vector<lob::LimitOrderBook::TopOfBook> tops(int symbolId) const;
+
+  // Reads from the mapping, which has to outlive it.
+  [[nodiscard]] RecordedTopOfBookBuffer buffer(int symbolId, std::atomic<bool>& running) const {
+    return RecordedTopOfBookBuffer(mRecords, symbolId, running);
+  }
+
+ private:
+  md::MappedFile mFile;
+  std::span<TopOfBookRecord const> mRecords;
+};
+
+}  // namespace simulator
@@ -0,0 +1,143 @@
+#include "Topology.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// back into the kernel's format
+std::string formatCpuList(std::vector<int> const& cpus) {
+  auto list = std::string();
+  for (size_t i = 0; i != cpus.size();) {
+    auto j = i;
+    while (j + 1 != cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+    if (!list.empty()) list += ',';
+    list += i == j ? std::format("{}", cpus[i]) : std::format("{}-{}", cpus[i], cpus[j]);
+    i = j + 1;
+  }
+  return list;
+}
+
+}  // namespace
+
+std::vector<int> simulator::allowedCpus() {
+#ifndef _WIN32
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    auto cpus = std::vector<int>();
+    for (int cpu = 0; cpu != CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+#endif
+  auto cpus = std::vector<int>(std::max(std::thread::hardware_concurrency(), 1u));
+  std::iota(cpus.begin(), cpus.end(), 0);
+  return cpus;
+}
+
+int simulator::nodeOfAddress(void const* address) noexcept {
+#if defined(__linux__) && defined(SYS_move_pages)
+  // move_pages without target nodes only reports where the pages are
+  auto const pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(address) / pageSize * pageSize);
+  int status = -1;
+  if (syscall(SYS_move_pages, 0, 1UL, &page, nullptr, &status, 0) == 0 && status >= 0) return status;
+#else
+  static_cast<void>(address);
+#endif
+  return -1;
+}
+
+std::vector<int> simulator::parseCpuList(std::string_view list) {
+  auto const parse = [list](std::string_view value) {
+    int cpu = 0;
+    auto const [end, ec] = std::from_chars(value.data(), value.data() + value.size(), cpu);
+    if (ec != std::errc{} || end != value.data() + value.size() || cpu < 0) throw std::runtime_error(std::format("Invalid CPU list: '{}'", list));
+    return cpu;
+  };
+
+  auto cpus = std::vector<int>();
+  // the kernel ends the list with a newline, and lists no CPUs as an empty line
+  while (!list.empty() && (list.back() == '\n' || list.back() == ' ')) list.remove_suffix(1);
+  if (list.empty()) return cpus;
+  for (auto const range : std::views::split(list, ',')) {
+    auto const item = std::string_view(range.begin(), range.end());
+    auto const dash = item.find('-');
+    auto const first = parse(item.substr(0, dash));
+    auto const last = dash == std::string_view::npos ? first : parse(item.substr(dash + 1));
+    if (last < first) throw std::runtime_error(std::format("Invalid CPU list: '{}'", list));
+    for (auto cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  std::ranges::sort(cpus);
+  auto const [end, last] = std::ranges::unique(cpus);
+  cpus.erase(end, last);
+  return cpus;
+}
+
+simulator::Topology::Topology(std::vector<NumaNode> nodes) : mNodes(std::move(nodes)) {
+  std::ranges::sort(mNodes, {}, &NumaNode::id);
+}
+
+simulator::Topology simulator::Topology::discover(std::filesystem::path const& root, std::vector<int> const& allowed) {
+  auto nodes = std::vector<NumaNode>();
+  auto ec = std::error_code();
+  for (auto const& entry : std::filesystem::directory_iterator(root, ec)) {
+    auto const name = entry.path().filename().string();
+    int id = 0;
+    if (!name.starts_with("node") || std::from_chars(name.data() + 4, name.data() + name.size(), id).ptr != name.data() + name.size()) continue;
+    auto file = std::ifstream(entry.path() / "cpulist");
+    if (!file) continue;
+    auto list = std::string();
+    std::getline(file, list);
+    nodes.push_back({id, parseCpuList(list)});
+  }
+  auto sortedAllowed = allowed;
+  std::ranges::sort(sortedAllowed);
+  if (nodes.empty()) return Topology({{0, std::move(sortedAllowed)}});
+
+  for (auto& node : nodes) {
+    auto cpus = std::vector<int>();
+    std::ranges::set_intersection(node.cpus, sortedAllowed, std::back_inserter(cpus));
+    node.cpus = std::move(cpus);
+  }
+  return Topology(std::move(nodes));
+}
+
+int simulator::Topology::nodeOf(int cpu) const noexcept {
+  for (auto const& node : mNodes) {
+    if (std::ranges::binary_search(node.cpus, cpu)) return node.id;
+  }
+  return -1;
+}
+
+std::vector<int> simulator::Topology::cpus() const {
+  auto cpus = std::vector<int>();
+  for (auto const& node : mNodes) cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+  return cpus;
+}
+
+std::string simulator::Topology::toString() const {
+  std::stringstream ss;
+  for (auto const& node : mNodes) {
+    if (node.cpus.empty()) ss << std::format("node {}: no CPUs", node.id) << std::endl;
+    else ss << std::format("node {}: CPUs {}", node.id, formatCpuList(node.cpus)) << std::endl;
+  }
+  return ss.str();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <filesystem>
+#include <future>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "PinToCore.h"
+
+namespace simulator {
+
+// The CPUs the process may run on, ascending. Every hardware thread where the affinity mask can't
+// be read.
+[[nodiscard]] std::vector<int> allowedCpus();
+
+struct NumaNode {
+  int id = 0;
+  std::vector<int> cpus;  // ascending, empty for a node with memory only
+};
+
+// The NUMA nodes of the machine and their CPUs.
+class Topology {
+ public:
+  explicit Topology(std::vector<NumaNode> nodes);
+
+  // Reads the nodes from sysfs and keeps their allowed CPUs, by default those of the process's
+  // affinity mask, e.g. under taskset or a cgroup cpuset. Without sysfs, e.g. off Linux, the
+  // machine is a single node of the allowed CPUs.
+  [[nodiscard]] static Topology discover(std::filesystem::path const& root = "/sys/devices/system/node", std::vector<int> const& allowed = allowedCpus());
+
+  [[nodiscard]] auto const& nodes() const noexcept {
+    return mNodes;
+  }
+
+  // -1 for a CPU on no node
+  [[nodiscard]] int nodeOf(int cpu) const noexcept;
+
+  // every CPU, node by node
+  [[nodiscard]] std::vector<int> cpus() const;
+
+  [[nodiscard]] std::string toString() const;
+
+ private:
+  std::vector<NumaNode> mNodes;  // by id
+};
+
+// The node whose memory holds the page of address, -1 where it can't be told, e.g. off Linux or
+// for a page not faulted in yet.
+[[nodiscard]] int nodeOfAddress(void const* address) noexcept;
+
+// Parses a kernel CPU list, like "0-3,8,10-11".
+[[nodiscard]] std::vector<int> parseCpuList(std::string_view list);
+
+// Runs f on a new thread pinned to core and returns what it returns, or throws what it throws.
+// Memory that f touches first is placed on the core's node, by the kernel's default local
+// allocation policy; for what it allocates from the heap that isn't certain, see NodeLocal.
+template <class F>
+auto runOnCore(int core, F&& f) {
+  auto task = std::packaged_task<std::invoke_result_t<F&>()>([core, &f] {
+    pin_to_core(core);
+    return f();
+  });
+  auto result = task.get_future();
+  std::thread(std::move(task)).join();
+  return result.get();
+}
+
+}  // namespace simulator
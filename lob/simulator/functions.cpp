@@ -1,123 +1,276 @@
 ﻿#include "functions.h"
 
+#include <lob/Tsc.h>
 #include <logger/Logger.h>
 #include <md/BinaryDataReader.h>
-#include <md/Symbols.h>
-#include <md/itch/MessageReaders.h>
-#include <strategies/Strategies.h>
+#include <md/ItchReplay.h>
+#include <md/itch/Dispatch.h>
+#include <strategies/Registry.h>
 
+#include <array>
 #include <chrono>
+#include <format>
 #include <exec/inline_scheduler.hpp>
 #include <exec/static_thread_pool.hpp>
+#include <functional>
+#include <optional>
 #include <print>
+#include <span>
+#include <stdexcept>
 #include <stdexec/execution.hpp>
+#include <string>
 #include <utility>
 
 #include "ItchBooksManager.h"
 #include "ItchToLobType.h"
+#include "Metrics.h"
 #include "PinToCore.h"
+#include "PipelineLatencies.h"
 #include "Simulator.h"
+#include "TopOfBookRecording.h"
+#include "Topology.h"
 #include "TupleMap.h"
 
-simulator::Simulator::EventT simulator::getNextMarketDataEvent(md::BinaryDataReader& reader, ItchBooksManager& bmgr) {
-  while (reader.remaining() >= 3) {
-    auto const currentMessageType = md::itch::currentMessageType(reader);
-    auto const start = std::chrono::high_resolution_clock::now();
-    switch (currentMessageType) {
-      case md::itch::messages::MessageType::ADD_ORDER: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::ADD_ORDER>(reader);
-        return {msg.timestamp, [msg, &bmgr] {
-                  bmgr.addOrder(msg.stock_locate, msg.oid, msg.buy, msg.qty, msg.price);
-                }};
-      }
-      case md::itch::messages::MessageType::ADD_ORDER_MPID: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::ADD_ORDER_MPID>(reader);
-        return {msg.add_msg.timestamp, [msg = msg.add_msg, &bmgr] {
-                  bmgr.addOrder(msg.stock_locate, msg.oid, msg.buy, msg.qty, msg.price);
-                }};
-      }
-      case md::itch::messages::MessageType::REPLACE_ORDER: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::REPLACE_ORDER>(reader);
-        return {msg.timestamp, [msg, &bmgr] {
-                  bmgr.replaceOrder(msg.stock_locate, msg.oid, msg.new_order_id, msg.new_qty, msg.new_price);
-                }};
-      }
-      case md::itch::messages::MessageType::REDUCE_ORDER: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::REDUCE_ORDER>(reader);
-        return {msg.timestamp, [msg, &bmgr] {
-                  bmgr.reduceOrder(msg.stock_locate, msg.oid, msg.qty);
-                }};
-        break;
-      }
-      case md::itch::messages::MessageType::EXECUTE_ORDER: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::EXECUTE_ORDER>(reader);
-        return {msg.timestamp, [msg, &bmgr] {
-                  bmgr.executeOrder(msg.stock_locate, msg.oid, msg.qty);
-                }};
-      }
-      case md::itch::messages::MessageType::EXECUTE_ORDER_WITH_PRICE: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::EXECUTE_ORDER_WITH_PRICE>(reader);
-        return {msg.exec.timestamp, [msg = msg.exec, &bmgr] {
-                  bmgr.executeOrder(msg.stock_locate, msg.oid, msg.qty);
-                }};
-      }
-      case md::itch::messages::MessageType::DELETE_ORDER: {
-        auto const msg = md::itch::readItchMessage<md::itch::messages::MessageType::DELETE_ORDER>(reader);
-        return {msg.timestamp, [msg, &bmgr] {
-                  bmgr.deleteOrder(msg.stock_locate, msg.oid);
-                }};
-      }
-      default:
-        md::itch::skipCurrentMessage(reader);
-    }
+namespace {
+
+// Decodes messages until the next book event. Returns nothing at the end of the day's messages.
+// Locates are mapped through toLocate and timestamps shifted by offset, so several days can be
+// replayed as one stream.
+std::optional<simulator::Simulator::EventT> nextMarketDataEvent(md::BinaryDataReader& reader, simulator::ItchBooksManager& bmgr, auto const& toLocate, std::chrono::nanoseconds offset) {
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+
+  auto event = std::optional<simulator::Simulator::EventT>{};
+  auto endOfMessages = false;
+
+  // Trades and imbalances of symbols nobody opted into are dropped here rather than becoming events
+  // that do nothing. Book messages still become events that the manager drops: the simulator decodes
+  // one event ahead, and an add decoded before a late opt-in must not go missing from the book.
+  auto const wanted = [&](md::itch::types::locate_t locate) { return bmgr.optedIn(toLocate(locate)); };
+  auto visitor = md::itch::overloaded{
+      [&](itch_message<MessageType::ADD_ORDER> const& msg) {
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.addOrder(locate, msg.oid, msg.buy, msg.qty, msg.price);
+        });
+      },
+      [&](itch_message<MessageType::ADD_ORDER_MPID> const& mpid) {
+        auto const& msg = mpid.add_msg;
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.addOrder(locate, msg.oid, msg.buy, msg.qty, msg.price);
+        });
+      },
+      [&](itch_message<MessageType::REPLACE_ORDER> const& msg) {
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.replaceOrder(locate, msg.oid, msg.new_order_id, msg.new_qty, msg.new_price);
+        });
+      },
+      [&](itch_message<MessageType::REDUCE_ORDER> const& msg) {
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.reduceOrder(locate, msg.oid, msg.qty);
+        });
+      },
+      [&](itch_message<MessageType::EXECUTE_ORDER> const& msg) {
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.executeOrder(locate, msg.oid, msg.qty);
+        });
+      },
+      [&](itch_message<MessageType::EXECUTE_ORDER_WITH_PRICE> const& msg) {
+        event.emplace(msg.exec.timestamp + offset, [msg = msg.exec, price = msg.price, printable = msg.printable == 'Y', locate = toLocate(msg.exec.stock_locate), &bmgr] {
+          bmgr.executeOrderWithPrice(locate, msg.oid, msg.qty, price, printable);
+        });
+      },
+      [&](itch_message<MessageType::DELETE_ORDER> const& msg) {
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.deleteOrder(locate, msg.oid);
+        });
+      },
+      [&](itch_message<MessageType::TRADE> const& msg) {
+        if (!wanted(msg.stock_locate)) return;
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.trade(locate, msg.qty, msg.price, msg.match_number);
+        });
+      },
+      [&](itch_message<MessageType::CROSS_TRADE> const& msg) {
+        if (!wanted(msg.stock_locate)) return;
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.crossTrade(locate, msg.shares, msg.price, msg.match_number);
+        });
+      },
+      [&](itch_message<MessageType::BROKEN_TRADE> const& msg) {
+        if (!wanted(msg.stock_locate)) return;
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.brokenTrade(locate, msg.match_number);
+        });
+      },
+      [&](itch_message<MessageType::NET_ORDER_IMBALANCE> const& msg) {
+        if (!wanted(msg.stock_locate)) return;
+        event.emplace(msg.timestamp + offset, [msg, locate = toLocate(msg.stock_locate), &bmgr] {
+          bmgr.netOrderImbalance(locate, msg.paired_shares, msg.imbalance_shares, msg.imbalance_direction, msg.far_price, msg.near_price, msg.reference_price, msg.cross_type);
+        });
+      },
+      [&](itch_message<MessageType::SYSEVENT> const& msg) {
+        endOfMessages = msg.eventCode == 'C';
+      }};
+
+  auto* const metrics = bmgr.metrics();
+  while (!event && !endOfMessages && reader.remaining() >= 3) {
+    if (metrics) metrics->messagesByType[static_cast<unsigned char>(*reader.get(2))].add();
+    md::itch::dispatch(reader, visitor);
   }
+  return event;
+}
+
+}  // namespace
+
+simulator::Simulator::EventT simulator::getNextMarketDataEvent(md::BinaryDataReader& reader, ItchBooksManager& bmgr) {
+  if (auto event = tryGetNextMarketDataEvent(reader, bmgr)) return std::move(*event);
   throw std::runtime_error("end of messages");
 }
 
-void simulator::runTest(md::BinaryDataReader& reader, md::utils::Symbols const& symbols, int numIters, bool singleThreaded, logging::Logger* logger) try {
+std::optional<simulator::Simulator::EventT> simulator::tryGetNextMarketDataEvent(md::BinaryDataReader& reader, ItchBooksManager& bmgr) {
+  return nextMarketDataEvent(reader, bmgr, std::identity{}, {});
+}
+
+simulator::Simulator::EventT simulator::getNextMarketDataEvent(md::ItchReplay& replay, ItchBooksManager& bmgr) {
+  auto const toLocate = [&replay](md::itch::types::locate_t locate) { return replay.toGlobal(locate); };
+  if (auto event = nextMarketDataEvent(replay.reader(), bmgr, toLocate, replay.dayOffset())) return std::move(*event);
+
+  // End of the day: orders don't carry over, so the books are cleared before the next day starts.
+  auto const endOfDay = replay.dayOffset() + std::chrono::days(1) - std::chrono::nanoseconds(1);
+  if (!replay.nextDay()) throw std::runtime_error("end of messages");
+  return {endOfDay, [&bmgr] { bmgr.resetBooks(); }};
+}
+
+namespace {
+
+template <class Source>
+size_t recordTops(Source& source, std::span<int const> symbolIds, size_t numEvents, std::string const& filename) {
+  auto bmgr = simulator::ItchBooksManager{};
+  auto simulator = simulator::Simulator{[&] { return simulator::getNextMarketDataEvent(source, bmgr); }};
+  for (auto const id : symbolIds) bmgr.optIn(id);
+  auto recorder = simulator::TopOfBookRecorder(filename, simulator);
+  bmgr.setRecorder(&recorder);
+  simulator.runFor(numEvents);
+  recorder.close();
+  return recorder.size();
+}
+
+}  // namespace
+
+size_t simulator::recordTopOfBook(md::BinaryDataReader reader, std::span<int const> symbolIds, size_t numEvents, std::string const& filename) {
+  return recordTops(reader, symbolIds, numEvents, filename);
+}
+
+size_t simulator::recordTopOfBook(md::ItchReplay& replay, std::span<int const> symbolIds, size_t numEvents, std::string const& filename) {
+  return recordTops(replay, symbolIds, numEvents, filename);
+}
+
+namespace {
+
+template <class Entry>
+void runTestWith(md::ItchReplay& replay, int numIters, bool singleThreaded, logging::Logger* logger, std::span<int const> cores) {
+  using namespace simulator;
+  using StrategyT = typename Entry::StrategyT;
+
   ItchBooksManager bmgr;
 
-  auto simulator = simulator::Simulator{[&] { return getNextMarketDataEvent(reader, bmgr); }};
+  // calibrate before the replay starts rather than on the first timed message
+  lob::calibrateTsc();
+  auto latencies = PipelineLatencies{};
+  bmgr.setPublishLatency(&latencies.publish);
+
+  // live counters, snapshotted to a file every second for watching long runs
+  auto metrics = MetricsRegistry{};
+  metrics.setLogger(logger);
+  bmgr.setMetrics(&metrics.add("simulator", replay.count() + 1));
+  auto const sampler = MetricsSampler(metrics, "diagnostics/metrics.json");
+
+  // An event is applied between the end of its decode and the start of the next one, which the
+  // simulator requests right after applying it. The first event of a run is timed from its start.
+  uint64_t applyStart = 0;
+  auto simulator = simulator::Simulator{[&] {
+    auto const start = lob::rdtsc();
+    if (applyStart != 0) latencies.bookApply.record(lob::ticksToNs(start - applyStart));
+    auto event = getNextMarketDataEvent(replay, bmgr);
+    applyStart = lob::rdtsc();
+    latencies.decode.record(lob::ticksToNs(applyStart - start));
+    return event;
+  }};
   auto oms = simulator::OMS{};
+  oms.connect(simulator, bmgr);
+
+  auto const timedRun = [&](size_t numEvents, auto const& stop) {
+    applyStart = lob::rdtsc();
+    return simulator.runFor(numEvents, stop);
+  };
+  auto const numEvents = static_cast<size_t>(numIters);
 
   using namespace std::chrono_literals;
 
   if (singleThreaded) {
-    auto const symbolId = symbols.byName("QQQ");
-    auto strategy = strategies::TestStrategy(oms, symbolId, 100, logger);
-    auto const& book = bmgr.bookById(symbolId);
-    auto prevTop = book.top();
-    size_t bufferReadIdx = 0;
-    for (int i : std::views::iota(0, numIters)) {
-      auto timestamp = simulator.step();
-      auto const top = book.top();
-      if (prevTop != top) {
-        strategy.onUpdate(timestamp, book.top());
-        prevTop = top;
-      }
+    auto const symbolId = replay.byName("QQQ");
+    auto strategy = StrategyT(oms, symbolId, typename Entry::ParamsT{}, logger);
+    auto& strategyMetrics = metrics.add("strategy QQQ");
+    strategy.diagnostics().streamTo("diagnostics/ST_QQQ");
+    bmgr.subscribe(symbolId);
+    for (size_t n = 0; n < numEvents;) {
+      auto const run = timedRun(numEvents - n, [&bmgr] { return bmgr.topsChanged(); });
+      n += run.numEvents;
+      bmgr.takeChangedTops([&](int, auto const& book) {
+        strategy.onUpdate(run.timestamp, book.top());
+        strategyMetrics.strategyCallbacks.add();
+      });
+      oms.processRequests();
     }
-    std::println("Strategy and simulation done:");
-    auto const& diagnostics = strategy.diagnostics();
+    std::println("{} and simulation done:", Entry::name);
+    auto& diagnostics = strategy.diagnostics();
     std::println("{}", diagnostics.toString());
     diagnostics.save("diagnostics/ST_QQQ.json");
+    std::println("Pipeline latencies:\n{}", latencies.toString());
+    std::println("Orders: {}, fills: {}", oms.numOrders(), oms.numFills());
 
   } else {
+    // The strategies' threads, then the simulator's, are pinned to the cores given, or else to the
+    // CPUs of the process's affinity mask node by node, cycling when there are fewer.
+    auto const topology = Topology::discover();
+    auto const plan = cores.empty() ? topology.cpus() : std::vector<int>(cores.begin(), cores.end());
+    if (plan.empty()) throw std::runtime_error("runTest: no CPU to pin the threads to");
+    auto const symbols = std::array<std::string, 4>{"QQQ", "SPY", "AMD", "IWM"};
+    auto const coreOf = [&plan](size_t thread) { return plan[thread % plan.size()]; };
+    auto const simulatorCore = coreOf(symbols.size());
+
+    // Each symbol's ring is allocated by a thread on its strategy's core, so that the strategy
+    // reads it from its own node, and its book on the simulator's, which applies the messages.
+    // Both get pages of their own, touched first by that thread. The strategies then only look
+    // their rings up.
+    for (size_t i = 0; i != symbols.size(); ++i) {
+      auto const symbolId = replay.byName(symbols[i]);
+      auto const* ring = runOnCore(coreOf(i), [&bmgr, symbolId] { return &bmgr.bufferById(symbolId); });
+      runOnCore(simulatorCore, [&bmgr, symbolId] { static_cast<void>(bmgr.bookById(symbolId)); });
+      std::println("{} on core {} (node {}), ring on node {}", symbols[i], coreOf(i), topology.nodeOf(coreOf(i)), nodeOfAddress(ring));
+    }
+    std::println("Simulator on core {} (node {})", simulatorCore, topology.nodeOf(simulatorCore));
+
     std::atomic<bool> running = true;
 
     auto const simulatorLoop = [&]() {
       std::this_thread::sleep_for(1s);
 
-      for (int i : std::views::iota(0, numIters)) {
-        simulator.step();
+      // runs end as soon as a strategy sends an order, for it to arrive after the same latency
+      for (size_t n = 0; n < numEvents;) {
+        n += timedRun(numEvents - n, [&oms] { return oms.hasRequests(); }).numEvents;
+        oms.processRequests();
       }
       std::println("Simulation done.");
       running = false;
     };
 
-    auto const strategyLoop = [&running, &symbols = std::as_const(symbols), &bmgr, &oms, &logger](std::string const& symbolName) {
-      auto const symbolId = symbols.byName(symbolName);
-      auto strategy = strategies::TestStrategy(oms, symbolId, 100, logger);
-      auto const& topOfBookBuffer = bmgr.bufferById(symbolId);
+    auto const strategyLoop = [&running, &replay = std::as_const(replay), &bmgr, &oms, &logger, &metrics](std::string const& symbolName) {
+      auto const symbolId = replay.byName(symbolName);
+      auto strategy = StrategyT(oms, symbolId, typename Entry::ParamsT{}, logger);
+      strategy.setMetrics(&metrics.add(std::format("strategy {}", symbolName)));
+      strategy.diagnostics().streamTo(std::format("diagnostics/MT_{}", symbolName));
+      auto const& topOfBookBuffer = std::as_const(bmgr).bufferById(symbolId);
       size_t bufferReadIdx = 0;
       return strategy.loop(running, topOfBookBuffer, bufferReadIdx);
     };
@@ -128,11 +281,11 @@ void simulator::runTest(md::BinaryDataReader& reader, md::utils::Symbols const&
     namespace ex = stdexec;
 
     auto work = ex::when_all(
-        ex::schedule(sched) | ex::then(pin_to_core<0>) | ex::then([&] { return strategyLoop("QQQ"); }) | ex::then([&](auto const& d) { d.save("diagnostics/MT_QQQ.json"); return d; }),
-        ex::schedule(sched) | ex::then(pin_to_core<1>) | ex::then([&] { return strategyLoop("SPY"); }) | ex::then([&](auto const& d) { d.save("diagnostics/MT_SPY.json"); return d; }),
-        ex::schedule(sched) | ex::then(pin_to_core<2>) | ex::then([&] { return strategyLoop("AMD"); }) | ex::then([&](auto const& d) { d.save("diagnostics/MT_AMD.json"); return d; }),
-        ex::schedule(sched) | ex::then(pin_to_core<3>) | ex::then([&] { return strategyLoop("IWM"); }) | ex::then([&](auto const& d) { d.save("diagnostics/MT_IWM.json"); return d; }),
-        ex::schedule(sched) | ex::then(pin_to_core<4>) | ex::then(simulatorLoop));
+        ex::schedule(sched) | ex::then([&] { pin_to_core(coreOf(0)); }) | ex::then([&] { return strategyLoop(symbols[0]); }) | ex::then([&](auto d) { d.save("diagnostics/MT_QQQ.json"); return d; }),
+        ex::schedule(sched) | ex::then([&] { pin_to_core(coreOf(1)); }) | ex::then([&] { return strategyLoop(symbols[1]); }) | ex::then([&](auto d) { d.save("diagnostics/MT_SPY.json"); return d; }),
+        ex::schedule(sched) | ex::then([&] { pin_to_core(coreOf(2)); }) | ex::then([&] { return strategyLoop(symbols[2]); }) | ex::then([&](auto d) { d.save("diagnostics/MT_AMD.json"); return d; }),
+        ex::schedule(sched) | ex::then([&] { pin_to_core(coreOf(3)); }) | ex::then([&] { return strategyLoop(symbols[3]); }) | ex::then([&](auto d) { d.save("diagnostics/MT_IWM.json"); return d; }),
+        ex::schedule(sched) | ex::then([&] { pin_to_core(simulatorCore); }) | ex::then(simulatorLoop));
 
     auto diagnostics = ex::sync_wait(std::move(work)).value();
 
@@ -144,8 +297,18 @@ void simulator::runTest(md::BinaryDataReader& reader, md::utils::Symbols const&
     };
 
     tuple_map(diagnostics, f);
+
+    tuple_map(diagnostics, [&latencies](auto const& diagnostics, size_t) { latencies.strategyReceive.merge(diagnostics.lags); });
+    std::println("Pipeline latencies:\n{}", latencies.toString());
+    std::println("Orders: {}, fills: {}", oms.numOrders(), oms.numFills());
   }
+}
+
+}  // namespace
 
+void simulator::runTest(md::ItchReplay& replay, int numIters, bool singleThreaded, logging::Logger* logger, std::string_view strategyName, std::span<int const> cores) try {
+  auto const found = strategies::RegisteredStrategies::visit(strategyName, [&]<class Entry>() { runTestWith<Entry>(replay, numIters, singleThreaded, logger, cores); });
+  if (!found) throw std::invalid_argument(std::format("unknown strategy {}", strategyName));
 } catch (std::exception const& ex) {
   std::println("Exception: {}", ex.what());
 } catch (...) {
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
 #include "Simulator.h"
 
 namespace md {
 class BinaryDataReader;
-}
-
-namespace md::utils {
-class Symbols;
+class ItchReplay;
 }
 
 namespace logging {
@@ -19,6 +22,18 @@ namespace simulator {
 class ItchBooksManager;
 
 Simulator::EventT getNextMarketDataEvent(md::BinaryDataReader& reader, ItchBooksManager& bmgr);
-void runTest(md::BinaryDataReader& reader, md::utils::Symbols const& symbols, int numIters, bool singleThreaded, logging::Logger* logger);
+// Nothing at the end of the day's messages, where getNextMarketDataEvent throws.
+std::optional<Simulator::EventT> tryGetNextMarketDataEvent(md::BinaryDataReader& reader, ItchBooksManager& bmgr);
+Simulator::EventT getNextMarketDataEvent(md::ItchReplay& replay, ItchBooksManager& bmgr);
+
+// Replays numEvents market data events, no more than there are, and records the top of book
+// updates of the given symbols to filename, for TopOfBookRecording. Returns the number recorded.
+size_t recordTopOfBook(md::BinaryDataReader reader, std::span<int const> symbolIds, size_t numEvents, std::string const& filename);
+size_t recordTopOfBook(md::ItchReplay& replay, std::span<int const> symbolIds, size_t numEvents, std::string const& filename);
+
+// Runs the registered strategy named strategyName on the replay. Multi threaded, the strategies of
+// QQQ, SPY, AMD and IWM and then the simulator are pinned to cores, cycling through them, by
+// default every CPU the process may run on, node by node.
+void runTest(md::ItchReplay& replay, int numIters, bool singleThreaded, logging::Logger* logger, std::string_view strategyName = "TestStrategy", std::span<int const> cores = {});
 
 }  // namespace simulator
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <lob/lob.h>
+#include <logger/Logger.h>
+#include <simulator/OMS.h>
+
+#include <concepts>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "MeanReversionBlock.h"
+#include "Params.h"
+#include "RollingStats.h"
+#include "Strategies.h"
+
+namespace strategies {
+
+// Strategies assembled at compile time from a signal, filters and an execution. Composed calls
+// them directly on its members, so onUpdate inlines through the whole chain.
+//
+// - Signal: constructible from its Params; update(context) takes every valid top of book and
+//   returns the order it wants, if any.
+// - Filter: constructible from its Params; allow(context, order) may veto the order. Optional
+//   hooks: onUpdate(context) on every valid top of book, onSent(order) once an order went out.
+// - Execution: constructible from (OMS&, symbolId, logger); sends the orders and follows them.
+//   poll(diagnostics) takes its order events on every update, update() follows up on its open
+//   order on every valid one. While it is busy, signals still see every update but no new order
+//   is sent.
+//
+// Composed's Params gathers the components' Params, whose fields are visited by forEachField.
+
+// What the components see of an update.
+struct UpdateContext {
+  lob::LimitOrderBook::TopOfBook top;
+  double bid = 0.0;
+  double ask = 0.0;
+  double microprice = 0.0;
+  int64_t position = 0;
+};
+
+struct OrderIntent {
+  lob::Direction direction = lob::Direction::Buy;
+  int qty = 0;
+  lob::LimitOrderBook::LevelT price{0};
+
+  [[nodiscard]] int64_t signedQty() const noexcept {
+    return direction == lob::Direction::Buy ? qty : -qty;
+  }
+};
+
+template <class S>
+concept Signal = requires(S& s, UpdateContext const& context) {
+  typename S::Params;
+  { s.update(context) } -> std::same_as<std::optional<OrderIntent>>;
+};
+
+template <class F>
+concept Filter = requires(F& f, UpdateContext const& context, OrderIntent const& order) {
+  typename F::Params;
+  { f.allow(context, order) } -> std::same_as<bool>;
+};
+
+template <class E>
+concept Execution = requires(E& e, StrategyDiagnostics& diagnostics, OrderIntent const& order) {
+  e.poll(diagnostics);
+  e.update();
+  { e.busy() } -> std::same_as<bool>;
+  e.send(order, diagnostics);
+  { e.position() } -> std::same_as<int64_t>;
+};
+
+template <Signal S, Execution E, Filter... Fs>
+class Composed : private StrategyBase {
+ public:
+  struct Params {
+    std::tuple<typename S::Params, typename Fs::Params...> components;
+  };
+
+  Composed(simulator::OMS& oms, int symbolId, Params const& params = {}, logging::Logger* logger = nullptr)
+      : Composed(oms, symbolId, params, logger, std::index_sequence_for<Fs...>{}) {}
+
+  using StrategyBase::diagnostics;
+  using StrategyBase::loop;
+  using StrategyBase::metrics;
+  using StrategyBase::setMetrics;
+
+  void onUpdate(auto /*timestamp*/, lob::LimitOrderBook::TopOfBook const& top) noexcept {
+    mExecution.poll(diagnostics());
+
+    if (static_cast<int>(top.bid) == 0 || static_cast<int>(top.ask) == 0) return;
+    auto const bid = static_cast<double>(top.bid);
+    auto const ask = static_cast<double>(top.ask);
+    diagnostics().addObs(bid, ask);
+
+    auto const context = UpdateContext{top, bid, ask, microprice(top), mExecution.position()};
+    std::apply([&context](auto&... filters) { (onFilterUpdate(filters, context), ...); }, mFilters);
+    auto const order = mSignal.update(context);
+    if (mExecution.busy()) {
+      mExecution.update();
+      return;
+    }
+    if (!order) return;
+
+    auto const allowed = std::apply([&](auto&... filters) { return (filters.allow(context, *order) && ...); }, mFilters);
+    if (!allowed) return;
+    mExecution.send(*order, diagnostics());
+    std::apply([&order](auto&... filters) { (onFilterSent(filters, *order), ...); }, mFilters);
+  }
+
+  [[nodiscard]] int64_t position() const noexcept {
+    return mExecution.position();
+  }
+
+ private:
+  template <size_t... Is>
+  Composed(simulator::OMS& oms, int symbolId, Params const& params, logging::Logger* logger, std::index_sequence<Is...>)
+      : mSignal(std::get<0>(params.components)), mFilters(Fs(std::get<Is + 1>(params.components))...), mExecution(oms, symbolId, logger) {}
+
+  static void onFilterUpdate(auto& filter, UpdateContext const& context) noexcept {
+    if constexpr (requires { filter.onUpdate(context); }) filter.onUpdate(context);
+  }
+
+  static void onFilterSent(auto& filter, OrderIntent const& order) noexcept {
+    if constexpr (requires { filter.onSent(order); }) filter.onSent(order);
+  }
+
+  S mSignal;
+  std::tuple<Fs...> mFilters;
+  E mExecution;
+};
+
+// Signals
+
+// TestStrategy's: enters at the mean when the touch is entry stdevs away from it, exits at the
+// touch once back at the mean.
+class MeanReversionSignal {
+ public:
+  using Params = MeanReversionParams;
+
+  explicit MeanReversionSignal(Params const& params) : mPrice(params.k), mEntry(params.entry), mQty(params.qty) {}
+
+  [[nodiscard]] std::optional<OrderIntent> update(UpdateContext const& context) noexcept {
+    mPrice.add(context.microprice);
+    auto const mean = mPrice.mean();
+    auto const band = mEntry * mPrice.stdev();
+    auto const meanLevel = lob::LimitOrderBook::LevelT(static_cast<int>(std::lround(mean / lob::PrecisionMultiplier<lob::LimitOrderBook::Precision>::value)));
+
+    if (context.position == 0) {
+      if (context.bid > mean + band) return OrderIntent{lob::Direction::Sell, mQty, meanLevel};
+      if (context.ask < mean - band) return OrderIntent{lob::Direction::Buy, mQty, meanLevel};
+    } else if (context.position > 0 && context.bid >= mean) {
+      return OrderIntent{lob::Direction::Sell, static_cast<int>(context.position), context.top.bid};
+    } else if (context.position < 0 && context.ask <= mean) {
+      return OrderIntent{lob::Direction::Buy, static_cast<int>(-context.position), context.top.ask};
+    }
+    return {};
+  }
+
+ private:
+  RollingMoments mPrice;
+  double mEntry;
+  int mQty;
+};
+
+// Follows a fast EWMA of the microprice crossing a slow one, taking the touch: long while the
+// fast one is above, short while below.
+class MomentumSignal {
+ public:
+  struct Params {
+    double fast = 20.0;   // spans, in updates
+    double slow = 200.0;
+    int qty = 1;
+
+    static constexpr auto fields() {
+      return std::tuple{Field{"fast", &Params::fast}, Field{"slow", &Params::slow}, Field{"qty", &Params::qty}};
+    }
+  };
+
+  explicit MomentumSignal(Params const& params) : mFast(Ewma::ofSpan(params.fast)), mSlow(Ewma::ofSpan(params.slow)), mQty(params.qty) {}
+
+  [[nodiscard]] std::optional<OrderIntent> update(UpdateContext const& context) noexcept {
+    mFast.add(context.microprice);
+    mSlow.add(context.microprice);
+    auto const target = mFast.mean() > mSlow.mean() ? mQty : mFast.mean() < mSlow.mean() ? -mQty : 0;
+    auto const qty = target - context.position;
+    if (qty > 0) return OrderIntent{lob::Direction::Buy, static_cast<int>(qty), context.top.ask};
+    if (qty < 0) return OrderIntent{lob::Direction::Sell, static_cast<int>(-qty), context.top.bid};
+    return {};
+  }
+
+ private:
+  Ewma mFast;
+  Ewma mSlow;
+  int64_t mQty;
+};
+
+// Filters
+
+// Vetoes orders that would take the position beyond limit either way.
+class MaxPosition {
+ public:
+  struct Params {
+    int64_t limit = 100;
+
+    static constexpr auto fields() {
+      return std::tuple{Field{"maxPosition", &Params::limit}};
+    }
+  };
+
+  explicit MaxPosition(Params const& params) : mLimit(params.limit) {}
+
+  [[nodiscard]] bool allow(UpdateContext const& context, OrderIntent const& order) const noexcept {
+    return std::abs(context.position + order.signedQty()) <= mLimit;
+  }
+
+ private:
+  int64_t mLimit;
+};
+
+// Vetoes orders while the spread is wider than maxSpread, in price levels.
+class MaxSpread {
+ public:
+  struct Params {
+    int maxSpread = 2;
+
+    static constexpr auto fields() {
+      return std::tuple{Field{"maxSpread", &Params::maxSpread}};
+    }
+  };
+
+  explicit MaxSpread(Params const& params) : mMaxSpread(params.maxSpread) {}
+
+  [[nodiscard]] bool allow(UpdateContext const& context, OrderIntent const&) const noexcept {
+    return static_cast<int>(context.top.ask) - static_cast<int>(context.top.bid) <= mMaxSpread;
+  }
+
+ private:
+  int mMaxSpread;
+};
+
+// Vetoes orders sent within numUpdates updates of the last one.
+class Cooldown {
+ public:
+  struct Params {
+    int numUpdates = 10;
+
+    static constexpr auto fields() {
+      return std::tuple{Field{"cooldown", &Params::numUpdates}};
+    }
+  };
+
+  explicit Cooldown(Params const& params) : mNumUpdates(params.numUpdates) {}
+
+  void onUpdate(UpdateContext const&) noexcept {
+    ++mSinceSent;
+  }
+
+  [[nodiscard]] bool allow(UpdateContext const&, OrderIntent const&) const noexcept {
+    return mSinceSent > mNumUpdates;
+  }
+
+  void onSent(OrderIntent const&) noexcept {
+    mSinceSent = 0;
+  }
+
+ private:
+  int mNumUpdates;
+  int mSinceSent = std::numeric_limits<int>::max() / 2;
+};
+
+// Executions
+
+// One limit order at a time, cancelled if still open NumUpdates valid updates after it was sent,
+// as TestStrategy does with 1.
+template <int NumUpdates = 1>
+class LimitExecution {
+ public:
+  LimitExecution(simulator::OMS& oms, int symbolId, logging::Logger* logger) : mOMS(oms), mClientId(oms.addClient()), mSymbolId(symbolId), mLogger(logger) {}
+
+  void poll(StrategyDiagnostics& diagnostics) noexcept {
+    mOMS.pollEvents(mClientId, [&](simulator::OrderEvent const& event) {
+      if (event.kind == simulator::OrderEvent::Kind::Fill) {
+        auto const qty = event.direction == lob::Direction::Buy ? event.qty : -event.qty;
+        mPosition += qty;
+        diagnostics.addFill(qty, static_cast<double>(event.price));
+      }
+      if (event.leaves == 0 && event.orderId == mOpenOrder) {
+        mOpenOrder.reset();
+        mCancelSent = false;
+      }
+    });
+  }
+
+  void update() noexcept {
+    if (mOpenOrder && !mCancelSent && ++mUpdatesOpen >= NumUpdates) {
+      mOMS.cancel(mClientId, *mOpenOrder);
+      mCancelSent = true;
+    }
+  }
+
+  [[nodiscard]] bool busy() const noexcept {
+    return mOpenOrder.has_value();
+  }
+
+  void send(OrderIntent const& order, StrategyDiagnostics& diagnostics) noexcept {
+    if (mLogger) mLogger->log("{} {} at {}", order.direction == lob::Direction::Buy ? 'B' : 'S', order.qty, static_cast<double>(order.price));
+    mOpenOrder = mOMS.limitOrder(mClientId, mSymbolId, order.direction, order.qty, order.price);
+    mUpdatesOpen = 0;
+    diagnostics.addOrder();
+  }
+
+  [[nodiscard]] int64_t position() const noexcept {
+    return mPosition;
+  }
+
+ private:
+  simulator::OMS& mOMS;
+  simulator::OMS::ClientId mClientId;
+  int mSymbolId;
+  logging::Logger* mLogger;
+  std::optional<simulator::OMS::OrderId> mOpenOrder;
+  bool mCancelSent = false;
+  int mUpdatesOpen = 0;
+  int64_t mPosition = 0;
+};
+
+// TestStrategy's logic, composed.
+using MeanReversion = Composed<MeanReversionSignal, LimitExecution<>>;
+using Momentum = Composed<MomentumSignal, LimitExecution<>, MaxSpread, MaxPosition, Cooldown>;
+
+}  // namespace strategies
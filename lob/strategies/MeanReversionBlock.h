@@ -0,0 +1,207 @@
+#pragma once
+
+#include <lob/lob.h>
+#include <simulator/OMS.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Params.h"
+#include "RollingStats.h"
+#include "Strategies.h"
+
+namespace strategies {
+
+// One parameter set of TestStrategy's mean reversion.
+struct MeanReversionParams {
+  size_t k = 100;      // microprices in the window of the mean and stdev
+  double entry = 2.0;  // distance from the mean to enter at, in stdevs
+  int qty = 1;
+
+  static constexpr auto fields() {
+    return std::tuple{Field{"k", &MeanReversionParams::k}, Field{"entry", &MeanReversionParams::entry}, Field{"qty", &MeanReversionParams::qty}};
+  }
+
+  [[nodiscard]] std::string toString() const {
+    return std::format("k={} entry={} qty={}", k, entry, qty);
+  }
+};
+
+struct MeanReversionResult {
+  MeanReversionParams params;
+  size_t numOrders = 0;
+  size_t numFills = 0;
+  int64_t position = 0;  // signed, bought minus sold
+  double cash = 0.0;     // received for sales minus paid for buys
+};
+
+// Every combination of the given values.
+[[nodiscard]] inline std::vector<MeanReversionParams> makeGrid(std::span<size_t const> ks, std::span<double const> entries, std::span<int const> qtys) {
+  auto grid = std::vector<MeanReversionParams>();
+  grid.reserve(ks.size() * entries.size() * qtys.size());
+  for (auto const k : ks) {
+    for (auto const entry : entries) {
+      for (auto const qty : qtys) grid.push_back({k, entry, qty});
+    }
+  }
+  return grid;
+}
+
+// TestStrategy for many parameter sets on one symbol, as one sweep worker owns them. The states
+// are kept as one array per field, sorted by window length: strategies with the same window share
+// its statistics, and their signals are computed in one loop over contiguous arrays with the
+// window's mean and stdev fixed. The block is a single OMS client and routes order events to its
+// strategies by order id.
+class MeanReversionBlock {
+ public:
+  MeanReversionBlock(simulator::OMS& oms, int symbolId, std::span<MeanReversionParams const> params)
+      : mOMS(oms), mClientId(oms.addClient()), mSymbolId(symbolId), mParams(params.begin(), params.end()), mByWindow(params.size()) {
+    std::iota(mByWindow.begin(), mByWindow.end(), 0);
+    std::ranges::stable_sort(mByWindow, {}, [&params](uint32_t i) { return params[i].k; });
+
+    mSlot.resize(params.size());
+    for (size_t j = 0; j != mByWindow.size(); ++j) {
+      mSlot[mByWindow[j]] = static_cast<uint32_t>(j);
+      auto const& p = params[mByWindow[j]];
+      if (mWindows.empty() || mWindows.back().k != p.k) mWindows.push_back({p.k, RollingMoments(p.k), j, j});
+      mWindows.back().end = j + 1;
+      mEntry.push_back(p.entry);
+      mQty.push_back(p.qty);
+    }
+    auto const n = params.size();
+    mPosition.resize(n);
+    mWant.resize(n);
+    mOpenOrder.resize(n, NoOrder);
+    mCancelSent.resize(n);
+    mNumOrders.resize(n);
+    mNumFills.resize(n);
+    mCash.resize(n);
+  }
+
+  MeanReversionBlock(MeanReversionBlock const&) = delete;
+  MeanReversionBlock& operator=(MeanReversionBlock const&) = delete;
+
+  void onUpdate(lob::LimitOrderBook::TopOfBook const& top) noexcept {
+    mOMS.pollEvents(mClientId, [this](simulator::OrderEvent const& event) { onOrderEvent(event); });
+
+    if (static_cast<int>(top.bid) == 0 || static_cast<int>(top.ask) == 0) return;
+    auto const price = microprice(top);
+    auto const bid = static_cast<double>(top.bid);
+    auto const ask = static_cast<double>(top.ask);
+
+    for (auto& window : mWindows) {
+      window.moments.add(price);
+      auto const mean = window.moments.mean();
+      signals(window.begin, window.end, bid, ask, mean, window.moments.stdev());
+
+      auto const meanLevel = lob::LimitOrderBook::LevelT(static_cast<int>(std::lround(mean / lob::PrecisionMultiplier<lob::LimitOrderBook::Precision>::value)));
+      for (auto j = window.begin; j != window.end; ++j) {
+        if (mOpenOrder[j] != NoOrder) {
+          // what has not filled by the next update is cancelled
+          if (!mCancelSent[j]) {
+            mOMS.cancel(mClientId, mOpenOrder[j]);
+            mCancelSent[j] = true;
+          }
+        } else if (mWant[j] != 0) {
+          // entries at the mean, exits at the touch
+          auto const level = mPosition[j] == 0 ? meanLevel : mWant[j] > 0 ? top.ask : top.bid;
+          sendOrder(j, level);
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mParams.size();
+  }
+
+  // of the i-th parameter set given
+  [[nodiscard]] MeanReversionResult result(size_t i) const {
+    auto const j = mSlot[i];
+    return {mParams[i], mNumOrders[j], mNumFills[j], mPosition[j], mCash[j]};
+  }
+
+ private:
+  static constexpr simulator::OMS::OrderId NoOrder = std::numeric_limits<simulator::OMS::OrderId>::max();
+
+  struct Window {
+    size_t k;
+    RollingMoments moments;
+    size_t begin;  // strategies using it
+    size_t end;
+  };
+
+  // The signed quantity each strategy would send, before checking for open orders: TestStrategy's
+  // entries when flat and exits once back at the mean. Branch free.
+  void signals(size_t begin, size_t end, double bid, double ask, double mean, double stdev) noexcept {
+    auto const* const entry = mEntry.data();
+    auto const* const qty = mQty.data();
+    auto const* const position = mPosition.data();
+    auto* const want = mWant.data();
+    for (auto j = begin; j != end; ++j) {
+      auto const band = entry[j] * stdev;
+      auto const flat = position[j] == 0;
+      auto const open = !flat ? 0 : bid > mean + band ? -qty[j] : ask < mean - band ? qty[j] : 0;
+      auto const close = (position[j] > 0 && bid >= mean) || (position[j] < 0 && ask <= mean) ? -position[j] : 0;
+      want[j] = open + close;
+    }
+  }
+
+  void sendOrder(size_t j, lob::LimitOrderBook::LevelT price) noexcept {
+    auto const direction = mWant[j] > 0 ? lob::Direction::Buy : lob::Direction::Sell;
+    auto const id = mOMS.limitOrder(mClientId, mSymbolId, direction, static_cast<int>(std::abs(mWant[j])), price);
+    mOpenOrder[j] = id;
+    mOrders[id] = static_cast<uint32_t>(j);
+    ++mNumOrders[j];
+  }
+
+  void onOrderEvent(simulator::OrderEvent const& event) noexcept {
+    auto const it = mOrders.find(event.orderId);
+    if (it == mOrders.end()) return;
+    auto const j = it->second;
+    if (event.kind == simulator::OrderEvent::Kind::Fill) {
+      auto const qty = event.direction == lob::Direction::Buy ? event.qty : -event.qty;
+      mPosition[j] += qty;
+      mCash[j] -= qty * static_cast<double>(event.price);
+      ++mNumFills[j];
+    }
+    if (event.leaves == 0) {
+      mOpenOrder[j] = NoOrder;
+      mCancelSent[j] = false;
+      mOrders.erase(it);
+    }
+  }
+
+  simulator::OMS& mOMS;
+  simulator::OMS::ClientId mClientId;
+  int mSymbolId;
+  std::vector<MeanReversionParams> mParams;  // as given
+  std::vector<uint32_t> mByWindow;           // index into mParams of each strategy, by window
+  std::vector<uint32_t> mSlot;               // inverse of mByWindow
+  std::vector<Window> mWindows;
+
+  // per strategy, in window order
+  std::vector<double> mEntry;
+  std::vector<int64_t> mQty;
+  std::vector<int64_t> mPosition;
+  std::vector<int64_t> mWant;
+  std::vector<simulator::OMS::OrderId> mOpenOrder;
+  std::vector<uint8_t> mCancelSent;
+  std::vector<size_t> mNumOrders;
+  std::vector<size_t> mNumFills;
+  std::vector<double> mCash;
+
+  boost::unordered_map<simulator::OMS::OrderId, uint32_t> mOrders;  // open orders
+};
+
+}  // namespace strategies
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace strategies {
+
+// Streams a column of values into a NumPy .npy file (format 1.0), so it can be opened with
+// np.load(filename, mmap_mode='r') without parsing or copying. Values are buffered in chunks of
+// chunkSize and appended as raw bytes; the header has a fixed size and is rewritten with the final
+// length on close. Memory use is bounded by the chunk, however long the run. Pushing never throws,
+// so it can be done from noexcept strategy callbacks: values pushed after close are counted as
+// dropped, and a failed write is reported by close.
+template <class T>
+class NpyWriter {
+  static_assert(std::is_arithmetic_v<T>);
+
+ public:
+  static constexpr size_t HeaderSize = 128;
+
+  explicit NpyWriter(std::string const& filename, size_t chunkSize = 1 << 16)
+      : mFilename(filename), mOut(filename, std::ios::binary | std::ios::trunc), mChunk(std::max<size_t>(chunkSize, 1)) {
+    if (!mOut) throw std::runtime_error(std::format("Could not open output file '{}'", filename));
+    writeHeader();
+  }
+
+  NpyWriter(NpyWriter const&) = delete;
+  NpyWriter& operator=(NpyWriter const&) = delete;
+
+  ~NpyWriter() {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  void push(T value) noexcept {
+    if (mClosed) {
+      ++mNumDropped;
+      return;
+    }
+    mChunk[mChunkUsed++] = value;
+    if (mChunkUsed == mChunk.size()) flushChunk();
+  }
+
+  // Writes the buffered values and the final header. The file is complete after this, or else this
+  // throws, e.g. on a full disk, with the header counting only the values written before.
+  void close() {
+    if (mClosed) return;
+    mClosed = true;
+    flushChunk();
+    mOut.clear();
+    mOut.seekp(0);
+    writeHeader();
+    mOut.close();
+    if (mFailed || !mOut) throw std::runtime_error(std::format("Could not write output file '{}'", mFilename));
+  }
+
+  // values written, or buffered to be
+  [[nodiscard]] size_t size() const noexcept {
+    return mSize + mChunkUsed;
+  }
+
+  // values pushed after close
+  [[nodiscard]] size_t numDropped() const noexcept {
+    return mNumDropped;
+  }
+
+ private:
+  [[nodiscard]] static constexpr char kind() noexcept {
+    if constexpr (std::is_floating_point_v<T>) return 'f';
+    else if constexpr (std::is_signed_v<T>) return 'i';
+    else return 'u';
+  }
+
+  // once a write has failed, nothing more is appended, so the file holds the first mSize values
+  void flushChunk() noexcept {
+    if (mChunkUsed == 0 || mFailed) {
+      mChunkUsed = 0;
+      return;
+    }
+    mOut.write(reinterpret_cast<char const*>(mChunk.data()), static_cast<std::streamsize>(mChunkUsed * sizeof(T)));
+    mOut.flush();
+    if (mOut) mSize += mChunkUsed;
+    else mFailed = true;
+    mChunkUsed = 0;
+  }
+
+  // magic, version 1.0, little endian header length, then the dict padded with spaces to HeaderSize
+  void writeHeader() {
+    constexpr auto endian = std::endian::native == std::endian::little ? '<' : '>';
+    auto header = std::format("{{'descr': '{}{}{}', 'fortran_order': False, 'shape': ({},), }}", endian, kind(), sizeof(T), mSize);
+    constexpr auto prefix = std::string_view("\x93NUMPY\x01\x00", 8);
+    constexpr uint16_t headerLen = HeaderSize - prefix.size() - 2;
+    header.resize(headerLen - 1, ' ');
+    header.push_back('\n');
+
+    mOut.write(prefix.data(), prefix.size());
+    mOut.put(static_cast<char>(headerLen & 0xff));
+    mOut.put(static_cast<char>(headerLen >> 8));
+    mOut.write(header.data(), static_cast<std::streamsize>(header.size()));
+  }
+
+  std::string mFilename;
+  std::ofstream mOut;
+  std::vector<T> mChunk;
+  size_t mChunkUsed = 0;
+  size_t mSize = 0;
+  size_t mNumDropped = 0;
+  bool mFailed = false;
+  bool mClosed = false;
+};
+
+}  // namespace strategies
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace strategies {
+
+// Strategy parameters are aggregates naming their fields once, in a static fields() returning a
+// tuple of Field, so that bindings and command lines can be generated from them.
+
+template <class P, class T>
+struct Field {
+  std::string_view name;
+  T P::*member;
+};
+
+struct NoParams {
+  static constexpr auto fields() {
+    return std::tuple{};
+  }
+};
+
+// Calls f(name, value&) for every field of params. Params made of other params, in a tuple
+// member named components, are visited component by component.
+template <class P, class F>
+void forEachField(P& params, F&& f) {
+  if constexpr (requires { params.components; }) {
+    std::apply([&f](auto&... components) { (forEachField(components, f), ...); }, params.components);
+  } else {
+    std::apply([&](auto const&... fields) { (f(fields.name, params.*(fields.member)), ...); }, std::remove_const_t<P>::fields());
+  }
+}
+
+}  // namespace strategies
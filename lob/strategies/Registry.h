@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+
+#include "Composition.h"
+#include "Strategies.h"
+
+namespace strategies {
+
+// A string usable as a template argument.
+template <size_t N>
+struct FixedString {
+  char chars[N];
+
+  constexpr FixedString(char const (&s)[N]) noexcept {
+    std::copy_n(s, N, chars);
+  }
+
+  [[nodiscard]] constexpr std::string_view view() const noexcept {
+    return {chars, N - 1};
+  }
+};
+
+// A strategy type under its name. Strategies are constructible from (OMS&, symbolId, Params,
+// Logger*) and have the loop, onUpdate, diagnostics and position of StrategyBase's.
+template <FixedString Name, class S>
+struct Entry {
+  using StrategyT = S;
+  using ParamsT = typename S::Params;
+
+  static constexpr std::string_view name = Name.view();
+};
+
+template <class... Entries>
+struct StrategyList {
+  // Calls f.template operator()<Entry>() for every entry.
+  static void forEach(auto&& f) {
+    (f.template operator()<Entries>(), ...);
+  }
+
+  // Calls f.template operator()<Entry>() for the entry named name. Returns whether there is one.
+  static bool visit(std::string_view name, auto&& f) {
+    return ((Entries::name == name && (f.template operator()<Entries>(), true)) || ...);
+  }
+};
+
+// What runTest can run and pymd binds. Adding a strategy here is all it takes to expose it.
+using RegisteredStrategies = StrategyList<
+    Entry<"TestStrategy", TestStrategy>,
+    Entry<"MeanReversion", MeanReversion>,
+    Entry<"Momentum", Momentum>>;
+
+}  // namespace strategies
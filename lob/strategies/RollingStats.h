@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace strategies {
+
+namespace detail {
+
+// Double-ended ring over a power of two capacity, grown by doubling. Windows of a fixed count
+// reserve their capacity up front and never grow.
+template <class T>
+class Ring {
+ public:
+  explicit Ring(size_t capacity = 16) : mData(std::bit_ceil(std::max<size_t>(capacity, 2))) {}
+
+  void pushBack(T x) {
+    if (mSize == mData.size()) grow();
+    mData[(mHead + mSize) & (mData.size() - 1)] = std::move(x);
+    ++mSize;
+  }
+
+  void popFront() noexcept {
+    mHead = (mHead + 1) & (mData.size() - 1);
+    --mSize;
+  }
+
+  void popBack() noexcept {
+    --mSize;
+  }
+
+  [[nodiscard]] T const& front() const noexcept {
+    return mData[mHead];
+  }
+
+  [[nodiscard]] T const& back() const noexcept {
+    return mData[(mHead + mSize - 1) & (mData.size() - 1)];
+  }
+
+  // oldest first
+  [[nodiscard]] T const& operator[](size_t i) const noexcept {
+    return mData[(mHead + i) & (mData.size() - 1)];
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mSize;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return mSize == 0;
+  }
+
+  void clear() noexcept {
+    mHead = 0;
+    mSize = 0;
+  }
+
+ private:
+  void grow() {
+    auto data = std::vector<T>(mData.size() * 2);
+    for (size_t i = 0; i != mSize; ++i) data[i] = std::move(mData[(mHead + i) & (mData.size() - 1)]);
+    mData = std::move(data);
+    mHead = 0;
+  }
+
+  std::vector<T> mData;
+  size_t mHead = 0;
+  size_t mSize = 0;
+};
+
+// Values of a window in (key, value) order whose front is its max (Better = std::greater) or min
+// (std::less). Each value is pushed and popped once, so updates are amortized O(1).
+template <class T, class Better>
+class MonotonicQueue {
+ public:
+  void push(uint64_t key, T x) {
+    while (!mRing.empty() && !Better{}(mRing.back().second, x)) mRing.popBack();
+    mRing.pushBack({key, x});
+  }
+
+  // drops the values with keys before from
+  void evictBefore(uint64_t from) noexcept {
+    while (!mRing.empty() && mRing.front().first < from) mRing.popFront();
+  }
+
+  [[nodiscard]] T best() const noexcept {
+    return mRing.front().second;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return mRing.empty();
+  }
+
+  void clear() noexcept {
+    mRing.clear();
+  }
+
+ private:
+  Ring<std::pair<uint64_t, T>> mRing;
+};
+
+}  // namespace detail
+
+// Mean and sum of squared deviations from it, updated with Welford's method. Unlike accumulating
+// x and x^2, the variance does not come from subtracting two large, nearly equal numbers. Values
+// can be removed again, which windows do as they leave.
+struct Moments {
+  double n = 0.0;
+  double mean = 0.0;
+  double m2 = 0.0;
+
+  void add(double x) noexcept {
+    n += 1.0;
+    auto const d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+  }
+
+  void remove(double x) noexcept {
+    if (n <= 1.0) {
+      *this = {};
+      return;
+    }
+    n -= 1.0;
+    auto const d = x - mean;
+    mean -= d / n;
+    m2 = std::max(0.0, m2 - d * (x - mean));
+  }
+
+  // remove(out) then add(in), for a full window
+  void replace(double out, double in) noexcept {
+    auto const d = in - out;
+    auto const previous = mean;
+    mean += d / n;
+    m2 = std::max(0.0, m2 + d * (in - mean + out - previous));
+  }
+
+  // population variance, of the values in the window
+  [[nodiscard]] double variance() const noexcept {
+    return n > 0.0 ? m2 / n : 0.0;
+  }
+
+  [[nodiscard]] double sampleVariance() const noexcept {
+    return n > 1.0 ? m2 / (n - 1.0) : 0.0;
+  }
+
+  [[nodiscard]] double stdev() const noexcept {
+    return std::sqrt(variance());
+  }
+};
+
+// Mean and variance of the last n values, O(1) per update whatever n.
+class RollingMoments {
+ public:
+  explicit RollingMoments(size_t n) : mValues(n), mCapacity(n) {}
+
+  void add(double x) noexcept {
+    if (mValues.size() == mCapacity) {
+      mMoments.replace(mValues.front(), x);
+      mValues.popFront();
+    } else {
+      mMoments.add(x);
+    }
+    mValues.pushBack(x);
+  }
+
+  [[nodiscard]] double mean() const noexcept {
+    return mMoments.mean;
+  }
+
+  [[nodiscard]] double variance() const noexcept {
+    return mMoments.variance();
+  }
+
+  [[nodiscard]] double stdev() const noexcept {
+    return mMoments.stdev();
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mValues.size();
+  }
+
+  [[nodiscard]] bool full() const noexcept {
+    return mValues.size() == mCapacity;
+  }
+
+ private:
+  detail::Ring<double> mValues;
+  Moments mMoments;
+  size_t mCapacity;
+};
+
+// Mean and variance of the values of the last window of time: values at or before t - window
+// have left once a value at t is added. Amortized O(1) per update.
+class TimeRollingMoments {
+ public:
+  using DurationT = std::chrono::nanoseconds;
+
+  explicit TimeRollingMoments(DurationT window) : mWindow(window) {}
+
+  void add(DurationT t, double x) {
+    advance(t);
+    mValues.pushBack({t, x});
+    mMoments.add(x);
+  }
+
+  // drops the values that left the window by t
+  void advance(DurationT t) noexcept {
+    while (!mValues.empty() && mValues.front().first <= t - mWindow) {
+      mMoments.remove(mValues.front().second);
+      mValues.popFront();
+    }
+  }
+
+  [[nodiscard]] double mean() const noexcept {
+    return mMoments.mean;
+  }
+
+  [[nodiscard]] double variance() const noexcept {
+    return mMoments.variance();
+  }
+
+  [[nodiscard]] double stdev() const noexcept {
+    return mMoments.stdev();
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mValues.size();
+  }
+
+ private:
+  detail::Ring<std::pair<DurationT, double>> mValues;
+  Moments mMoments;
+  DurationT mWindow;
+};
+
+// Exponentially weighted mean and variance, alpha the weight of the newest value.
+class Ewma {
+ public:
+  explicit Ewma(double alpha) : mAlpha(alpha) {}
+
+  // the alpha whose weights have the center of mass of an n value window
+  [[nodiscard]] static Ewma ofSpan(double n) {
+    return Ewma(2.0 / (n + 1.0));
+  }
+
+  void add(double x) noexcept {
+    add(x, mAlpha);
+  }
+
+  [[nodiscard]] double mean() const noexcept {
+    return mMean;
+  }
+
+  [[nodiscard]] double variance() const noexcept {
+    return mVariance;
+  }
+
+  [[nodiscard]] double stdev() const noexcept {
+    return std::sqrt(mVariance);
+  }
+
+ protected:
+  void add(double x, double alpha) noexcept {
+    if (!mStarted) {
+      mMean = x;
+      mStarted = true;
+      return;
+    }
+    auto const d = x - mMean;
+    auto const increment = alpha * d;
+    mMean += increment;
+    mVariance = (1.0 - alpha) * (mVariance + d * increment);
+  }
+
+ private:
+  double mAlpha;
+  double mMean = 0.0;
+  double mVariance = 0.0;
+  bool mStarted = false;
+};
+
+// Ewma over irregular times: a value's weight halves every halfLife, however many values come in
+// between.
+class TimeEwma : private Ewma {
+ public:
+  using DurationT = std::chrono::nanoseconds;
+
+  explicit TimeEwma(DurationT halfLife) : Ewma(1.0), mHalfLife(static_cast<double>(halfLife.count())) {}
+
+  void add(DurationT t, double x) noexcept {
+    auto const dt = static_cast<double>((t - mLast).count());
+    mLast = t;
+    Ewma::add(x, 1.0 - std::exp2(-dt / mHalfLife));
+  }
+
+  using Ewma::mean;
+  using Ewma::stdev;
+  using Ewma::variance;
+
+ private:
+  double mHalfLife;
+  DurationT mLast{0};
+};
+
+// Min and max of the last n values, amortized O(1) per update.
+template <class T>
+class RollingMinMax {
+ public:
+  explicit RollingMinMax(size_t n) : mN(n) {}
+
+  void add(T x) {
+    ++mCount;
+    mMin.push(mCount, x);
+    mMax.push(mCount, x);
+    if (mCount > mN) {
+      mMin.evictBefore(mCount - mN + 1);
+      mMax.evictBefore(mCount - mN + 1);
+    }
+  }
+
+  // of an empty window: undefined
+  [[nodiscard]] T min() const noexcept {
+    return mMin.best();
+  }
+
+  [[nodiscard]] T max() const noexcept {
+    return mMax.best();
+  }
+
+ private:
+  detail::MonotonicQueue<T, std::less<T>> mMin;
+  detail::MonotonicQueue<T, std::greater<T>> mMax;
+  uint64_t mCount = 0;
+  size_t mN;
+};
+
+// Min and max of the values of the last window of time, as TimeRollingMoments.
+template <class T>
+class TimeRollingMinMax {
+ public:
+  using DurationT = std::chrono::nanoseconds;
+
+  explicit TimeRollingMinMax(DurationT window) : mWindow(window) {}
+
+  void add(DurationT t, T x) {
+    advance(t);
+    mMin.push(static_cast<uint64_t>(t.count()), x);
+    mMax.push(static_cast<uint64_t>(t.count()), x);
+  }
+
+  void advance(DurationT t) noexcept {
+    if (t < mWindow) return;
+    auto const from = static_cast<uint64_t>((t - mWindow).count()) + 1;
+    mMin.evictBefore(from);
+    mMax.evictBefore(from);
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return mMax.empty();
+  }
+
+  [[nodiscard]] T min() const noexcept {
+    return mMin.best();
+  }
+
+  [[nodiscard]] T max() const noexcept {
+    return mMax.best();
+  }
+
+ private:
+  detail::MonotonicQueue<T, std::less<T>> mMin;
+  detail::MonotonicQueue<T, std::greater<T>> mMax;
+  DurationT mWindow;
+};
+
+// RollingMoments of many series with the same window length, updated together: one value per
+// series at a time, as for a set of strategies on the same updates. State is kept as one array
+// per field (structure of arrays) and the window as one row per slot, so an update is a branch
+// free loop over contiguous doubles that the compiler vectorizes.
+class RollingMomentsBlock {
+ public:
+  RollingMomentsBlock(size_t numSeries, size_t n) : mValues(numSeries * n), mMean(numSeries), mM2(numSeries), mNumSeries(numSeries), mN(n) {}
+
+  // xs[i] is the next value of series i
+  void add(std::span<double const> xs) noexcept {
+    auto* const row = mValues.data() + mHead * mNumSeries;
+    auto* const mean = mMean.data();
+    auto* const m2 = mM2.data();
+    auto const* const x = xs.data();
+
+    if (mSize == mN) {
+      auto const inverseN = 1.0 / static_cast<double>(mN);
+      for (size_t i = 0; i != mNumSeries; ++i) {
+        auto const out = row[i];
+        auto const d = x[i] - out;
+        auto const previous = mean[i];
+        mean[i] = previous + d * inverseN;
+        m2[i] = std::max(0.0, m2[i] + d * (x[i] - mean[i] + out - previous));
+        row[i] = x[i];
+      }
+    } else {
+      ++mSize;
+      auto const inverseN = 1.0 / static_cast<double>(mSize);
+      for (size_t i = 0; i != mNumSeries; ++i) {
+        auto const d = x[i] - mean[i];
+        mean[i] += d * inverseN;
+        m2[i] += d * (x[i] - mean[i]);
+        row[i] = x[i];
+      }
+    }
+    mHead = mHead + 1 == mN ? 0 : mHead + 1;
+  }
+
+  [[nodiscard]] std::span<double const> means() const noexcept {
+    return mMean;
+  }
+
+  [[nodiscard]] double mean(size_t i) const noexcept {
+    return mMean[i];
+  }
+
+  [[nodiscard]] double variance(size_t i) const noexcept {
+    return mSize ? mM2[i] / static_cast<double>(mSize) : 0.0;
+  }
+
+  [[nodiscard]] double stdev(size_t i) const noexcept {
+    return std::sqrt(variance(i));
+  }
+
+  [[nodiscard]] size_t numSeries() const noexcept {
+    return mNumSeries;
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return mSize;
+  }
+
+ private:
+  std::vector<double> mValues;  // mN rows of mNumSeries
+  std::vector<double> mMean;
+  std::vector<double> mM2;
+  size_t mNumSeries;
+  size_t mN;
+  size_t mHead = 0;
+  size_t mSize = 0;
+};
+
+// Ewma of many series updated together, laid out as RollingMomentsBlock.
+class EwmaBlock {
+ public:
+  EwmaBlock(size_t numSeries, double alpha) : mMean(numSeries), mVariance(numSeries), mAlpha(alpha) {}
+
+  void add(std::span<double const> xs) noexcept {
+    auto* const mean = mMean.data();
+    auto* const variance = mVariance.data();
+    auto const* const x = xs.data();
+    auto const n = mMean.size();
+
+    if (!mStarted) {
+      std::ranges::copy(xs, mMean.begin());
+      mStarted = true;
+      return;
+    }
+    for (size_t i = 0; i != n; ++i) {
+      auto const d = x[i] - mean[i];
+      auto const increment = mAlpha * d;
+      mean[i] += increment;
+      variance[i] = (1.0 - mAlpha) * (variance[i] + d * increment);
+    }
+  }
+
+  [[nodiscard]] std::span<double const> means() const noexcept {
+    return mMean;
+  }
+
+  [[nodiscard]] double mean(size_t i) const noexcept {
+    return mMean[i];
+  }
+
+  [[nodiscard]] double variance(size_t i) const noexcept {
+    return mVariance[i];
+  }
+
+ private:
+  std::vector<double> mMean;
+  std::vector<double> mVariance;
+  double mAlpha;
+  bool mStarted = false;
+};
+
+}  // namespace strategies
@@ -1,16 +1,20 @@
 #pragma once
 
 #include <logger/Logger.h>
+#include <simulator/Metrics.h>
 #include <simulator/OMS.h>
 
 #include <algorithm>
 #include <atomic>
-#include <deque>
+#include <cmath>
 #include <iostream>
 #include <limits>
-#include <numeric>
 #include <optional>
+#include <tuple>
+#include <type_traits>
 
+#include "Params.h"
+#include "RollingStats.h"
 #include "StrategyDiagnostics.h"
 
 namespace strategies {
@@ -26,10 +30,16 @@ class StrategyBase {
 
         auto const mostRecentUpdateTimestamp = updates.back().first;
         self.diagnostics().bufferLoad(bufferReadIdx, m, M);
+        if (auto* const metrics = self.metrics()) {
+          metrics->ringOverruns.add(m - bufferReadIdx);
+          metrics->strategyCallbacks.add(updates.size());
+        }
 
         for (auto update : updates) {
           auto const& [timestamp, top] = update;
-          self.diagnostics().addLag(std::chrono::high_resolution_clock::now() - timestamp);
+          // on the clock the publisher stamped with, a few cycles with the TSC clock
+          using ClockT = typename std::remove_cvref_t<decltype(timestamp)>::clock;
+          self.diagnostics().addLag(ClockT::now() - timestamp);
 
           self.onUpdate(timestamp, top);
         }
@@ -48,41 +58,18 @@ class StrategyBase {
     return mDiagnostics;
   }
 
- private:
-  StrategyDiagnostics mDiagnostics = {};
-};
-
-template <class T>
-class Accumulator {
- public:
-  Accumulator(size_t n) : mN(n) {}
-
-  void add(T x) {
-    mData.push_back(x);
-    mAccum += x;
-
-    if (mData.size() > mN) {
-      mAccum -= mData.front();
-      mData.pop_front();
-    }
+  // Counters of the thread running the loop, nullptr to not count.
+  void setMetrics(simulator::ThreadMetrics* metrics) noexcept {
+    mMetrics = metrics;
   }
 
-  auto accum() const {
-    return mAccum;
-  }
-
-  auto size() const {
-    return mData.size();
-  }
-
-  auto avg() const {
-    return mAccum / mData.size();
+  [[nodiscard]] simulator::ThreadMetrics* metrics() const noexcept {
+    return mMetrics;
   }
 
  private:
-  T mAccum = {};
-  std::deque<T> mData;
-  size_t mN;
+  StrategyDiagnostics mDiagnostics = {};
+  simulator::ThreadMetrics* mMetrics = nullptr;
 };
 
 inline auto microprice(auto const& top) {
@@ -95,27 +82,48 @@ inline auto microprice(auto const& top) {
 
 class TestStrategy : private StrategyBase {
  public:
-  TestStrategy(simulator::OMS& oms, int symbolId, size_t k = 100, logging::Logger* logger = nullptr) : mLogger(logger), mAccumP(k), mAccumPSq(k), mSymbolId(symbolId), mOMS(oms) {}
+  struct Params {
+    size_t k = 100;  // microprices in the window of the mean and stdev
+
+    static constexpr auto fields() {
+      return std::tuple{Field{"k", &Params::k}};
+    }
+  };
+
+  TestStrategy(simulator::OMS& oms, int symbolId, size_t k = 100, logging::Logger* logger = nullptr) : mPrice(k), mSymbolId(symbolId), mOMS(oms), mClientId(oms.addClient()), mLogger(logger) {}
+  TestStrategy(simulator::OMS& oms, int symbolId, Params const& params, logging::Logger* logger = nullptr) : TestStrategy(oms, symbolId, params.k, logger) {}
 
   using StrategyBase::diagnostics;
   using StrategyBase::loop;
+  using StrategyBase::metrics;
+  using StrategyBase::setMetrics;
 
   void onUpdate(auto timestamp, auto const& top) noexcept {
+    mOMS.pollEvents(mClientId, [this](simulator::OrderEvent const& event) { onOrderEvent(event); });
+
     if (static_cast<int>(top.bid) == 0 || static_cast<int>(top.ask) == 0) return;
     auto const price = microprice(top);
 
     diagnostics().addObs(static_cast<double>(top.bid), static_cast<double>(top.ask));
 
-    mAccumP.add(price);
-    mAccumPSq.add(price * price);
-
-    auto const mean = mAccumP.avg();
-    auto const variance = mAccumPSq.avg() - mean * mean;
-    auto const stdev = std::sqrt(variance);
+    mPrice.add(price);
+    auto const mean = mPrice.mean();
+    auto const stdev = mPrice.stdev();
 
     auto const qty = 1;
 
-    if (!mPosition) {
+    if (mOpenOrder) {
+      // orders are meant to take liquidity when they arrive, what has not filled by the next update is cancelled
+      if (!mCancelSent) {
+        mOMS.cancel(mClientId, *mOpenOrder);
+        mCancelSent = true;
+      }
+      return;
+    }
+
+    auto const meanLevel = lob::LimitOrderBook::LevelT(static_cast<int>(std::lround(mean / lob::PrecisionMultiplier<lob::LimitOrderBook::Precision>::value)));
+
+    if (mPosition == 0) {
       if (static_cast<double>(top.bid) > mean + 2 * stdev) {
         
         if (mLogger) {
@@ -123,8 +131,7 @@ class TestStrategy : private StrategyBase {
           mLogger->log("bid > mean + 2 * stdev. {} > {}", static_cast<double>(top.bid), mean + 2 * stdev);
           mLogger->log("selling for {}", static_cast<double>(top.bid));
         }
-        mPosition = {static_cast<double>(top.bid), '-'};
-        // mOMS.limitOrder(mSymbolId, md::itch::types::BUY_SELL::SELL, qty, mean);
+        sendOrder(lob::Direction::Sell, qty, meanLevel);
       } else if (static_cast<double>(top.ask) < mean - 2 * stdev) {
 
         if (mLogger) {
@@ -132,20 +139,45 @@ class TestStrategy : private StrategyBase {
           mLogger->log("ask < mean - 2 * stdev. {} > {}", static_cast<double>(top.ask), mean - 2 * stdev);
           mLogger->log("buying for {}", static_cast<double>(top.ask));
         }
-        
-        mPosition = {static_cast<double>(top.ask), '+'};
-        // mOMS.limitOrder(mSymbolId, md::itch::types::BUY_SELL::SELL, qty, mean);
+        sendOrder(lob::Direction::Buy, qty, meanLevel);
       }
-    } else {
-      // try to close out position
+    } else if (mPosition > 0 && static_cast<double>(top.bid) >= mean) {
+      // back at the mean, close out the position
+      sendOrder(lob::Direction::Sell, static_cast<int>(mPosition), top.bid);
+    } else if (mPosition < 0 && static_cast<double>(top.ask) <= mean) {
+      sendOrder(lob::Direction::Buy, static_cast<int>(-mPosition), top.ask);
+    }
+  }
+
+  void onOrderEvent(simulator::OrderEvent const& event) noexcept {
+    if (event.kind == simulator::OrderEvent::Kind::Fill) {
+      auto const qty = event.direction == lob::Direction::Buy ? event.qty : -event.qty;
+      mPosition += qty;
+      diagnostics().addFill(qty, static_cast<double>(event.price));
     }
+    if (event.leaves == 0 && event.orderId == mOpenOrder) {
+      mOpenOrder.reset();
+      mCancelSent = false;
+    }
+  }
+
+  [[nodiscard]] int64_t position() const noexcept {
+    return mPosition;
+  }
+
+ private:
+  void sendOrder(lob::Direction direction, int qty, lob::LimitOrderBook::LevelT price) noexcept {
+    mOpenOrder = mOMS.limitOrder(mClientId, mSymbolId, direction, qty, price);
+    diagnostics().addOrder();
   }
 
-  Accumulator<double> mAccumP;
-  Accumulator<double> mAccumPSq;
+  RollingMoments mPrice;
   int mSymbolId;
   simulator::OMS& mOMS;
-  std::optional<std::tuple<double, char>> mPosition;
+  simulator::OMS::ClientId mClientId;
+  int64_t mPosition = 0;
+  std::optional<simulator::OMS::OrderId> mOpenOrder;
+  bool mCancelSent = false;
   logging::Logger* mLogger;
 };
 
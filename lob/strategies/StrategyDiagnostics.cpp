@@ -1,58 +1,101 @@
 #include "StrategyDiagnostics.h"
 
-#include <algorithm>
+#include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
-#include <numeric>
+#include <sstream>
 
-namespace std::chrono {
+namespace lob {
 
-void to_json(nlohmann::json& j, std::chrono::nanoseconds ns) {
-  j = ns.count();
+// summary plus the non-empty buckets as [lowest, highest, count]
+void to_json(nlohmann::json& j, LatencyHistogram const& histogram) {
+  auto buckets = nlohmann::json::array();
+  histogram.forEachBucket([&](uint64_t lowest, uint64_t highest, uint64_t count) { buckets.push_back({lowest, highest, count}); });
+
+  j = {
+      {"count", histogram.count()},
+      {"min", histogram.min()},
+      {"p50", histogram.valueAtPercentile(50)},
+      {"p90", histogram.valueAtPercentile(90)},
+      {"p99", histogram.valueAtPercentile(99)},
+      {"p99.9", histogram.valueAtPercentile(99.9)},
+      {"max", histogram.max()},
+      {"mean", histogram.mean()},
+      {"buckets", buckets}};
+}
+
+}  // namespace lob
+
+namespace strategies {
+
+void to_json(nlohmann::json& j, RunningSummary const& summary) {
+  j = {{"count", summary.count}, {"mean", summary.mean()}};
+  if (summary.count) {
+    j["min"] = summary.min;
+    j["max"] = summary.max;
+  }
 }
 
-}  // namespace std::chrono
+}  // namespace strategies
+
+void strategies::StrategyDiagnostics::streamTo(std::string const& prefix) {
+  mColumns = std::make_shared<Columns>(prefix);
+}
 
 std::string strategies::StrategyDiagnostics::toString() const noexcept {
   std::stringstream ss;
-  ss << "Num obs: " << bids.size() << ", " << asks.size() << std::endl;
-  
-  if (bids.size()) {
-    auto [bidsMin, bidsMax] = std::ranges::minmax_element(bids);
-    ss << "Avg bid: " << std::accumulate(bids.begin(), bids.end(), 0.0) / bids.size() << std::endl;
-    ss << "Min/max bid: " << *bidsMin << " " << *bidsMax << std::endl;
+  ss << "Num obs: " << bids.count << ", " << asks.count << std::endl;
+
+  if (bids.count) {
+    ss << "Avg bid: " << bids.mean() << std::endl;
+    ss << "Min/max bid: " << bids.min << " " << bids.max << std::endl;
   }
 
-  if (asks.size()) {
-    auto [asksMin, asksMax] = std::ranges::minmax_element(asks);
-    ss << "Avg ask: " << std::accumulate(asks.begin(), asks.end(), 0.0) / asks.size() << std::endl;
-    ss << "Min/max ask: " << *asksMin << " " << *asksMax << std::endl;
+  if (asks.count) {
+    ss << "Avg ask: " << asks.mean() << std::endl;
+    ss << "Min/max ask: " << asks.min << " " << asks.max << std::endl;
   }
-  
+
   ss << "Buffer overflows: " << numBufferOverflows << std::endl;
   ss << "Updates missed: " << numUpdatesMissed << std::endl;
   ss << "Max buffer size: " << maxBufferSize << std::endl;
 
-  if (lags.size()) {
-    auto [lagsMin, lagsMax] = std::ranges::minmax_element(lags);
-    auto lagsAvg = std::accumulate(lags.begin(), lags.end(), std::chrono::nanoseconds(0), [](auto accum, auto lag) { return accum + lag; }) / lags.size();
-    ss << "Average lag: " << lagsAvg << std::endl;
-    ss << "Min/max lag: " << *lagsMin << " " << *lagsMax << std::endl;
+  if (numOrders) {
+    ss << "Orders/fills: " << numOrders << "/" << numFills << std::endl;
+    ss << "Position: " << position << ", cash: " << cash << std::endl;
+  }
+
+  if (lags.count()) {
+    ss << "Lag: " << lags.summary() << std::endl;
   }
   return ss.str();
 }
 
-void strategies::StrategyDiagnostics::save(std::string const& filename) const {
-
+void strategies::StrategyDiagnostics::save(std::string const& filename) {
   nlohmann::json j;
   j["lags"] = lags;
   j["bids"] = bids;
   j["asks"] = asks;
+  j["numBufferOverflows"] = numBufferOverflows;
+  j["numUpdatesMissed"] = numUpdatesMissed;
+  j["maxBufferSize"] = maxBufferSize;
+  j["numOrders"] = numOrders;
+  j["numFills"] = numFills;
+  j["position"] = position;
+  j["cash"] = cash;
+
+  if (mColumns) {
+    mColumns->bids.close();
+    mColumns->asks.close();
+    // relative to the JSON file, as both are written next to each other
+    auto const name = std::filesystem::path(mColumns->prefix).filename().string();
+    j["bids"]["file"] = name + ".bids.npy";
+    j["asks"]["file"] = name + ".asks.npy";
+  }
 
   auto file = std::ofstream(filename);
   if (!file.is_open()) throw std::runtime_error(std::format("Could not open output file '{}'", filename));
   file << j.dump();
-
 }
@@ -1,25 +1,76 @@
 #pragma once
 
+#include <lob/LatencyHistogram.h>
+
+#include <algorithm>
 #include <chrono>
-#include <vector>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "NpyWriter.h"
 
 namespace strategies {
 
+// Count, sum and extremes of a series, kept instead of the series itself.
+struct RunningSummary {
+  size_t count = 0;
+  double sum = 0.0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+
+  void add(double x) noexcept {
+    ++count;
+    sum += x;
+    min = std::min(min, x);
+    max = std::max(max, x);
+  }
+
+  [[nodiscard]] double mean() const noexcept {
+    return count ? sum / static_cast<double>(count) : 0.0;
+  }
+};
+
 struct StrategyDiagnostics {
   size_t numBufferOverflows = 0;
   size_t numUpdatesMissed = 0;
   size_t maxBufferSize = 0;
-  std::vector<double> bids;
-  std::vector<double> asks;
-  std::vector<std::chrono::nanoseconds> lags;
+  RunningSummary bids;
+  RunningSummary asks;
+  lob::LatencyHistogram lags;
+  size_t numOrders = 0;
+  size_t numFills = 0;
+  int64_t position = 0;  // signed, bought minus sold
+  double cash = 0.0;     // received for sales minus paid for buys
 
-  void addLag(std::chrono::nanoseconds lag) {
-    lags.push_back(lag);
+  // Streams every observation to <prefix>.bids.npy and <prefix>.asks.npy while running; without
+  // it only the summaries are kept. Copies of the diagnostics share the files.
+  void streamTo(std::string const& prefix);
+
+  void addLag(std::chrono::nanoseconds lag) noexcept {
+    lags.record(lag);
   }
 
-  void addObs(double b, double a) {
-    if (b > 0) bids.push_back(b);
-    if (a > 0) asks.push_back(a);
+  void addObs(double b, double a) noexcept {
+    if (b > 0) {
+      bids.add(b);
+      if (mColumns) mColumns->bids.push(b);
+    }
+    if (a > 0) {
+      asks.add(a);
+      if (mColumns) mColumns->asks.push(a);
+    }
+  }
+
+  void addOrder() noexcept {
+    ++numOrders;
+  }
+
+  // qty is positive for a buy, negative for a sale
+  void addFill(int qty, double price) noexcept {
+    ++numFills;
+    position += qty;
+    cash -= qty * price;
   }
 
   void bufferLoad(size_t readIdx, size_t m, size_t M) {
@@ -30,7 +81,27 @@ struct StrategyDiagnostics {
   }
 
   [[nodiscard]] std::string toString() const noexcept;
-  void save(std::string const& filename) const;
+
+  // Completes the streamed columns and writes the summaries as JSON, naming the column files.
+  // Throws if a column could not be written. Observations added after this are only counted in
+  // numObsDropped, for every copy sharing the columns.
+  void save(std::string const& filename);
+
+  // observations that reached the streamed columns after save
+  [[nodiscard]] size_t numObsDropped() const noexcept {
+    return mColumns ? mColumns->bids.numDropped() + mColumns->asks.numDropped() : 0;
+  }
+
+ private:
+  struct Columns {
+    explicit Columns(std::string const& prefix) : prefix(prefix), bids(prefix + ".bids.npy"), asks(prefix + ".asks.npy") {}
+
+    std::string prefix;
+    NpyWriter<double> bids;
+    NpyWriter<double> asks;
+  };
+
+  std::shared_ptr<Columns> mColumns;
 };
 
 }  // namespace strategies
@@ -1,7 +1,14 @@
 ﻿#include <gtest/gtest.h>
+#include <lob/LatencyHistogram.h>
 #include <lob/RingBuffer.h>
+#include <lob/Tsc.h>
+#include <lob/VirtualQueue.h>
 #include <lob/lob.h>
 
+#include <random>
+#include <thread>
+#include <vector>
+
 namespace {
 
 static_assert(lob::PrecisionMultiplier<0>::value == 1.0000);
@@ -358,4 +365,147 @@ TEST(LOB, RingBufferAsync) {
   }
 }
 
+TEST(LOB, LatencyHistogram) {
+  for (uint64_t value : {0ull, 1ull, 127ull, 128ull, 129ull, 1000ull, 123456ull, 1ull << 39}) {
+    auto const index = lob::LatencyHistogram::bucketIndex(value);
+    ASSERT_LE(lob::LatencyHistogram::bucketLowest(index), value);
+    ASSERT_GE(lob::LatencyHistogram::bucketHighest(index), value);
+    ASSERT_EQ(lob::LatencyHistogram::bucketIndex(lob::LatencyHistogram::bucketHighest(index) + 1), index + 1);
+  }
+
+  lob::LatencyHistogram a;
+  lob::LatencyHistogram b;
+  for (uint64_t value = 1; value <= 10000; ++value) {
+    (value % 2 ? a : b).record(value * 100);
+  }
+  a.merge(b);
+
+  ASSERT_EQ(a.count(), 10000);
+  ASSERT_EQ(a.min(), 100);
+  ASSERT_EQ(a.max(), 1000000);
+  ASSERT_DOUBLE_EQ(a.mean(), 500050.0);
+  for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+    auto const expected = percentile * 10000.0;
+    ASSERT_NEAR(static_cast<double>(a.valueAtPercentile(percentile)), expected, expected / 64);
+  }
+  ASSERT_EQ(a.valueAtPercentile(100), 1000000);
+
+  a.reset();
+  ASSERT_EQ(a.count(), 0);
+  ASSERT_EQ(a.valueAtPercentile(50), 0);
+}
+
+TEST(LOB, TscClock) {
+  static_assert(std::chrono::is_clock_v<lob::TscClock>);
+
+  lob::calibrateTsc();
+  auto const start = lob::TscClock::now();
+  auto const steadyStart = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto const elapsed = lob::TscClock::now() - start;
+  auto const steadyElapsed = std::chrono::steady_clock::now() - steadyStart;
+
+  // a ratio, as the thread can be descheduled between the two clock reads on a busy host
+  ASSERT_GT(elapsed, std::chrono::nanoseconds(0));
+  auto const ratio = static_cast<double>(elapsed.count()) / static_cast<double>(std::chrono::nanoseconds(steadyElapsed).count());
+  ASSERT_GT(ratio, 0.8);
+  ASSERT_LT(ratio, 1.25);
+}
+
+
+TEST(LOB, VirtualOrders) {
+  auto book = lob::LimitOrderBook();
+  using Level = lob::LimitOrderBook::LevelT;
+  auto const level = Level(1000000);
+
+  auto const a = book.addOrder(lob::Direction::Buy, 100, level);
+  auto const b = book.addOrder(lob::Direction::Buy, 50, level);
+  book.addVirtualOrder(1, lob::Direction::Buy, level);
+  auto const c = book.addOrder(lob::Direction::Buy, 70, level);
+  book.addVirtualOrder(2, lob::Direction::Buy, level);
+
+  // not part of the book
+  ASSERT_EQ(book.bidDepth(), 220);
+  ASSERT_EQ(book.queueAhead(1), 150);
+  ASSERT_EQ(book.queueAhead(2), 220);
+
+  // only orders that joined before a virtual order count for it
+  book.executeOrder(a, 40);
+  book.reduceOrder(c, 20);
+  book.deleteOrder(b);
+  ASSERT_EQ(book.queueAhead(1), 60);
+  ASSERT_EQ(book.queueAhead(2), 110);
+
+  auto const ahead = [&](lob::OrderId orderId) {
+    auto ids = std::vector<lob::LimitOrderBook::VirtualOrderId>();
+    book.forEachVirtualOrderAhead(orderId, [&](auto id) {
+      ids.push_back(id);
+      return true;
+    });
+    return ids;
+  };
+  ASSERT_EQ(ahead(a), (std::vector<lob::LimitOrderBook::VirtualOrderId>{}));
+  ASSERT_EQ(ahead(c), (std::vector<lob::LimitOrderBook::VirtualOrderId>{1}));
+
+  // a replaced order loses its place, even at the same price
+  book.replaceOrder(a, lob::OrderId(99), 60, level);
+  ASSERT_EQ(book.queueAhead(1), 0);
+  ASSERT_EQ(book.queueAhead(2), 50);
+  ASSERT_EQ(ahead(lob::OrderId(99)), (std::vector<lob::LimitOrderBook::VirtualOrderId>{1, 2}));
+
+  ASSERT_TRUE(book.deleteVirtualOrder(1));
+  ASSERT_FALSE(book.deleteVirtualOrder(1));
+  ASSERT_FALSE(book.queueAhead(1));
+
+  // the level goes, the virtual order stays at the front of it
+  book.deleteOrder(c);
+  book.deleteOrder(lob::OrderId(99));
+  ASSERT_FALSE(book.hasBids());
+  ASSERT_EQ(book.queueAhead(2), 0);
+  ASSERT_EQ(book.numVirtualOrders(), 1);
+}
+
+TEST(LOB, VirtualQueueMatchesNaive) {
+  struct Naive {
+    uint64_t id;
+    uint64_t seq;
+    int ahead;
+  };
+
+  auto queue = lob::VirtualQueue();
+  auto naive = std::vector<Naive>();
+  auto rng = std::mt19937(42);
+  uint64_t seq = 0;
+  uint64_t nextId = 0;
+
+  for (int i = 0; i != 20000; ++i) {
+    // grows, then shrinks so that removed entries get compacted
+    auto const r = rng() % 6;
+    auto const op = r < (i < 10000 ? 3 : 1) ? 0 : r < 4 ? 1 : 2;
+    if (op == 0 || naive.empty()) {
+      auto const ahead = static_cast<int>(rng() % 1000) + 1000000;
+      queue.add(nextId, seq, ahead);
+      naive.push_back({nextId++, seq++, ahead});
+    } else if (op == 1) {
+      // a real order that joined anywhere so far shrinks
+      auto const realSeq = rng() % (seq + 1);
+      auto const qty = static_cast<int>(rng() % 10) + 1;
+      queue.reduce(realSeq, qty);
+      for (auto& entry : naive) {
+        if (entry.seq > realSeq) entry.ahead -= qty;
+      }
+      ++seq;
+    } else {
+      auto const it = naive.begin() + static_cast<ptrdiff_t>(rng() % naive.size());
+      ASSERT_TRUE(queue.remove(it->id));
+      naive.erase(it);
+    }
+
+    if (i % 100 == 0) {
+      ASSERT_EQ(queue.size(), naive.size());
+      for (auto const& entry : naive) ASSERT_EQ(queue.ahead(entry.id), entry.ahead);
+    }
+  }
+}
+
 }  // namespace
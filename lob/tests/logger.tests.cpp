@@ -0,0 +1,277 @@
+#include <gtest/gtest.h>
+#include <logger/FileSink.h>
+#include <logger/Logger.h>
+#include <logger/MpscQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Formatting these records the thread it ran on. Traced is a plain value, TracedName is not.
+struct Traced {
+  int value = 0;
+};
+
+struct TracedName {
+  std::string name;
+};
+
+std::atomic<std::thread::id> tracedFormattedOn;
+std::atomic<std::thread::id> tracedNameFormattedOn;
+
+}  // namespace
+
+template <>
+struct std::formatter<Traced> : std::formatter<int> {
+  auto format(Traced const& traced, std::format_context& ctx) const {
+    tracedFormattedOn = std::this_thread::get_id();
+    return std::formatter<int>::format(traced.value, ctx);
+  }
+};
+
+template <>
+struct std::formatter<TracedName> : std::formatter<std::string_view> {
+  auto format(TracedName const& traced, std::format_context& ctx) const {
+    tracedNameFormattedOn = std::this_thread::get_id();
+    return std::formatter<std::string_view>::format(traced.name, ctx);
+  }
+};
+
+namespace {
+
+// Keeps the messages written by the logger thread.
+class CapturingSink : public logging::Sink {
+ public:
+  CapturingSink(std::vector<std::string>& messages, std::mutex& mutex) : mMessages(messages), mMutex(mutex) {}
+
+  void write(logging::LogMessage const& msg) override {
+    auto const lock = std::scoped_lock(mMutex);
+    mMessages.push_back(msg.msg);
+  }
+
+ private:
+  std::vector<std::string>& mMessages;
+  std::mutex& mMutex;
+};
+
+struct Item {
+  uint32_t producer = 0;
+  uint32_t seq = 0;
+  // checks the value is never read half written
+  uint64_t check = 0;
+};
+
+constexpr uint64_t checksum(uint32_t producer, uint32_t seq) {
+  return (static_cast<uint64_t>(producer) << 32 | seq) * 0x9e3779b97f4a7c15;
+}
+
+// Several producers push into a small queue while one consumer drains it. Every value must
+// arrive intact and in order per producer; what is lost must be counted.
+void stress(logging::FullPolicy policy) {
+  constexpr uint32_t NumProducers = 4;
+  constexpr uint32_t NumItems = 200000;
+
+  auto queue = logging::MpscQueue<Item>(64, policy);
+  std::atomic<uint32_t> numDone = 0;
+
+  auto producers = std::vector<std::jthread>();
+  for (uint32_t p = 0; p != NumProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (uint32_t i = 0; i != NumItems; ++i) {
+        queue.push([&](Item& item) { item = {p, i, checksum(p, i)}; });
+      }
+      ++numDone;
+    });
+  }
+
+  auto next = std::vector<uint32_t>(NumProducers, 0);
+  uint64_t numReceived = 0;
+  auto const consume = [&](Item const& item) {
+    ASSERT_EQ(item.check, checksum(item.producer, item.seq));
+    ASSERT_GE(item.seq, next[item.producer]);
+    next[item.producer] = item.seq + 1;
+    ++numReceived;
+  };
+
+  while (numDone != NumProducers) {
+    if (!queue.pop(consume)) std::this_thread::yield();
+  }
+  while (queue.pop(consume)) {
+  }
+
+  ASSERT_EQ(numReceived + queue.numDropped(), uint64_t(NumProducers) * NumItems);
+  if (policy == logging::FullPolicy::Block) {
+    ASSERT_EQ(queue.numDropped(), 0);
+  }
+}
+
+TEST(Logger, MpscQueueDropNewest) {
+  stress(logging::FullPolicy::DropNewest);
+}
+
+TEST(Logger, MpscQueueOverwriteOldest) {
+  stress(logging::FullPolicy::OverwriteOldest);
+}
+
+TEST(Logger, MpscQueueBlock) {
+  stress(logging::FullPolicy::Block);
+}
+
+TEST(Logger, MpscQueuePolicies) {
+  auto dropNewest = logging::MpscQueue<int>(4, logging::FullPolicy::DropNewest);
+  auto overwriteOldest = logging::MpscQueue<int>(4, logging::FullPolicy::OverwriteOldest);
+  for (int i = 0; i != 6; ++i) {
+    dropNewest.push([i](int& v) { v = i; });
+    overwriteOldest.push([i](int& v) { v = i; });
+  }
+
+  auto const drain = [](auto& queue) {
+    auto values = std::vector<int>();
+    while (queue.pop([&](int v) { values.push_back(v); })) {
+    }
+    return values;
+  };
+
+  ASSERT_EQ(drain(dropNewest), (std::vector{0, 1, 2, 3}));
+  ASSERT_EQ(dropNewest.numDropped(), 2);
+  ASSERT_EQ(drain(overwriteOldest), (std::vector{2, 3, 4, 5}));
+  ASSERT_EQ(overwriteOldest.numDropped(), 2);
+}
+
+TEST(Logger, DeferredFormatting) {
+  // pointers and views may dangle by the time the logger thread formats
+  static_assert(logging::detail::fitsRecord<int, double, Traced>);
+  static_assert(!logging::detail::Deferrable<std::string_view>);
+  static_assert(!logging::detail::Deferrable<char const*>);
+  static_assert(!logging::detail::Deferrable<TracedName>);
+
+  auto messages = std::vector<std::string>();
+  auto mutex = std::mutex();
+  {
+    auto logger = logging::Logger(64, std::make_unique<CapturingSink>(messages, mutex), std::chrono::milliseconds(1));
+    logger.log("int {} double {:.3f} traced {}", 42, 2.5, Traced{7});
+    auto const view = std::string_view("view");
+    logger.log("mixed {} {} {} {}", -1, 0.125, view, "literal");
+    logger.log("name {:>5}", TracedName{"QQQ"});
+  }
+
+  ASSERT_EQ(messages, (std::vector<std::string>{"int 42 double 2.500 traced 7", "mixed -1 0.125 view literal", "name   QQQ"}));
+  // plain values are formatted on the logger thread, anything else falls back to the caller's
+  EXPECT_NE(tracedFormattedOn.load(), std::this_thread::get_id());
+  EXPECT_EQ(tracedNameFormattedOn.load(), std::this_thread::get_id());
+}
+
+TEST(Logger, QueueFormattedMessagesAndOverflow) {
+  auto queue = logging::Queue(4);
+  queue.push([](logging::LogRecord& record) { record.format = nullptr; record.msg = "formatted"; });
+  queue.push(std::string("moved"));
+
+  ASSERT_EQ(queue.pop()->msg, "formatted");
+  ASSERT_EQ(queue.pop()->msg, "moved");
+  ASSERT_FALSE(queue.pop());
+
+  for (int i = 0; i != 6; ++i) {
+    queue.push(std::to_string(i));
+  }
+  auto const missed = queue.pop();
+  ASSERT_TRUE(missed->overflow);
+  ASSERT_EQ(missed->msg, "Missed 2 messages");
+  ASSERT_EQ(queue.pop()->msg, "2");
+}
+
+TEST(Logger, FileSinkRotation) {
+  auto const dir = std::filesystem::temp_directory_path() / "lob_logger_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  auto const path = dir / "test.log";
+
+  constexpr int NumMessages = 20000;
+  {
+    auto options = logging::FileSinkOptions{.bufferSize = 4096, .maxFileSize = 64 << 10, .maxFiles = 100};
+    auto logger = logging::Logger(256, std::make_unique<logging::FileSink>(path, options), std::chrono::milliseconds(1), logging::FullPolicy::Block);
+    for (int i = 0; i != NumMessages; ++i) {
+      logger.log("message {}", i);
+    }
+  }
+
+  // the files are test.log, then test.log.1 and up from the newest rotated to the oldest, none over
+  // the limit, and read oldest first they hold every message once, whole and in order
+  auto numFiles = 0;
+  for (auto const& entry : std::filesystem::directory_iterator(dir)) {
+    ASSERT_LE(entry.file_size(), 64u << 10);
+    ++numFiles;
+  }
+  ASSERT_GT(numFiles, 2);
+  auto const fileName = [&path](int i) {
+    auto name = path;
+    if (i) name += std::format(".{}", i);
+    return name;
+  };
+  auto next = 0;
+  for (int i = numFiles - 1; i >= 0; --i) {
+    ASSERT_TRUE(std::filesystem::exists(fileName(i))) << fileName(i);
+    auto in = std::ifstream(fileName(i), std::ios::binary);
+    auto const content = std::string(std::istreambuf_iterator<char>(in), {});
+    ASSERT_TRUE(content.ends_with('\n')) << fileName(i);
+    for (auto const line : std::views::split(std::string_view(content).substr(0, content.size() - 1), '\n')) {
+      ASSERT_TRUE(std::string_view(line.begin(), line.end()).ends_with(std::format(": message {}", next))) << fileName(i);
+      ++next;
+    }
+  }
+  ASSERT_EQ(next, NumMessages);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(Logger, FileSinkTruncatesUnlessAppending) {
+  auto const dir = std::filesystem::temp_directory_path() / "lob_logger_test_append";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  auto const path = dir / "test.log";
+  auto const run = [&path](bool append, int i) {
+    auto logger = logging::Logger(16, std::make_unique<logging::FileSink>(path, logging::FileSinkOptions{.append = append}), std::chrono::milliseconds(1));
+    logger.log("run {}", i);
+  };
+  auto const lines = [&path] {
+    auto result = std::vector<std::string>();
+    auto in = std::ifstream(path);
+    for (auto line = std::string(); std::getline(in, line);) result.push_back(line);
+    return result;
+  };
+
+  run(false, 0);
+  run(false, 1);
+  auto truncated = lines();
+  ASSERT_EQ(truncated.size(), 1);
+  EXPECT_TRUE(truncated[0].ends_with(": run 1"));
+
+  run(true, 2);
+  auto appended = lines();
+  ASSERT_EQ(appended.size(), 2);
+  EXPECT_TRUE(appended[0].ends_with(": run 1"));
+  EXPECT_TRUE(appended[1].ends_with(": run 2"));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(Logger, FileSinkCountsFailedWrites) {
+  if (!std::filesystem::exists("/dev/full")) GTEST_SKIP() << "needs /dev/full";
+  auto sink = logging::FileSink("/dev/full");
+  for (uint64_t i = 1; i != 3; ++i) {
+    sink.write({std::chrono::system_clock::now(), "message"});
+    sink.flush();
+    EXPECT_EQ(sink.numFailedWrites(), i);
+  }
+}
+
+}  // namespace
@@ -1,22 +1,37 @@
 ﻿#include <gtest/gtest.h>
+#include <lob/lob.h>
 #include <md/BinaryDataReader.h>
+#include <md/ItchGenerator.h>
+#include <md/ItchReplay.h>
 #include <md/MappedFile.h>
 #include <md/Symbols.h>
+#include <md/itch/Dispatch.h>
+#include <md/itch/ItchWriter.h>
 #include <md/itch/MessageReaders.h>
+#include <md/itch/ParallelReader.h>
+#include <simulator/ItchToLobType.h>
 
+#include <array>
+#include <filesystem>
+#include <random>
 #include <ranges>
+#include <sstream>
+#include <type_traits>
 
 namespace {
 
 using namespace std::string_literals;
 
-auto getTestFile() {
+auto getTestFilename() {
 #ifdef _WIN32
-  auto const filename = "C:\\dev\\VS\\lob\\data\\01302019.NASDAQ_ITCH50"s;
+  return "C:\\dev\\VS\\lob\\data\\01302019.NASDAQ_ITCH50"s;
 #else
-  auto const filename = "/mnt/itch-data/01302019.NASDAQ_ITCH50";
+  return "/mnt/itch-data/01302019.NASDAQ_ITCH50"s;
 #endif
-  return md::MappedFile(filename);
+}
+
+auto getTestFile() {
+  return md::MappedFile(getTestFilename());
 }
 
 auto constexpr static maxCount = 100000000;
@@ -63,6 +78,370 @@ TEST(ItchReader, CountMessageTypes) {
   ASSERT_EQ(counts[md::itch::messages::MessageType::REPLACE_ORDER], 7840455);
 }
 
+TEST(ItchReader, FindMessageBoundary) {
+  auto data = std::string();
+  auto boundaries = std::vector<size_t>();
+  for (auto const type : {'A', 'D', 'E', 'U', 'X', 'A', 'F', 'D', 'C', 'D'}) {
+    auto const msglen = md::itch::messages::netlenByType[type];
+    boundaries.push_back(data.size());
+    data.push_back(0);
+    data.push_back(static_cast<char>(msglen));
+    data.push_back(type);
+    data.append(msglen - 1, '\0');
+  }
+  boundaries.push_back(data.size());
+
+  for (size_t offset = 0; offset != data.size(); ++offset) {
+    auto const expected = *std::ranges::lower_bound(boundaries, offset);
+    ASSERT_EQ(md::itch::findMessageBoundary(data.data(), data.size(), offset, 4), expected);
+  }
+
+  auto const chunks = md::itch::splitIntoChunks(data.data(), data.size(), 3);
+  ASSERT_EQ(chunks.size(), 4);
+  ASSERT_EQ(chunks.front(), 0);
+  ASSERT_EQ(chunks.back(), data.size());
+  for (auto const chunk : chunks) {
+    ASSERT_TRUE(std::ranges::binary_search(boundaries, chunk));
+  }
+}
+
+TEST(ItchReader, Dispatch) {
+  auto data = std::string();
+  for (auto const type : {'A', 'D', 'Z', 'D', 'E', 'F'}) {
+    auto const msglen = type == 'Z' ? 7 : md::itch::messages::netlenByType[type];
+    data.push_back(0);
+    data.push_back(static_cast<char>(msglen));
+    data.push_back(type);
+    data.append(msglen - 1, '\0');
+  }
+
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+
+  auto numDeletes = 0;
+  auto numAdds = 0;
+  auto visitor = md::itch::overloaded{
+      [&](itch_message<MessageType::DELETE_ORDER> const&) { ++numDeletes; },
+      [&](itch_message<MessageType::ADD_ORDER> const&) { ++numAdds; }};
+
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto numVisited = 0;
+  while (reader.remaining() > 3) {
+    numVisited += md::itch::dispatch(reader, visitor);
+  }
+
+  ASSERT_EQ(reader.remaining(), 0);
+  ASSERT_EQ(numVisited, 3);
+  ASSERT_EQ(numDeletes, 2);
+  ASSERT_EQ(numAdds, 1);
+}
+
+TEST(ItchReader, ParseTradeMessages) {
+  auto const putBigEndian = [](std::string& msg, size_t offset, uint64_t value, size_t width) {
+    for (size_t i = 0; i != width; ++i) {
+      msg[offset + i] = static_cast<char>(value >> (8 * (width - 1 - i)));
+    }
+  };
+
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+
+  {
+    auto msg = std::string(md::itch::messages::netlen<MessageType::TRADE>, '\0');
+    msg[0] = 'P';
+    putBigEndian(msg, 1, 6449, 2);
+    putBigEndian(msg, 5, 34200000000123, 6);
+    putBigEndian(msg, 11, 987654321, 8);
+    msg[19] = 'B';
+    putBigEndian(msg, 20, 300, 4);
+    putBigEndian(msg, 32, 1634500, 4);
+    putBigEndian(msg, 36, 424242, 8);
+
+    auto const trade = itch_message<MessageType::TRADE>::parse(msg.data());
+    ASSERT_EQ(trade.stock_locate, 6449);
+    ASSERT_EQ(trade.timestamp.count(), 34200000000123);
+    ASSERT_EQ(static_cast<uint64_t>(trade.oid), 987654321);
+    ASSERT_EQ(trade.buy, md::itch::types::BUY_SELL::BUY);
+    ASSERT_EQ(static_cast<uint32_t>(trade.qty), 300);
+    ASSERT_EQ(static_cast<uint32_t>(trade.price), 1634500);
+    ASSERT_EQ(trade.match_number, 424242);
+  }
+
+  {
+    auto msg = std::string(md::itch::messages::netlen<MessageType::CROSS_TRADE>, '\0');
+    msg[0] = 'Q';
+    putBigEndian(msg, 1, 7291, 2);
+    putBigEndian(msg, 11, 5000000000, 8);
+    putBigEndian(msg, 27, 2645000, 4);
+    putBigEndian(msg, 31, 99, 8);
+    msg[39] = 'O';
+
+    auto const cross = itch_message<MessageType::CROSS_TRADE>::parse(msg.data());
+    ASSERT_EQ(cross.stock_locate, 7291);
+    ASSERT_EQ(cross.shares, 5000000000);
+    ASSERT_EQ(static_cast<uint32_t>(cross.price), 2645000);
+    ASSERT_EQ(cross.match_number, 99);
+    ASSERT_EQ(cross.cross_type, 'O');
+  }
+
+  {
+    auto msg = std::string(md::itch::messages::netlen<MessageType::NET_ORDER_IMBALANCE>, '\0');
+    msg[0] = 'I';
+    putBigEndian(msg, 1, 331, 2);
+    putBigEndian(msg, 11, 120000, 8);
+    putBigEndian(msg, 19, 3500, 8);
+    msg[27] = 'S';
+    putBigEndian(msg, 36, 210000, 4);
+    putBigEndian(msg, 40, 210500, 4);
+    putBigEndian(msg, 44, 211000, 4);
+    msg[48] = 'C';
+
+    auto const imbalance = itch_message<MessageType::NET_ORDER_IMBALANCE>::parse(msg.data());
+    ASSERT_EQ(imbalance.stock_locate, 331);
+    ASSERT_EQ(imbalance.paired_shares, 120000);
+    ASSERT_EQ(imbalance.imbalance_shares, 3500);
+    ASSERT_EQ(imbalance.imbalance_direction, 'S');
+    ASSERT_EQ(static_cast<uint32_t>(imbalance.far_price), 210000);
+    ASSERT_EQ(static_cast<uint32_t>(imbalance.near_price), 210500);
+    ASSERT_EQ(static_cast<uint32_t>(imbalance.reference_price), 211000);
+    ASSERT_EQ(imbalance.cross_type, 'C');
+  }
+}
+
+TEST(ItchReader, ParseMatchesReferenceDecoder) {
+  // byte at a time, independent of read_bytes
+  auto const reference = [](char const* ptr, size_t offset, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i != width; ++i) {
+      value = (value << 8) | static_cast<unsigned char>(ptr[offset + i]);
+    }
+    return value;
+  };
+
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+
+  auto rng = std::mt19937_64(42);
+  auto msg = std::array<char, 64>();
+
+  for (int i = 0; i != 10000; ++i) {
+    // parse at every alignment to catch unaligned loads
+    auto* const ptr = msg.data() + i % 8;
+    std::ranges::generate(msg, [&] { return static_cast<char>(rng()); });
+
+    auto const add = itch_message<MessageType::ADD_ORDER>::parse(ptr);
+    ASSERT_EQ(add.stock_locate, reference(ptr, 1, 2));
+    ASSERT_EQ(static_cast<uint64_t>(add.timestamp.count()), reference(ptr, 5, 6));
+    ASSERT_EQ(static_cast<uint64_t>(add.oid), reference(ptr, 11, 8));
+    ASSERT_EQ(static_cast<char>(add.buy), ptr[19]);
+    ASSERT_EQ(static_cast<uint32_t>(add.qty), reference(ptr, 20, 4));
+    ASSERT_EQ(static_cast<uint32_t>(add.price), reference(ptr, 32, 4));
+
+    auto const exec = itch_message<MessageType::EXECUTE_ORDER_WITH_PRICE>::parse(ptr);
+    ASSERT_EQ(exec.exec.stock_locate, reference(ptr, 1, 2));
+    ASSERT_EQ(static_cast<uint64_t>(exec.exec.timestamp.count()), reference(ptr, 5, 6));
+    ASSERT_EQ(static_cast<uint64_t>(exec.exec.oid), reference(ptr, 11, 8));
+    ASSERT_EQ(static_cast<uint32_t>(exec.exec.qty), reference(ptr, 19, 4));
+    ASSERT_EQ(exec.printable, ptr[31]);
+    ASSERT_EQ(static_cast<uint32_t>(exec.price), reference(ptr, 32, 4));
+
+    auto const replace = itch_message<MessageType::REPLACE_ORDER>::parse(ptr);
+    ASSERT_EQ(replace.stock_locate, reference(ptr, 1, 2));
+    ASSERT_EQ(static_cast<uint64_t>(replace.oid), reference(ptr, 11, 8));
+    ASSERT_EQ(static_cast<uint64_t>(replace.new_order_id), reference(ptr, 19, 8));
+    ASSERT_EQ(static_cast<uint32_t>(replace.new_qty), reference(ptr, 27, 4));
+    ASSERT_EQ(static_cast<uint32_t>(replace.new_price), reference(ptr, 31, 4));
+
+    auto const del = itch_message<MessageType::DELETE_ORDER>::parse(ptr);
+    ASSERT_EQ(static_cast<uint64_t>(del.oid), reference(ptr, 11, 8));
+
+    auto const imbalance = itch_message<MessageType::NET_ORDER_IMBALANCE>::parse(ptr);
+    ASSERT_EQ(imbalance.paired_shares, reference(ptr, 11, 8));
+    ASSERT_EQ(imbalance.imbalance_shares, reference(ptr, 19, 8));
+    ASSERT_EQ(static_cast<uint32_t>(imbalance.reference_price), reference(ptr, 44, 4));
+  }
+}
+
+TEST(ItchWriter, RoundTrip) {
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+  using namespace md::itch::types;
+
+  auto out = std::ostringstream();
+  {
+    auto writer = md::itch::ItchWriter(out, 64);
+    writer.write(itch_message<MessageType::STOCK_DIRECTORY>(12, timestamp_t(uint64_t(5)), 'Q', "QQQ"));
+    writer.write(itch_message<MessageType::ADD_ORDER>(timestamp_t(uint64_t(34200000000123)), oid_t(987654321), price_t(1634500), qty_t(300), 12, BUY_SELL::SELL));
+    writer.write(itch_message<MessageType::REPLACE_ORDER>(timestamp_t(uint64_t(34200000000124)), oid_t(987654321), oid_t(987654322), qty_t(200), price_t(1634600), 12));
+    writer.write(itch_message<MessageType::DELETE_ORDER>(oid_t(987654322), timestamp_t(uint64_t(34200000000125)), 12));
+    ASSERT_EQ(writer.numMessages(), 4);
+  }
+
+  auto const data = out.str();
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto numVisited = 0;
+  auto visitor = md::itch::overloaded{
+      [&](itch_message<MessageType::STOCK_DIRECTORY> const& msg) {
+        ASSERT_EQ(msg.stock_locate, 12);
+        ASSERT_EQ(msg.stock, "QQQ     "s);
+        ASSERT_EQ(msg.marketCategory, 'Q');
+      },
+      [&](itch_message<MessageType::ADD_ORDER> const& msg) {
+        ASSERT_EQ(msg.timestamp.count(), 34200000000123);
+        ASSERT_EQ(static_cast<uint64_t>(msg.oid), 987654321);
+        ASSERT_EQ(static_cast<uint32_t>(msg.price), 1634500);
+        ASSERT_EQ(static_cast<uint32_t>(msg.qty), 300);
+        ASSERT_EQ(msg.buy, BUY_SELL::SELL);
+      },
+      [&](itch_message<MessageType::REPLACE_ORDER> const& msg) {
+        ASSERT_EQ(static_cast<uint64_t>(msg.new_order_id), 987654322);
+        ASSERT_EQ(static_cast<uint32_t>(msg.new_qty), 200);
+        ASSERT_EQ(static_cast<uint32_t>(msg.new_price), 1634600);
+      },
+      [&](itch_message<MessageType::DELETE_ORDER> const& msg) {
+        ASSERT_EQ(static_cast<uint64_t>(msg.oid), 987654322);
+      }};
+
+  while (reader.remaining() > 3) {
+    numVisited += md::itch::dispatch(reader, visitor);
+  }
+  ASSERT_EQ(reader.remaining(), 0);
+  ASSERT_EQ(numVisited, 4);
+}
+
+TEST(ItchWriter, LayoutsRoundTrip) {
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+  using namespace md::itch::types;
+
+  // write() stores what parse() reads, from the same layout
+  auto const roundTrip = [](auto const& msg) {
+    auto buffer = std::array<char, 64>();
+    msg.write(buffer.data());
+    return std::remove_cvref_t<decltype(msg)>::parse(buffer.data());
+  };
+
+  auto const trade = roundTrip(itch_message<MessageType::TRADE>(timestamp_t(uint64_t(34200000000123)), oid_t(987654321), BUY_SELL::BUY, qty_t(300), price_t(1634500), 424242, 6449));
+  EXPECT_EQ(trade.timestamp.count(), 34200000000123);
+  EXPECT_EQ(static_cast<uint64_t>(trade.oid), 987654321);
+  EXPECT_EQ(trade.buy, BUY_SELL::BUY);
+  EXPECT_EQ(static_cast<uint32_t>(trade.qty), 300);
+  EXPECT_EQ(static_cast<uint32_t>(trade.price), 1634500);
+  EXPECT_EQ(trade.match_number, 424242);
+  EXPECT_EQ(trade.stock_locate, 6449);
+
+  auto const imbalance = roundTrip(itch_message<MessageType::NET_ORDER_IMBALANCE>(timestamp_t(uint64_t(5)), 120000, 3500, 'S', price_t(210000), price_t(210500), price_t(211000), 'C', 331));
+  EXPECT_EQ(imbalance.paired_shares, 120000);
+  EXPECT_EQ(imbalance.imbalance_shares, 3500);
+  EXPECT_EQ(imbalance.imbalance_direction, 'S');
+  EXPECT_EQ(static_cast<uint32_t>(imbalance.far_price), 210000);
+  EXPECT_EQ(static_cast<uint32_t>(imbalance.near_price), 210500);
+  EXPECT_EQ(static_cast<uint32_t>(imbalance.reference_price), 211000);
+  EXPECT_EQ(imbalance.cross_type, 'C');
+  EXPECT_EQ(imbalance.stock_locate, 331);
+
+  auto const exec = itch_message<MessageType::EXECUTE_ORDER>(oid_t(7), timestamp_t(uint64_t(6)), qty_t(40), 12);
+  auto const withPrice = roundTrip(itch_message<MessageType::EXECUTE_ORDER_WITH_PRICE>(exec, 'Y', price_t(1000100)));
+  EXPECT_EQ(static_cast<uint64_t>(withPrice.exec.oid), 7);
+  EXPECT_EQ(withPrice.exec.timestamp.count(), 6);
+  EXPECT_EQ(static_cast<uint32_t>(withPrice.exec.qty), 40);
+  EXPECT_EQ(withPrice.exec.stock_locate, 12);
+  EXPECT_EQ(withPrice.printable, 'Y');
+  EXPECT_EQ(static_cast<uint32_t>(withPrice.price), 1000100);
+
+  auto const directory = roundTrip(itch_message<MessageType::STOCK_DIRECTORY>(12, timestamp_t(uint64_t(5)), 'Q', "QQQ"));
+  EXPECT_EQ(directory.stock, "QQQ     "s);
+  EXPECT_EQ(directory.marketCategory, 'Q');
+}
+
+TEST(ItchGenerator, DeterministicAndConsistent) {
+  auto config = md::ItchGeneratorConfig{};
+  config.symbols = {"QQQ", "SPY"};
+  config.numMessages = 200000;
+  config.priceMoveProbability = 0.01;
+
+  auto const generate = [](md::ItchGeneratorConfig const& config) {
+    auto out = std::ostringstream();
+    auto const stats = md::generateItch(out, config);
+    EXPECT_EQ(stats.numMessages, config.numMessages);
+    EXPECT_EQ(stats.numBytes, out.str().size());
+    return out.str();
+  };
+
+  auto const data = generate(config);
+  ASSERT_EQ(generate(config), data);
+  config.seed += 1;
+  ASSERT_NE(generate(config), data);
+
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto const symbols = md::utils::Symbols(reader);
+  ASSERT_EQ(symbols.byName("QQQ"), 1);
+  ASSERT_EQ(symbols.byName("SPY"), 2);
+
+  using md::itch::messages::itch_message;
+  using md::itch::messages::MessageType;
+  using namespace md::itch::types;
+
+  // every message has to apply cleanly and books never cross
+  auto books = std::array<lob::LimitOrderBook, 3>();
+  auto numMessages = size_t(0);
+  auto const check = [&](uint16_t locate) {
+    ++numMessages;
+    auto const& book = books[locate];
+    if (book.hasBids() && book.hasAsks()) ASSERT_LT(book.bid(), book.ask());
+  };
+
+  auto visitor = md::itch::overloaded{
+      [&](itch_message<MessageType::ADD_ORDER> const& msg) {
+        books[msg.stock_locate].addOrder(toOrderId(msg.oid), toDirection(msg.buy), toInt(msg.qty), toLevel<lob::LimitOrderBook::Precision>(msg.price));
+        check(msg.stock_locate);
+      },
+      [&](itch_message<MessageType::EXECUTE_ORDER> const& msg) {
+        ASSERT_NE(books[msg.stock_locate].executeOrder(toOrderId(msg.oid), toInt(msg.qty)), lob::ExecuteOrderResult::ERROR);
+        check(msg.stock_locate);
+      },
+      [&](itch_message<MessageType::REDUCE_ORDER> const& msg) {
+        ASSERT_TRUE(books[msg.stock_locate].reduceOrder(toOrderId(msg.oid), toInt(msg.qty)));
+        check(msg.stock_locate);
+      },
+      [&](itch_message<MessageType::DELETE_ORDER> const& msg) {
+        ASSERT_TRUE(books[msg.stock_locate].deleteOrder(toOrderId(msg.oid)));
+        check(msg.stock_locate);
+      },
+      [&](itch_message<MessageType::REPLACE_ORDER> const& msg) {
+        ASSERT_TRUE(books[msg.stock_locate].replaceOrder(toOrderId(msg.oid), toOrderId(msg.new_order_id), toInt(msg.new_qty), toLevel<lob::LimitOrderBook::Precision>(msg.new_price)));
+        check(msg.stock_locate);
+      }};
+
+  while (reader.remaining() > 3) {
+    md::itch::dispatch(reader, visitor);
+  }
+  ASSERT_EQ(numMessages, config.numMessages);
+}
+
+TEST(ItchReader, CountMessageTypesParallel) {
+  auto const file = getTestFile();
+
+  auto const countMessageTypes = [](md::BinaryDataReader& reader) {
+    auto counts = std::unordered_map<md::itch::messages::MessageType, size_t>();
+    while (reader.remaining() > 3) {
+      ++counts[md::itch::currentMessageType(reader)];
+      md::itch::skipCurrentMessage(reader);
+    }
+    return counts;
+  };
+
+  auto reader = md::BinaryDataReader(file.data(), file.size());
+  auto const expected = countMessageTypes(reader);
+
+  auto counts = std::unordered_map<md::itch::messages::MessageType, size_t>();
+  for (auto const& chunkCounts : md::itch::decodeParallel(file.data(), file.size(), std::thread::hardware_concurrency(), countMessageTypes)) {
+    for (auto const [messageType, c] : chunkCounts) counts[messageType] += c;
+  }
+
+  ASSERT_EQ(counts, expected);
+}
+
 TEST(ItchReader, StartSysEvents) {
   auto const file = getTestFile();
   auto reader = md::BinaryDataReader(file.data(), file.size());
@@ -145,4 +524,64 @@ TEST(ItchReader, TopNStocksByAdd) {
   ASSERT_EQ(topSecurityCount[4], (std::pair<uint16_t, size_t>(14, 271383)));
 }
 
+TEST(ItchReplay, RemapsLocatesAcrossDays) {
+  auto replay = md::ItchReplay({getTestFilename(), getTestFilename()});
+  auto const symbols = [&] {
+    auto const file = getTestFile();
+    auto reader = md::BinaryDataReader(file.data(), file.size());
+    return md::utils::Symbols(reader);
+  }();
+
+  ASSERT_EQ(replay.numDays(), 2);
+  ASSERT_EQ(replay.count(), symbols.count());
+  ASSERT_EQ(replay.byName("QQQ"), 6449);
+  ASSERT_EQ(replay.toGlobal(6449), 6449);
+  ASSERT_EQ(replay.dayOffset(), std::chrono::nanoseconds(0));
+
+  auto const marketStart = replay.reader().curr();
+
+  ASSERT_TRUE(replay.nextDay());
+  ASSERT_EQ(replay.dayIndex(), 1);
+  ASSERT_EQ(replay.reader().curr(), marketStart);
+  ASSERT_EQ(replay.toGlobal(6449), 6449);
+  ASSERT_EQ(replay.count(), symbols.count());
+  ASSERT_EQ(replay.dayOffset(), std::chrono::days(1));
+  ASSERT_FALSE(replay.nextDay());
+
+  replay.rewind();
+  ASSERT_EQ(replay.dayIndex(), 0);
+  ASSERT_EQ(replay.reader().curr(), marketStart);
+  ASSERT_EQ(replay.byId(6449), "QQQ"s);
+}
+
+TEST(ItchReplay, ForgetsLocatesOfThePreviousDay) {
+  // locates follow the order of the symbols: CCC moves from 3 to 1 and BBB is not listed on day 2
+  auto const dir = std::filesystem::temp_directory_path();
+  auto const files = std::vector{(dir / "lob_md_tests_day1.itch").string(), (dir / "lob_md_tests_day2.itch").string()};
+  auto config = md::ItchGeneratorConfig{.symbols = {"AAA", "BBB", "CCC"}, .numMessages = 1000};
+  md::generateItchFile(files[0], config);
+  config.symbols = {"CCC", "AAA"};
+  md::generateItchFile(files[1], config);
+
+  {
+    auto replay = md::ItchReplay(files);
+    ASSERT_EQ(replay.byName("AAA"), 1);
+    ASSERT_EQ(replay.byName("BBB"), 2);
+    ASSERT_EQ(replay.byName("CCC"), 3);
+    ASSERT_EQ(replay.toGlobal(3), 3);
+
+    ASSERT_TRUE(replay.nextDay());
+    ASSERT_EQ(replay.count(), 3);
+    ASSERT_EQ(replay.toGlobal(1), replay.byName("CCC"));
+    ASSERT_EQ(replay.toGlobal(2), replay.byName("AAA"));
+    ASSERT_EQ(replay.toGlobal(3), 0);
+
+    replay.rewind();
+    ASSERT_EQ(replay.toGlobal(1), 1);
+    ASSERT_EQ(replay.toGlobal(2), 2);
+    ASSERT_EQ(replay.toGlobal(3), 3);
+  }
+  for (auto const& file : files) std::filesystem::remove(file);
+}
+
 }  // namespace
@@ -0,0 +1,857 @@
+#include <gtest/gtest.h>
+#include <md/BinaryDataReader.h>
+#include <md/ItchGenerator.h>
+#include <md/Symbols.h>
+#include <simulator/Backtest.h>
+#include <simulator/ItchBooksManager.h>
+#include <simulator/Metrics.h>
+#include <simulator/NodeLocal.h>
+#include <simulator/OMS.h>
+#include <simulator/Simulator.h>
+#include <simulator/Sweep.h>
+#include <simulator/TimingWheel.h>
+#include <simulator/TopOfBookRecording.h>
+#include <simulator/Topology.h>
+#include <simulator/functions.h>
+#include <strategies/Strategies.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+using md::itch::types::BUY_SELL;
+using md::itch::types::oid_t;
+using md::itch::types::price_t;
+using md::itch::types::qty_t;
+using Level = lob::LimitOrderBook::LevelT;
+
+constexpr md::itch::types::locate_t Locate = 1;
+
+// Replays the given market data events, then empty ones every microsecond.
+struct ScriptedMarket {
+  explicit ScriptedMarket(std::vector<simulator::Simulator::EventT> events)
+      : events(std::move(events)), simulator([this] {
+          if (next == this->events.size()) {
+            idle += 1us;
+            return simulator::Simulator::EventT{idle, [] {}};
+          }
+          idle = this->events[next].first;
+          return this->events[next++];
+        }) {}
+
+  std::vector<simulator::Simulator::EventT> events;
+  size_t next = 0;
+  std::chrono::nanoseconds idle{0};
+  simulator::Simulator simulator;
+};
+
+auto collect(simulator::OMS& oms, simulator::OMS::ClientId client) {
+  auto events = std::vector<simulator::OrderEvent>();
+  oms.pollEvents(client, [&](simulator::OrderEvent const& event) { events.push_back(event); });
+  return events;
+}
+
+TEST(OMS, MatchesAndTracksQueue) {
+  auto bmgr = simulator::ItchBooksManager();
+  bmgr.optIn(Locate);
+  auto market = ScriptedMarket({
+      {10ns, [&] { bmgr.addOrder(Locate, oid_t{1}, BUY_SELL::SELL, qty_t{100}, price_t{1000100}); }},
+      {20ns, [&] { bmgr.addOrder(Locate, oid_t{2}, BUY_SELL::SELL, qty_t{50}, price_t{1000200}); }},
+      {30ns, [&] { bmgr.addOrder(Locate, oid_t{3}, BUY_SELL::BUY, qty_t{100}, price_t{1000000}); }},
+      {40ns, [&] { bmgr.executeOrder(Locate, oid_t{3}, qty_t{60}); }},
+      {50ns, [&] { bmgr.reduceOrder(Locate, oid_t{3}, qty_t{20}); }},
+      {60ns, [&] { bmgr.executeOrder(Locate, oid_t{3}, qty_t{20}); }},
+      {70ns, [&] { bmgr.addOrder(Locate, oid_t{4}, BUY_SELL::BUY, qty_t{10}, price_t{1000000}); }},
+      {80ns, [&] { bmgr.executeOrder(Locate, oid_t{4}, qty_t{10}); }},
+  });
+  auto& simulator = market.simulator;
+
+  auto oms = simulator::OMS({.latency = 5ns});
+  oms.connect(simulator, bmgr);
+  auto const client = oms.addClient();
+
+  for (int i = 0; i != 3; ++i) simulator.step();
+  auto const aggressive = oms.limitOrder(client, Locate, lob::Direction::Buy, 120, Level(1000200));
+  auto const passive = oms.limitOrder(client, Locate, lob::Direction::Buy, 30, Level(1000000));
+  oms.processRequests();
+  EXPECT_TRUE(collect(oms, client).empty());
+
+  // both arrive at 35ns, before the next market data event: the aggressive order sweeps two
+  // levels, the passive one joins the queue and 60 of the 100 ahead of it execute
+  EXPECT_EQ(simulator.step(), 40ns);
+  auto events = collect(oms, client);
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].orderId, aggressive);
+  EXPECT_EQ(events[0].price, Level(1000100));
+  EXPECT_EQ(events[0].qty, 100);
+  EXPECT_EQ(events[0].leaves, 20);
+  EXPECT_EQ(events[0].timestamp, 35ns);
+  EXPECT_EQ(events[1].price, Level(1000200));
+  EXPECT_EQ(events[1].qty, 20);
+  EXPECT_EQ(events[1].leaves, 0);
+
+  // then 20 are cancelled and the last 20 execute
+  auto const& book = bmgr.bookById(Locate);
+  EXPECT_EQ(book.queueAhead(passive), 40);
+  simulator.step();
+  EXPECT_EQ(book.queueAhead(passive), 20);
+  simulator.step();
+  EXPECT_EQ(book.queueAhead(passive), 0);
+  EXPECT_TRUE(collect(oms, client).empty());
+
+  // an order added behind the passive order executes: it must have filled the passive order first
+  simulator.step();
+  simulator.step();
+  events = collect(oms, client);
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].orderId, passive);
+  EXPECT_EQ(events[0].kind, simulator::OrderEvent::Kind::Fill);
+  EXPECT_EQ(events[0].qty, 10);
+  EXPECT_EQ(events[0].leaves, 20);
+
+  // no bids left for the market order
+  oms.cancel(client, passive);
+  auto const market0 = oms.marketOrder(client, Locate, lob::Direction::Sell, 5);
+  oms.processRequests();
+  simulator.step();
+  events = collect(oms, client);
+  ASSERT_EQ(events.size(), 2);
+  std::ranges::sort(events, {}, &simulator::OrderEvent::orderId);
+  EXPECT_EQ(events[0].orderId, passive);
+  EXPECT_EQ(events[0].kind, simulator::OrderEvent::Kind::Cancelled);
+  EXPECT_EQ(events[0].qty, 20);
+  EXPECT_EQ(events[1].orderId, market0);
+  EXPECT_EQ(events[1].kind, simulator::OrderEvent::Kind::Expired);
+  EXPECT_EQ(events[1].qty, 5);
+
+  EXPECT_EQ(oms.numOrders(), 3);
+  EXPECT_EQ(oms.numFills(), 3);
+  EXPECT_EQ(book.numVirtualOrders(), 0);
+}
+
+TEST(OMS, ExecutionFillsNoMoreThanItsQuantity) {
+  auto bmgr = simulator::ItchBooksManager();
+  bmgr.optIn(Locate);
+  auto market = ScriptedMarket({
+      {10ns, [&] { bmgr.addOrder(Locate, oid_t{1}, BUY_SELL::BUY, qty_t{10}, price_t{1000000}); }},
+      {30ns, [&] { bmgr.addOrder(Locate, oid_t{2}, BUY_SELL::BUY, qty_t{100}, price_t{1000000}); }},
+      {40ns, [&] { bmgr.executeOrder(Locate, oid_t{2}, qty_t{40}); }},
+  });
+  auto& simulator = market.simulator;
+
+  auto oms = simulator::OMS({.latency = 5ns});
+  oms.connect(simulator, bmgr);
+  auto const client = oms.addClient();
+
+  // two orders queue behind the first real order and one above it, arriving at 15ns before the
+  // second real order
+  simulator.step();
+  auto const first = oms.limitOrder(client, Locate, lob::Direction::Buy, 30, Level(1000000));
+  auto const second = oms.limitOrder(client, Locate, lob::Direction::Buy, 30, Level(1000000));
+  auto const better = oms.limitOrder(client, Locate, lob::Direction::Buy, 5, Level(1000100));
+  oms.processRequests();
+  EXPECT_EQ(simulator.step(), 30ns);
+  EXPECT_TRUE(collect(oms, client).empty());
+
+  // 40 of the second real order execute: the better priced order would have filled first, then the
+  // queue in order, and no more than 40 in all
+  simulator.step();
+  auto const events = collect(oms, client);
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(events[0].orderId, better);
+  EXPECT_EQ(events[0].qty, 5);
+  EXPECT_EQ(events[1].orderId, first);
+  EXPECT_EQ(events[1].qty, 30);
+  EXPECT_EQ(events[1].leaves, 0);
+  EXPECT_EQ(events[2].orderId, second);
+  EXPECT_EQ(events[2].qty, 5);
+  EXPECT_EQ(events[2].leaves, 25);
+  auto total = 0;
+  for (auto const& event : events) total += event.qty;
+  EXPECT_EQ(total, 40);
+
+  // the filled orders left the book's queues
+  auto const& book = bmgr.bookById(Locate);
+  EXPECT_EQ(book.numVirtualOrders(), 1);
+  EXPECT_EQ(book.queueAhead(second), 10);
+}
+
+TEST(OMS, OrdersFromOtherThreads) {
+  auto bmgr = simulator::ItchBooksManager();
+  bmgr.optIn(Locate);
+  auto market = ScriptedMarket({{1ns, [&] { bmgr.addOrder(Locate, oid_t{1}, BUY_SELL::SELL, qty_t{1'000'000}, price_t{1000100}); }}});
+  auto oms = simulator::OMS({.latency = 100ns});
+  oms.connect(market.simulator, bmgr);
+
+  constexpr int NumClients = 4;
+  constexpr int NumOrders = 1000;
+  auto filled = std::array<std::atomic<int>, NumClients>{};
+  auto done = std::atomic<int>(0);
+  {
+    auto clients = std::vector<std::jthread>();
+    for (int c = 0; c != NumClients; ++c) {
+      clients.emplace_back([&, c] {
+        auto const client = oms.addClient();
+        for (int i = 0; i != NumOrders; ++i) oms.limitOrder(client, Locate, lob::Direction::Buy, 1, Level(1000100));
+        while (filled[c] != NumOrders) {
+          oms.pollEvents(client, [&](simulator::OrderEvent const& event) { filled[c] += event.qty; });
+          std::this_thread::yield();
+        }
+        ++done;
+      });
+    }
+    while (done != NumClients) {
+      market.simulator.step();
+      oms.processRequests();
+    }
+  }
+  EXPECT_EQ(oms.numOrders(), NumClients * NumOrders);
+  EXPECT_EQ(oms.numFills(), NumClients * NumOrders);
+}
+
+TEST(OMS, FullQueuesOnTheSimulatorThread) {
+  auto bmgr = simulator::ItchBooksManager();
+  bmgr.optIn(Locate);
+  auto market = ScriptedMarket({{1ns, [&] { bmgr.addOrder(Locate, oid_t{1}, BUY_SELL::SELL, qty_t{1'000'000}, price_t{1000100}); }}});
+  auto& simulator = market.simulator;
+
+  // a strategy run by the simulator thread overflows the inbox: the requests are picked up in place
+  auto oms = simulator::OMS({.latency = 100ns, .inboxSize = 4});
+  oms.connect(simulator, bmgr);
+  auto const client = oms.addClient();
+  simulator.step();
+  for (int i = 0; i != 100; ++i) oms.limitOrder(client, Locate, lob::Direction::Buy, 1, Level(1000100));
+  oms.processRequests();
+  EXPECT_FALSE(oms.hasRequests());
+  simulator.step();
+  auto const events = collect(oms, client);
+  ASSERT_EQ(events.size(), 100);
+  EXPECT_TRUE(std::ranges::all_of(events, [](auto const& event) { return event.kind == simulator::OrderEvent::Kind::Fill && event.qty == 1; }));
+
+  // and its events, which it cannot poll before the step returns
+  auto small = simulator::OMS({.latency = 100ns, .eventQueueSize = 4});
+  small.connect(simulator, bmgr);
+  auto const smallClient = small.addClient();
+  for (int i = 0; i != 10; ++i) small.limitOrder(smallClient, Locate, lob::Direction::Buy, 1, Level(1000100));
+  small.processRequests();
+  EXPECT_THROW(simulator.step(), std::runtime_error);
+  EXPECT_EQ(collect(small, smallClient).size(), 4);
+}
+
+TEST(OMS, ExpiresOrdersOfSymbolsNotOptedIn) {
+  constexpr md::itch::types::locate_t Other = 2;
+  auto bmgr = simulator::ItchBooksManager();
+  bmgr.optIn(Locate);
+  auto market = ScriptedMarket({
+      {10ns, [&] { bmgr.addOrder(Other, oid_t{1}, BUY_SELL::SELL, qty_t{100}, price_t{1000100}); }},
+      {20ns, [&] { bmgr.deleteOrder(Other, oid_t{1}); }},
+  });
+  auto& simulator = market.simulator;
+
+  auto oms = simulator::OMS({.latency = 5ns});
+  oms.connect(simulator, bmgr);
+  auto const client = oms.addClient();
+  simulator.step();
+  auto const orderId = oms.limitOrder(client, Other, lob::Direction::Buy, 10, Level(1000100));
+  oms.processRequests();
+
+  // the order finds no book, and the symbol stays out so that the delete of an order its book
+  // never saw is still ignored
+  EXPECT_EQ(simulator.step(), 20ns);
+  auto const events = collect(oms, client);
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].orderId, orderId);
+  EXPECT_EQ(events[0].kind, simulator::OrderEvent::Kind::Expired);
+  EXPECT_EQ(events[0].qty, 10);
+  EXPECT_EQ(events[0].leaves, 0);
+  EXPECT_FALSE(bmgr.optedIn(Other));
+  EXPECT_THROW((void)bmgr.optedInBook(Other), std::out_of_range);
+}
+
+TEST(Metrics, SnapshotSumsThreads) {
+  constexpr int NumThreads = 4;
+  constexpr uint64_t NumMessages = 100000;
+  auto registry = simulator::MetricsRegistry();
+  auto started = std::atomic<int>(0);
+  {
+    auto threads = std::vector<std::jthread>();
+    for (int t = 0; t != NumThreads; ++t) {
+      threads.emplace_back([&, t] {
+        auto& metrics = registry.add(std::format("thread {}", t), t == 0 ? 8 : 0);
+        ++started;
+        for (uint64_t i = 0; i != NumMessages; ++i) {
+          metrics.messagesByType['A'].add();
+          metrics.bookOp(i % 2 ? simulator::BookOp::Add : simulator::BookOp::Execute);
+          metrics.publish(i % 8);
+          metrics.strategyCallbacks.add(2);
+        }
+      });
+    }
+    // read while written: totals only grow
+    auto prev = registry.snapshot();
+    while (started != NumThreads || prev.messages() != NumThreads * NumMessages) {
+      auto const curr = registry.snapshot();
+      ASSERT_GE(curr.messages(), prev.messages());
+      ASSERT_GE(curr.strategyCallbacks, prev.strategyCallbacks);
+      prev = curr;
+    }
+  }
+
+  auto const snapshot = registry.snapshot();
+  EXPECT_EQ(snapshot.messages(), NumThreads * NumMessages);
+  EXPECT_EQ(snapshot.messagesByType['A'], NumThreads * NumMessages);
+  EXPECT_EQ(snapshot.bookOps[static_cast<size_t>(simulator::BookOp::Add)], NumThreads * NumMessages / 2);
+  EXPECT_EQ(snapshot.bookOps[static_cast<size_t>(simulator::BookOp::Execute)], NumThreads * NumMessages / 2);
+  // only the thread with per symbol counters counts publishes
+  ASSERT_EQ(snapshot.publishesBySymbol.size(), 8);
+  EXPECT_EQ(snapshot.publishes(), NumMessages);
+  EXPECT_EQ(snapshot.publishesBySymbol[3], NumMessages / 8);
+  EXPECT_EQ(snapshot.strategyCallbacks, 2 * NumThreads * NumMessages);
+  EXPECT_EQ(snapshot.loggerDrops, 0);
+}
+
+TEST(Metrics, SamplerReplacesTheSnapshotFile) {
+  auto const dir = std::filesystem::temp_directory_path() / "lob_simulator_tests_metrics";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  auto const path = dir / "metrics.json";
+
+  auto registry = simulator::MetricsRegistry();
+  auto& metrics = registry.add("simulator", 4);
+  {
+    auto const sampler = simulator::MetricsSampler(registry, path, 5ms);
+    for (int i = 0; i != 1000; ++i) {
+      metrics.messagesByType['E'].add();
+      metrics.publish(1);
+    }
+    auto const deadline = std::chrono::steady_clock::now() + 5s;
+    while (!std::filesystem::exists(path) && std::chrono::steady_clock::now() < deadline) std::this_thread::sleep_for(1ms);
+    ASSERT_TRUE(std::filesystem::exists(path));
+    // replaced whole while being sampled, so any version read parses
+    for (int i = 0; i != 20; ++i) {
+      auto in = std::ifstream(path);
+      EXPECT_NO_THROW(static_cast<void>(nlohmann::json::parse(in)));
+      std::this_thread::sleep_for(1ms);
+    }
+    metrics.messagesByType['E'].add(500);
+  }
+
+  // the sampler wrote the totals when stopped
+  auto const json = nlohmann::json::parse(std::ifstream(path));
+  EXPECT_EQ(json["messages"], 1500);
+  EXPECT_EQ(json["messages_by_type"]["E"], 1500);
+  EXPECT_EQ(json["publishes"], 1000);
+  EXPECT_EQ(json["publishes_by_symbol"]["1"], 1000);
+  EXPECT_TRUE(json.contains("messages_per_second"));
+  EXPECT_TRUE(json.contains("elapsed_seconds"));
+  auto numFiles = 0;
+  for (auto const& entry : std::filesystem::directory_iterator(dir)) {
+    EXPECT_EQ(entry.path().filename(), "metrics.json");
+    ++numFiles;
+  }
+  EXPECT_EQ(numFiles, 1);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(ItchBooksManager, RoutesTradesAndImbalancesOfOptedInSymbols) {
+  using md::itch::messages::MessageType;
+
+  // framed like the feed: a big endian length, then the message
+  auto data = std::string();
+  auto const message = [&](MessageType type, size_t length, std::vector<std::array<uint64_t, 3>> const& fields) {
+    auto msg = std::string(2 + length, '\0');
+    msg[0] = static_cast<char>(length >> 8);
+    msg[1] = static_cast<char>(length);
+    msg[2] = static_cast<char>(type);
+    for (auto const [offset, value, width] : fields) {
+      for (size_t i = 0; i != width; ++i) msg[2 + offset + i] = static_cast<char>(value >> (8 * (width - 1 - i)));
+    }
+    data += msg;
+  };
+  auto const trade = [&](uint64_t locate, uint64_t timestamp, uint64_t qty, uint64_t price, uint64_t matchNumber) {
+    message(MessageType::TRADE, md::itch::messages::netlen<MessageType::TRADE>, {{1, locate, 2}, {5, timestamp, 6}, {19, 'B', 1}, {20, qty, 4}, {32, price, 4}, {36, matchNumber, 8}});
+  };
+  auto const imbalance = [&](uint64_t locate, uint64_t timestamp, uint64_t imbalanceShares, uint64_t referencePrice) {
+    message(MessageType::NET_ORDER_IMBALANCE, md::itch::messages::netlen<MessageType::NET_ORDER_IMBALANCE>, {{1, locate, 2}, {5, timestamp, 6}, {11, 1000, 8}, {19, imbalanceShares, 8}, {27, 'B', 1}, {44, referencePrice, 4}, {48, 'C', 1}});
+  };
+
+  constexpr md::itch::types::locate_t Other = 2;
+  trade(Other, 10, 500, 2000000, 1);
+  trade(Locate, 20, 100, 1000100, 2);
+  imbalance(Other, 30, 700, 2000000);
+  imbalance(Locate, 40, 300, 1000000);
+  trade(Other, 50, 900, 2000000, 3);
+
+  auto bmgr = simulator::ItchBooksManager();
+  auto const& trades = bmgr.tradeBufferById(Locate);
+  auto const& imbalances = bmgr.imbalanceBufferById(Locate);
+
+  // only the opted-in symbol's messages become events
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto timestamps = std::vector<std::chrono::nanoseconds>();
+  while (auto event = simulator::tryGetNextMarketDataEvent(reader, bmgr)) {
+    timestamps.push_back(event->first);
+    event->second();
+  }
+  EXPECT_EQ(timestamps, (std::vector{20ns, 40ns}));
+
+  ASSERT_EQ(trades.size(), 1);
+  auto const [tradeTime, tradeValue] = trades.read(0).data.front();
+  EXPECT_EQ(tradeValue.kind, simulator::ItchBooksManager::Trade::Kind::Hidden);
+  EXPECT_EQ(tradeValue.price, Level(1000100));
+  EXPECT_EQ(tradeValue.qty, 100);
+  EXPECT_EQ(tradeValue.matchNumber, 2);
+
+  ASSERT_EQ(imbalances.size(), 1);
+  auto const [imbalanceTime, imbalanceValue] = imbalances.read(0).data.front();
+  EXPECT_EQ(imbalanceValue.imbalanceShares, 300);
+  EXPECT_EQ(imbalanceValue.pairedShares, 1000);
+  EXPECT_EQ(imbalanceValue.referencePrice, Level(1000000));
+  EXPECT_EQ(imbalanceValue.direction, 'B');
+  EXPECT_EQ(imbalanceValue.crossType, 'C');
+
+  EXPECT_FALSE(bmgr.optedIn(Other));
+  EXPECT_THROW((void)std::as_const(bmgr).tradeBufferById(Other), std::out_of_range);
+  EXPECT_THROW((void)std::as_const(bmgr).imbalanceBufferById(Other), std::out_of_range);
+}
+
+TEST(Simulator, RunsUntilTopChangesAndSimulationEvents) {
+  auto bmgr = simulator::ItchBooksManager();
+  bmgr.subscribe(Locate);
+  auto market = ScriptedMarket({
+      {10ns, [&] { bmgr.addOrder(Locate, oid_t{1}, BUY_SELL::SELL, qty_t{100}, price_t{1000100}); }},
+      {20ns, [&] { bmgr.addOrder(Locate, oid_t{2}, BUY_SELL::SELL, qty_t{50}, price_t{1000200}); }},
+      {30ns, [&] { bmgr.addOrder(Locate, oid_t{3}, BUY_SELL::BUY, qty_t{100}, price_t{1000000}); }},
+      {40ns, [&] { bmgr.addOrder(Locate, oid_t{4}, BUY_SELL::BUY, qty_t{100}, price_t{999900}); }},
+      {50ns, [&] { bmgr.addOrder(Locate, oid_t{5}, BUY_SELL::BUY, qty_t{100}, price_t{999800}); }},
+  });
+  auto& simulator = market.simulator;
+  auto const topsChanged = [&bmgr] { return bmgr.topsChanged(); };
+  auto const takeChangedTops = [&bmgr] {
+    auto tops = std::vector<lob::LimitOrderBook::TopOfBook>();
+    bmgr.takeChangedTops([&](int id, auto const& book) {
+      EXPECT_EQ(id, Locate);
+      tops.push_back(book.top());
+    });
+    return tops;
+  };
+
+  auto run = simulator.runFor(100, topsChanged);
+  EXPECT_EQ(run.reason, simulator::Simulator::StopReason::Stopped);
+  EXPECT_EQ(run.numEvents, 1);
+  EXPECT_EQ(run.timestamp, 10ns);
+  ASSERT_EQ(takeChangedTops().size(), 1);
+  EXPECT_TRUE(takeChangedTops().empty());
+
+  // the second ask level leaves the top as it is
+  run = simulator.runFor(100, topsChanged);
+  EXPECT_EQ(run.numEvents, 2);
+  EXPECT_EQ(run.timestamp, 30ns);
+  auto const tops = takeChangedTops();
+  ASSERT_EQ(tops.size(), 1);
+  EXPECT_EQ(tops[0].bid, Level(1000000));
+  EXPECT_EQ(tops[0].ask, Level(1000100));
+
+  // a simulation event ends the run before the market data due after it
+  auto ran = false;
+  simulator.addSimulationEvent({45ns, [&] { ran = true; }});
+  run = simulator.runUntil(100ns);
+  EXPECT_EQ(run.reason, simulator::Simulator::StopReason::SimulationEvents);
+  EXPECT_EQ(run.numEvents, 1);
+  EXPECT_EQ(run.timestamp, 45ns);
+  EXPECT_TRUE(ran);
+
+  run = simulator.runUntil(50ns);
+  EXPECT_EQ(run.reason, simulator::Simulator::StopReason::Until);
+  EXPECT_EQ(run.numEvents, 1);
+  EXPECT_EQ(run.timestamp, 50ns);
+
+  // the idle events
+  run = simulator.runFor(3);
+  EXPECT_EQ(run.reason, simulator::Simulator::StopReason::NumEvents);
+  EXPECT_EQ(run.timestamp, 3050ns);
+  EXPECT_FALSE(bmgr.topsChanged());
+}
+
+TEST(Sweep, MatchesTestStrategyForAnyNumberOfWorkers) {
+  auto config = md::ItchGeneratorConfig{};
+  config.symbols = {"QQQ", "SPY"};
+  config.numMessages = 200000;
+  config.priceMoveProbability = 0.01;
+  auto out = std::ostringstream();
+  md::generateItch(out, config);
+  auto const data = out.str();
+
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto const symbolId = md::utils::Symbols(reader).byName("QQQ");
+  reader.reset();
+  constexpr size_t NumEvents = 150000;
+
+  auto const ks = std::array<size_t, 3>{10, 50, 100};
+  auto const entries = std::array{2.0, 1.0};
+  auto const qtys = std::array{1, 3};
+  auto const grid = strategies::makeGrid(ks, entries, qtys);
+  ASSERT_EQ(grid.size(), 12);
+
+  auto const one = simulator::runSweep(reader, symbolId, grid, NumEvents, {.numWorkers = 1});
+  auto const three = simulator::runSweep(reader, symbolId, grid, NumEvents, {.numWorkers = 3});
+  ASSERT_EQ(one.size(), grid.size());
+  ASSERT_EQ(three.size(), grid.size());
+  size_t numFills = 0;
+  for (size_t i = 0; i != grid.size(); ++i) {
+    EXPECT_EQ(one[i].params.k, grid[i].k);
+    EXPECT_EQ(one[i].params.entry, grid[i].entry);
+    EXPECT_EQ(one[i].numOrders, three[i].numOrders);
+    EXPECT_EQ(one[i].numFills, three[i].numFills);
+    EXPECT_EQ(one[i].position, three[i].position);
+    EXPECT_EQ(one[i].cash, three[i].cash);
+    numFills += one[i].numFills;
+  }
+  EXPECT_GT(numFills, 0);
+
+  // TestStrategy trades the first entry and quantity
+  auto bmgr = simulator::ItchBooksManager();
+  auto simulator = simulator::Simulator([&] { return simulator::getNextMarketDataEvent(reader, bmgr); });
+  auto oms = simulator::OMS();
+  oms.connect(simulator, bmgr);
+  bmgr.subscribe(symbolId);
+  auto testStrategies = std::vector<std::unique_ptr<strategies::TestStrategy>>();
+  for (auto const k : ks) testStrategies.push_back(std::make_unique<strategies::TestStrategy>(oms, symbolId, k));
+  for (size_t n = 0; n < NumEvents;) {
+    auto const run = simulator.runFor(NumEvents - n, [&bmgr] { return bmgr.topsChanged(); });
+    n += run.numEvents;
+    bmgr.takeChangedTops([&](int, auto const& book) {
+      for (auto& strategy : testStrategies) strategy->onUpdate(run.timestamp, book.top());
+    });
+    oms.processRequests();
+  }
+  for (size_t s = 0; s != ks.size(); ++s) {
+    auto const& expected = testStrategies[s]->diagnostics();
+    auto const& result = one[s * entries.size() * qtys.size()];
+    EXPECT_EQ(result.numOrders, expected.numOrders);
+    EXPECT_EQ(result.numFills, expected.numFills);
+    EXPECT_EQ(result.position, expected.position);
+    EXPECT_EQ(result.cash, expected.cash);
+  }
+}
+
+TEST(TopOfBookRecording, ReplaysThePublishedTops) {
+  auto config = md::ItchGeneratorConfig{};
+  config.symbols = {"QQQ", "SPY", "AMD"};
+  config.numMessages = 50000;
+  auto out = std::ostringstream();
+  md::generateItch(out, config);
+  auto const data = out.str();
+
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto const symbols = md::utils::Symbols(reader);
+  auto const symbolIds = std::array<int, 2>{symbols.byName("QQQ"), symbols.byName("SPY")};
+  reader.reset();
+  constexpr size_t NumEvents = 40000;
+
+  auto const filename = (std::filesystem::temp_directory_path() / "lob_tests.tops").string();
+  auto const numRecorded = simulator::recordTopOfBook(reader, symbolIds, NumEvents, filename);
+
+  // the tops as subscribers see them, one market data event at a time
+  struct Update {
+    simulator::Simulator::TimestampT timestamp;
+    int symbolId;
+    lob::LimitOrderBook::TopOfBook top;
+  };
+  auto expected = std::vector<Update>();
+  auto bmgr = simulator::ItchBooksManager();
+  auto simulator = simulator::Simulator([&] { return simulator::getNextMarketDataEvent(reader, bmgr); });
+  for (auto const id : symbolIds) bmgr.subscribe(id);
+  for (size_t n = 0; n < NumEvents;) {
+    auto const run = simulator.runFor(NumEvents - n, [&bmgr] { return bmgr.topsChanged(); });
+    n += run.numEvents;
+    bmgr.takeChangedTops([&](int id, auto const& book) { expected.push_back({run.timestamp, id, book.top()}); });
+  }
+
+  {
+    auto const recording = simulator::TopOfBookRecording(filename);
+    ASSERT_EQ(recording.size(), numRecorded);
+    ASSERT_EQ(recording.size(), expected.size());
+    ASSERT_GT(recording.size(), 100);
+    for (size_t i = 0; i != expected.size(); ++i) {
+      auto const& record = recording.records()[i];
+      ASSERT_EQ(record.timestamp, expected[i].timestamp.count());
+      ASSERT_EQ(record.symbolId, expected[i].symbolId);
+      ASSERT_EQ(record.top(), expected[i].top);
+    }
+
+    // in chunks, as StrategyBase::loop reads them, until running is cleared
+    auto const tops = recording.tops(symbolIds[1]);
+    std::atomic<bool> running = true;
+    auto const buffer = recording.buffer(symbolIds[1], running);
+    size_t readIdx = 0;
+    auto replayed = std::vector<lob::LimitOrderBook::TopOfBook>();
+    while (running.load()) {
+      auto const [updates, m, M] = buffer.read(readIdx);
+      if (updates.empty()) continue;
+      EXPECT_EQ(m, readIdx);
+      EXPECT_EQ(M - m + 1, updates.size());
+      for (auto const& [timestamp, top] : updates) replayed.push_back(top);
+      readIdx = M + 1;
+    }
+    EXPECT_EQ(replayed, tops);
+    EXPECT_FALSE(tops.empty());
+    EXPECT_EQ(buffer.size(), tops.size());
+
+    // reading an earlier index again starts over
+    auto const [again, m, M] = buffer.read(1);
+    ASSERT_FALSE(again.empty());
+    EXPECT_EQ(m, 1);
+    EXPECT_EQ(again.front().second, tops[1]);
+  }
+  std::filesystem::remove(filename);
+}
+
+TEST(Backtest, JobsAreIndependentOfThreadsAndEachOther) {
+  auto files = std::vector<std::string>();
+  for (uint64_t seed : {1, 2}) {
+    auto config = md::ItchGeneratorConfig{};
+    config.seed = seed;
+    config.symbols = {"QQQ", "SPY", "AMD"};
+    config.numMessages = 60000;
+    config.priceMoveProbability = 0.01;
+    files.push_back((std::filesystem::temp_directory_path() / std::format("lob_tests_backtest_{}.itch", seed)).string());
+    md::generateItchFile(files.back(), config);
+  }
+  auto const symbolSets = std::vector<std::vector<std::string>>{{"QQQ"}, {"QQQ", "SPY"}};
+  auto const configs = std::vector<simulator::StrategyConfig>{
+      {"TestStrategy", {{"k", 10}}},
+      {"MeanReversion", {{"k", 10}}},
+      {"Momentum", {{"fast", 5}, {"slow", 50}, {"maxSpread", 1000}}}};
+  auto const jobs = simulator::makeBacktestJobs(files, symbolSets, configs);
+  ASSERT_EQ(jobs.size(), 12);
+
+  auto const one = simulator::runBacktests(jobs, {.numThreads = 1});
+  auto const four = simulator::runBacktests(jobs, {.numThreads = 4});
+  ASSERT_EQ(one.results.size(), 18);
+  ASSERT_EQ(four.results.size(), one.results.size());
+
+  auto const same = [](simulator::BacktestResult const& a, simulator::BacktestResult const& b) {
+    EXPECT_TRUE(a.error.empty()) << a.error;
+    EXPECT_EQ(a.numUpdates, b.numUpdates);
+    EXPECT_EQ(a.numOrders, b.numOrders);
+    EXPECT_EQ(a.numFills, b.numFills);
+    EXPECT_EQ(a.position, b.position);
+    EXPECT_EQ(a.cash, b.cash);
+    EXPECT_EQ(a.pnl, b.pnl);
+  };
+  size_t numFills = 0;
+  for (size_t i = 0; i != one.results.size(); ++i) {
+    EXPECT_EQ(one.results[i].job, four.results[i].job);
+    EXPECT_EQ(one.results[i].symbol, four.results[i].symbol);
+    same(one.results[i], four.results[i]);
+    numFills += one.results[i].numFills;
+  }
+  EXPECT_GT(numFills, 0);
+
+  // results by file, symbol set and config: a symbol trades the same alone or with another, and
+  // the composed mean reversion as TestStrategy
+  auto const result = [&](size_t file, size_t symbols, size_t config, size_t symbol) {
+    auto const job = (file * symbolSets.size() + symbols) * configs.size() + config;
+    auto const it = std::ranges::find_if(one.results, [&](auto const& r) { return r.job == job && r.symbol == symbolSets[symbols][symbol]; });
+    return *it;
+  };
+  for (size_t file = 0; file != files.size(); ++file) {
+    for (size_t config = 0; config != configs.size(); ++config) same(result(file, 0, config, 0), result(file, 1, config, 0));
+    for (size_t symbols = 0; symbols != symbolSets.size(); ++symbols) same(result(file, symbols, 0, 0), result(file, symbols, 1, 0));
+  }
+
+  auto const summaries = one.summaries();
+  ASSERT_EQ(summaries.size(), configs.size());
+  EXPECT_EQ(summaries[0].config, "TestStrategy k=10");
+  for (auto const& summary : summaries) {
+    EXPECT_EQ(summary.numResults, 6);
+    EXPECT_EQ(summary.numFailed, 0);
+  }
+
+  // checked before anything runs
+  auto bad = jobs;
+  bad[3].config.strategy = "Unknown";
+  EXPECT_THROW(static_cast<void>(simulator::runBacktests(bad)), std::invalid_argument);
+  bad = jobs;
+  bad[3].config.params.push_back({"unknown", 1.0});
+  EXPECT_THROW(static_cast<void>(simulator::runBacktests(bad)), std::invalid_argument);
+  bad = jobs;
+  bad[3].symbols.push_back("IWM");
+  EXPECT_THROW(static_cast<void>(simulator::runBacktests(bad)), std::invalid_argument);
+
+  for (auto const& file : files) std::filesystem::remove(file);
+}
+
+TEST(Topology, ReadsNodesFromSysfs) {
+  EXPECT_EQ(simulator::parseCpuList("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(simulator::parseCpuList("\n").empty());
+  EXPECT_THROW(static_cast<void>(simulator::parseCpuList("3-1")), std::runtime_error);
+  EXPECT_THROW(static_cast<void>(simulator::parseCpuList("0,x")), std::runtime_error);
+
+  // a dual socket host with hyperthreads, and a node of memory only
+  auto const root = std::filesystem::temp_directory_path() / "lob_simulator_tests_node";
+  std::filesystem::remove_all(root);
+  auto const write = [&root](std::string const& path, std::string const& content) {
+    std::filesystem::create_directories((root / path).parent_path());
+    std::ofstream(root / path) << content;
+  };
+  write("node1/cpulist", "8-15,24-31\n");
+  write("node0/cpulist", "0-7,16-23\n");
+  write("node2/cpulist", "\n");
+  write("possible", "0-2\n");
+  write("node_other/cpulist", "0\n");
+
+  auto every = std::vector<int>(64);
+  std::iota(every.begin(), every.end(), 0);
+  auto const topology = simulator::Topology::discover(root, every);
+  ASSERT_EQ(topology.nodes().size(), 3);
+  EXPECT_EQ(topology.nodes()[0].id, 0);
+  EXPECT_EQ(topology.nodes()[1].id, 1);
+  EXPECT_TRUE(topology.nodes()[2].cpus.empty());
+  EXPECT_EQ(topology.nodeOf(3), 0);
+  EXPECT_EQ(topology.nodeOf(20), 0);
+  EXPECT_EQ(topology.nodeOf(8), 1);
+  EXPECT_EQ(topology.nodeOf(31), 1);
+  EXPECT_EQ(topology.nodeOf(32), -1);
+  auto const cpus = topology.cpus();
+  ASSERT_EQ(cpus.size(), 32);
+  EXPECT_EQ(cpus[16], 8);
+  EXPECT_EQ(topology.toString(), "node 0: CPUs 0-7,16-23\nnode 1: CPUs 8-15,24-31\nnode 2: no CPUs\n");
+
+  // an affinity mask, e.g. from taskset, keeps only its CPUs
+  auto const masked = simulator::Topology::discover(root, {25, 2, 1, 40});
+  ASSERT_EQ(masked.nodes().size(), 3);
+  EXPECT_EQ(masked.cpus(), (std::vector<int>{1, 2, 25}));
+  EXPECT_EQ(masked.nodeOf(3), -1);
+  EXPECT_EQ(masked.nodeOf(25), 1);
+  EXPECT_EQ(masked.toString(), "node 0: CPUs 1-2\nnode 1: CPUs 25\nnode 2: no CPUs\n");
+  std::filesystem::remove_all(root);
+
+  // without sysfs, one node of the allowed CPUs
+  auto const fallback = simulator::Topology::discover(root, {3, 1});
+  ASSERT_EQ(fallback.nodes().size(), 1);
+  EXPECT_EQ(fallback.cpus(), (std::vector<int>{1, 3}));
+
+  // by default those of the process's mask
+  auto const allowed = simulator::allowedCpus();
+  ASSERT_FALSE(allowed.empty());
+  EXPECT_TRUE(std::ranges::is_sorted(allowed));
+  EXPECT_EQ(simulator::Topology::discover(root).cpus(), allowed);
+}
+
+TEST(Topology, RunsOnCore) {
+  auto const core = simulator::Topology::discover().cpus().front();
+  auto const caller = std::this_thread::get_id();
+  EXPECT_NE(simulator::runOnCore(core, [] { return std::this_thread::get_id(); }), caller);
+  auto value = std::make_unique<int>();
+  simulator::runOnCore(core, [&value] { *value = 42; });
+  EXPECT_EQ(*value, 42);
+  EXPECT_THROW(simulator::runOnCore(core, [] { throw std::invalid_argument("thrown on the core"); }), std::invalid_argument);
+}
+
+TEST(Topology, NodeLocalOwnsPagesOfItsOwn) {
+  auto value = simulator::NodeLocal<std::array<int, 2000>>();
+  auto const address = reinterpret_cast<uintptr_t>(&*value);
+  EXPECT_EQ(address % 4096, 0);
+  EXPECT_EQ((*value)[1999], 0);
+  (*value)[1999] = 42;
+
+  auto moved = std::move(value);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&*moved), address);
+  EXPECT_EQ((*moved)[1999], 42);
+
+  // -1 where move_pages isn't allowed
+  auto const topology = simulator::Topology::discover();
+  auto const node = simulator::nodeOfAddress(&*moved);
+  if (topology.nodes().size() == 1) EXPECT_TRUE(node == -1 || node == topology.nodes().front().id) << node;
+}
+
+// Needs a machine with two nodes of CPUs, where each thread's rings and books have to end up on
+// its own node.
+TEST(Topology, PlacesRingsAndBooksOnTheNodeOfTheirThread) {
+  auto nodes = simulator::Topology::discover().nodes();
+  std::erase_if(nodes, [](auto const& node) { return node.cpus.empty(); });
+  if (nodes.size() < 2) GTEST_SKIP() << "needs two NUMA nodes with CPUs";
+
+  auto bmgr = simulator::ItchBooksManager();
+  for (int id = 1; auto const& node : nodes) {
+    auto const* ring = simulator::runOnCore(node.cpus.front(), [&bmgr, id] { return &bmgr.bufferById(id); });
+    auto const* book = simulator::runOnCore(node.cpus.front(), [&bmgr, id] { return &bmgr.bookById(id); });
+    if (simulator::nodeOfAddress(ring) == -1) GTEST_SKIP() << "move_pages is not available";
+    EXPECT_EQ(simulator::nodeOfAddress(ring), node.id) << "core " << node.cpus.front();
+    EXPECT_EQ(simulator::nodeOfAddress(book), node.id) << "core " << node.cpus.front();
+    ++id;
+  }
+}
+
+TEST(TimingWheel, MatchesSortedOrder) {
+  struct Expected {
+    uint64_t time;
+    int id;
+  };
+
+  auto wheel = simulator::TimingWheel<std::function<void()>>();
+  auto expected = std::vector<Expected>();
+  auto handles = std::vector<std::pair<simulator::TimingWheel<std::function<void()>>::Handle, int>>();
+  auto ran = std::vector<Expected>();
+  auto rng = std::mt19937_64(7);
+  int nextId = 0;
+
+  // times spread over every level of the wheel, with many equal ones
+  auto const randomTime = [&](uint64_t from) {
+    auto const span = uint64_t{1} << (rng() % 48);
+    return from + rng() % span / 4 * 4;
+  };
+  auto const schedule = [&](uint64_t time) {
+    auto const id = nextId++;
+    handles.push_back({wheel.schedule(time, [&ran, time, id] { ran.push_back({time, id}); }), id});
+    expected.push_back({time, id});
+  };
+
+  for (int i = 0; i != 5000; ++i) schedule(randomTime(0));
+  for (int i = 0; i != 1000; ++i) {
+    auto const [handle, id] = handles[rng() % handles.size()];
+    if (wheel.cancel(handle)) std::erase_if(expected, [id](Expected const& e) { return e.id == id; });
+  }
+
+  // expire in steps, scheduling more from outside and from the callbacks as time goes by
+  uint64_t limit = 0;
+  while (!wheel.empty()) {
+    limit = randomTime(limit);
+    wheel.expireUntil(limit, [&](uint64_t time, auto const& callback) {
+      callback();
+      if (rng() % 4 == 0) schedule(time + rng() % 3);
+    });
+    EXPECT_FALSE(wheel.nextDue(limit));
+    if (rng() % 2) schedule(randomTime(limit));
+  }
+
+  // in time order, in scheduling order for equal times
+  std::ranges::stable_sort(expected, {}, &Expected::time);
+  ASSERT_EQ(ran.size(), expected.size());
+  for (size_t i = 0; i != ran.size(); ++i) {
+    ASSERT_EQ(ran[i].time, expected[i].time);
+    ASSERT_EQ(ran[i].id, expected[i].id);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,341 @@
+#include <gtest/gtest.h>
+#include <md/BinaryDataReader.h>
+#include <md/ItchGenerator.h>
+#include <md/Symbols.h>
+#include <simulator/ItchBooksManager.h>
+#include <simulator/OMS.h>
+#include <simulator/Simulator.h>
+#include <simulator/functions.h>
+#include <strategies/Composition.h>
+#include <strategies/NpyWriter.h>
+#include <strategies/Registry.h>
+#include <strategies/RollingStats.h>
+#include <strategies/StrategyDiagnostics.h>
+#include <strategies/Strategies.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+struct NaiveStats {
+  double mean = 0.0;
+  double variance = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+};
+
+// two pass
+NaiveStats naive(std::span<double const> values) {
+  auto stats = NaiveStats{};
+  auto const n = static_cast<double>(values.size());
+  stats.mean = std::accumulate(values.begin(), values.end(), 0.0) / n;
+  for (auto const x : values) stats.variance += (x - stats.mean) * (x - stats.mean) / n;
+  stats.min = std::ranges::min(values);
+  stats.max = std::ranges::max(values);
+  return stats;
+}
+
+// a random walk far from zero, where x^2 sums lose the variance to cancellation
+std::vector<double> prices(size_t n, uint64_t seed) {
+  auto rng = std::mt19937_64(seed);
+  auto step = std::normal_distribution(0.0, 0.01);
+  auto values = std::vector<double>(n);
+  auto price = 1'000'000.0;
+  for (auto& x : values) x = price += step(rng);
+  return values;
+}
+
+// The header dict and the values of a .npy file, checking the parts NpyWriter always writes the same.
+template <class T>
+std::pair<std::string, std::vector<T>> readNpy(std::filesystem::path const& path) {
+  auto in = std::ifstream(path, std::ios::binary);
+  auto const bytes = std::string(std::istreambuf_iterator<char>(in), {});
+  EXPECT_GE(bytes.size(), strategies::NpyWriter<T>::HeaderSize);
+  EXPECT_EQ(bytes.substr(0, 8), std::string("\x93NUMPY\x01\x00", 8));
+  auto const headerLen = static_cast<uint8_t>(bytes[8]) | static_cast<uint8_t>(bytes[9]) << 8;
+  EXPECT_EQ(10 + headerLen, strategies::NpyWriter<T>::HeaderSize);
+  EXPECT_EQ(bytes[9 + headerLen], '\n');
+  EXPECT_EQ((bytes.size() - 10 - headerLen) % sizeof(T), 0);
+
+  auto values = std::vector<T>((bytes.size() - 10 - headerLen) / sizeof(T));
+  std::memcpy(values.data(), bytes.data() + 10 + headerLen, values.size() * sizeof(T));
+  auto header = bytes.substr(10, headerLen);
+  header.erase(header.find_last_not_of(" \n") + 1);
+  return {header, values};
+}
+
+TEST(NpyWriter, WritesChunksAndTheFinalShape) {
+  auto const path = std::filesystem::temp_directory_path() / "lob_strategies_tests.npy";
+  auto writer = strategies::NpyWriter<int32_t>(path.string(), 3);
+  auto expected = std::vector<int32_t>();
+  for (int32_t i = 0; i != 10; ++i) {
+    writer.push(i * i - 20);
+    expected.push_back(i * i - 20);
+  }
+  writer.close();
+  EXPECT_EQ(writer.size(), 10);
+  writer.push(0);
+  EXPECT_EQ(writer.size(), 10);
+  EXPECT_EQ(writer.numDropped(), 1);
+
+  auto const [header, values] = readNpy<int32_t>(path);
+  EXPECT_EQ(header, "{'descr': '<i4', 'fortran_order': False, 'shape': (10,), }");
+  EXPECT_EQ(values, expected);
+  std::filesystem::remove(path);
+}
+
+TEST(StrategyDiagnostics, StreamsColumnsUntilSaved) {
+  auto const dir = std::filesystem::temp_directory_path() / "lob_strategies_tests";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  auto diagnostics = strategies::StrategyDiagnostics{};
+  diagnostics.streamTo((dir / "QQQ").string());
+  diagnostics.addObs(100.5, 101.0);
+  diagnostics.addObs(0.0, 101.5);  // no bid
+  auto copy = diagnostics;
+  copy.addObs(100.0, 0.0);  // no ask, into the same columns
+  diagnostics.save((dir / "QQQ.json").string());
+
+  auto const [bidsHeader, bids] = readNpy<double>(dir / "QQQ.bids.npy");
+  EXPECT_EQ(bidsHeader, "{'descr': '<f8', 'fortran_order': False, 'shape': (2,), }");
+  EXPECT_EQ(bids, (std::vector{100.5, 100.0}));
+  auto const [asksHeader, asks] = readNpy<double>(dir / "QQQ.asks.npy");
+  EXPECT_EQ(asksHeader, "{'descr': '<f8', 'fortran_order': False, 'shape': (2,), }");
+  EXPECT_EQ(asks, (std::vector{101.0, 101.5}));
+
+  auto const json = nlohmann::json::parse(std::ifstream(dir / "QQQ.json"));
+  EXPECT_EQ(json["bids"]["file"], "QQQ.bids.npy");
+  EXPECT_EQ(json["asks"]["file"], "QQQ.asks.npy");
+  EXPECT_EQ(json["asks"]["count"], 2);
+
+  // the files are complete, later observations are only counted
+  diagnostics.addObs(100.0, 101.0);
+  copy.addObs(100.0, 0.0);
+  EXPECT_EQ(diagnostics.numObsDropped(), 3);
+  EXPECT_EQ(copy.numObsDropped(), 3);
+  EXPECT_EQ(readNpy<double>(dir / "QQQ.bids.npy").second.size(), 2);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(NpyWriter, CloseThrowsWhenWritesFail) {
+  if (!std::filesystem::exists("/dev/full")) GTEST_SKIP() << "no /dev/full";
+  auto writer = strategies::NpyWriter<double>("/dev/full", 4);
+  for (int i = 0; i != 10; ++i) writer.push(i);
+  EXPECT_THROW(writer.close(), std::runtime_error);
+}
+
+TEST(RollingStats, CountWindowsMatchNaive) {
+  auto const values = prices(20'000, 1);
+  for (size_t n : {1, 7, 100, 1000}) {
+    auto moments = strategies::RollingMoments(n);
+    auto minMax = strategies::RollingMinMax<double>(n);
+    for (size_t i = 0; i != values.size(); ++i) {
+      moments.add(values[i]);
+      minMax.add(values[i]);
+      if (i % 97 != 0) continue;
+
+      auto const from = i + 1 > n ? i + 1 - n : 0;
+      auto const expected = naive(std::span(values).subspan(from, i + 1 - from));
+      ASSERT_EQ(moments.size(), i + 1 - from);
+      ASSERT_NEAR(moments.mean(), expected.mean, 1e-6);
+      ASSERT_NEAR(moments.variance(), expected.variance, 1e-6 + 1e-6 * expected.variance);
+      ASSERT_EQ(minMax.min(), expected.min);
+      ASSERT_EQ(minMax.max(), expected.max);
+    }
+  }
+}
+
+TEST(RollingStats, TimeWindowsMatchNaive) {
+  auto const values = prices(20'000, 2);
+  auto rng = std::mt19937_64(3);
+  auto times = std::vector<std::chrono::nanoseconds>(values.size());
+  auto t = 0ns;
+  // bursts at the same time as well as gaps longer than the window
+  for (auto& time : times) time = t += std::chrono::nanoseconds(rng() % 4 == 0 ? 0 : rng() % 3 == 0 ? rng() % 5000 : rng() % 50);
+
+  auto const window = 1000ns;
+  auto moments = strategies::TimeRollingMoments(window);
+  auto minMax = strategies::TimeRollingMinMax<double>(window);
+  size_t from = 0;
+  for (size_t i = 0; i != values.size(); ++i) {
+    moments.add(times[i], values[i]);
+    minMax.add(times[i], values[i]);
+    while (times[from] <= times[i] - window) ++from;
+
+    auto const expected = naive(std::span(values).subspan(from, i + 1 - from));
+    ASSERT_EQ(moments.size(), i + 1 - from);
+    ASSERT_NEAR(moments.mean(), expected.mean, 1e-6);
+    ASSERT_NEAR(moments.variance(), expected.variance, 1e-6 + 1e-6 * expected.variance);
+    ASSERT_EQ(minMax.min(), expected.min);
+    ASSERT_EQ(minMax.max(), expected.max);
+  }
+}
+
+TEST(RollingStats, Ewma) {
+  auto const values = prices(1000, 4);
+  auto const reference = [&values](double alpha) {
+    auto mean = values[0];
+    for (size_t i = 1; i != values.size(); ++i) mean += alpha * (values[i] - mean);
+    return mean;
+  };
+
+  auto ewma = strategies::Ewma::ofSpan(19);
+  for (auto const x : values) ewma.add(x);
+  EXPECT_NEAR(ewma.mean(), reference(0.1), 1e-6);
+
+  // evenly spaced by a quarter of the half life
+  auto timeEwma = strategies::TimeEwma(400ns);
+  for (size_t i = 0; i != values.size(); ++i) timeEwma.add(std::chrono::nanoseconds(1000 + 100 * static_cast<int64_t>(i)), values[i]);
+  EXPECT_NEAR(timeEwma.mean(), reference(1.0 - std::exp2(-0.25)), 1e-6);
+
+  auto constant = strategies::Ewma(0.3);
+  for (int i = 0; i != 10; ++i) constant.add(5.0);
+  EXPECT_EQ(constant.mean(), 5.0);
+  EXPECT_EQ(constant.variance(), 0.0);
+}
+
+TEST(RollingStats, BlocksMatchSingleSeries) {
+  constexpr size_t NumSeries = 13;
+  constexpr size_t N = 50;
+  auto series = std::vector<std::vector<double>>();
+  for (size_t s = 0; s != NumSeries; ++s) series.push_back(prices(500, 10 + s));
+
+  auto block = strategies::RollingMomentsBlock(NumSeries, N);
+  auto ewmaBlock = strategies::EwmaBlock(NumSeries, 0.05);
+  auto single = std::vector<strategies::RollingMoments>(NumSeries, strategies::RollingMoments(N));
+  auto singleEwma = std::vector<strategies::Ewma>(NumSeries, strategies::Ewma(0.05));
+  auto xs = std::vector<double>(NumSeries);
+  for (size_t i = 0; i != series[0].size(); ++i) {
+    for (size_t s = 0; s != NumSeries; ++s) {
+      xs[s] = series[s][i];
+      single[s].add(xs[s]);
+      singleEwma[s].add(xs[s]);
+    }
+    block.add(xs);
+    ewmaBlock.add(xs);
+    for (size_t s = 0; s != NumSeries; ++s) {
+      ASSERT_NEAR(block.mean(s), single[s].mean(), 1e-9);
+      ASSERT_NEAR(block.variance(s), single[s].variance(), 1e-9);
+      ASSERT_NEAR(ewmaBlock.mean(s), singleEwma[s].mean(), 1e-9);
+      ASSERT_NEAR(ewmaBlock.variance(s), singleEwma[s].variance(), 1e-9);
+    }
+  }
+  EXPECT_EQ(block.size(), N);
+}
+
+std::string generatedItch() {
+  auto config = md::ItchGeneratorConfig{};
+  config.symbols = {"QQQ", "SPY"};
+  config.numMessages = 200000;
+  config.priceMoveProbability = 0.01;
+  auto out = std::ostringstream();
+  md::generateItch(out, config);
+  return out.str();
+}
+
+// Runs a strategy of type S on QQQ, calling onStep(strategy) after each of its updates.
+template <class S>
+strategies::StrategyDiagnostics run(std::string const& data, typename S::Params const& params, auto&& onStep) {
+  auto reader = md::BinaryDataReader(data.data(), data.size());
+  auto const symbolId = md::utils::Symbols(reader).byName("QQQ");
+  reader.reset();
+
+  auto bmgr = simulator::ItchBooksManager();
+  auto simulator = simulator::Simulator([&] { return simulator::getNextMarketDataEvent(reader, bmgr); });
+  auto oms = simulator::OMS();
+  oms.connect(simulator, bmgr);
+  bmgr.subscribe(symbolId);
+  auto strategy = S(oms, symbolId, params);
+  constexpr size_t NumEvents = 150000;
+  for (size_t n = 0; n < NumEvents;) {
+    auto const run = simulator.runFor(NumEvents - n, [&bmgr] { return bmgr.topsChanged(); });
+    n += run.numEvents;
+    bmgr.takeChangedTops([&](int, auto const& book) {
+      strategy.onUpdate(run.timestamp, book.top());
+      onStep(strategy);
+    });
+    oms.processRequests();
+  }
+  return strategy.diagnostics();
+}
+
+TEST(Composition, MeanReversionMatchesTestStrategy) {
+  auto const data = generatedItch();
+  for (size_t k : {10, 50}) {
+    auto const expected = run<strategies::TestStrategy>(data, {.k = k}, [](auto const&) {});
+    auto params = strategies::MeanReversion::Params{};
+    std::get<0>(params.components).k = k;
+    auto const composed = run<strategies::MeanReversion>(data, params, [](auto const&) {});
+    EXPECT_GT(expected.numFills, 0);
+    EXPECT_EQ(composed.numOrders, expected.numOrders);
+    EXPECT_EQ(composed.numFills, expected.numFills);
+    EXPECT_EQ(composed.position, expected.position);
+    EXPECT_EQ(composed.cash, expected.cash);
+  }
+}
+
+TEST(Composition, FiltersHoldMomentumBack) {
+  auto const data = generatedItch();
+  auto params = strategies::Momentum::Params{};
+  auto& [signal, maxSpread, maxPosition, cooldown] = params.components;
+  signal = {.fast = 5.0, .slow = 50.0, .qty = 3};
+  maxSpread.maxSpread = 1000;
+  cooldown.numUpdates = 0;
+
+  // it flips between long and short qty
+  maxPosition.limit = 3;
+  int64_t maxAbsPosition = 0;
+  auto const free = run<strategies::Momentum>(data, params, [&](auto const& s) { maxAbsPosition = std::max(maxAbsPosition, std::abs(s.position())); });
+  EXPECT_GT(free.numFills, 0);
+  EXPECT_EQ(maxAbsPosition, 3);
+
+  // every order would take it beyond the limit
+  maxPosition.limit = 2;
+  auto const limited = run<strategies::Momentum>(data, params, [](auto const&) {});
+  EXPECT_EQ(limited.numOrders, 0);
+
+  // cooling down between orders sends fewer of them
+  maxPosition.limit = 3;
+  cooldown.numUpdates = 50;
+  auto const cooled = run<strategies::Momentum>(data, params, [](auto const&) {});
+  EXPECT_LT(cooled.numOrders, free.numOrders);
+}
+
+TEST(Registry, FindsStrategiesAndTheirFields) {
+  auto names = std::vector<std::string_view>();
+  strategies::RegisteredStrategies::forEach([&names]<class Entry>() { names.push_back(Entry::name); });
+  EXPECT_EQ(names, (std::vector<std::string_view>{"TestStrategy", "MeanReversion", "Momentum"}));
+
+  auto fields = std::vector<std::string_view>();
+  EXPECT_TRUE(strategies::RegisteredStrategies::visit("Momentum", [&fields]<class Entry>() {
+    auto params = typename Entry::ParamsT{};
+    strategies::forEachField(params, [&fields](std::string_view name, auto&) { fields.push_back(name); });
+  }));
+  EXPECT_EQ(fields, (std::vector<std::string_view>{"fast", "slow", "qty", "maxSpread", "maxPosition", "cooldown"}));
+  EXPECT_FALSE(strategies::RegisteredStrategies::visit("Unknown", []<class>() {}));
+
+  // fields are references into the params
+  auto params = strategies::MeanReversion::Params{};
+  strategies::forEachField(params, [](std::string_view name, auto& value) {
+    if (name == "entry") value = 1.5;
+  });
+  EXPECT_EQ(std::get<0>(params.components).entry, 1.5);
+}
+
+}  // namespace
@@ -18,7 +18,7 @@ symbols = p.Symbols(reader)
 oms = p.OMS()
 symbol_id = symbols.byName('QQQ')
 ks = [10, 50, 100, 200, 500]
-strategies = {symbol_id: [p.TestStrategy(oms, k, symbol_id, logger) for k in ks]}
+strategies = {symbol_id: [p.TestStrategy(oms, symbol_id, p.TestStrategy.Params(k=k), logger) for k in ks]}
 
 print(f'file: {file}')
 print(f'reader: {reader}')
@@ -28,16 +28,50 @@ print(f'strategies: {strategies}')
 N = 1000000
 
 ts = time.time()
-p.testStrategies(reader, strategies, N)
+p.testStrategies(reader, oms, strategies, N)
 te = time.time()
 
 print(f'Took {te - ts}s' )
+print(f'oms: {oms}')
 
 for id, strategiesForSymbol in strategies.items():
     print(f'strategies for symbol {id} ({symbols.byId(id)})')
     for strategy in strategiesForSymbol:
         print(strategy.diagnostics.toString())
 
+# strategies composed from a signal, filters and an execution bind the same way
+momentumOms = p.OMS()
+momentum = {symbol_id: [p.Momentum(momentumOms, symbol_id, p.Momentum.Params(fast=f, slow=10 * f, maxPosition=5)) for f in [10, 50]]}
+p.testStrategies(reader, momentumOms, momentum, N)
+for strategy in momentum[symbol_id]:
+    print(strategy.diagnostics.toString())
+
+# strategies alone, on a recording of the tops they were fed
+p.recordTopOfBook(reader, [symbol_id], N, 'QQQ.tops')
+recording = p.TopOfBookRecording('QQQ.tops')
+replayed = {symbol_id: [p.TestStrategy(p.OMS(), symbol_id, p.TestStrategy.Params(k=k)) for k in ks]}
+ts = time.time()
+p.replayStrategies(recording, replayed)
+te = time.time()
+print(f'Replaying {len(recording)} tops took {te - ts}s')
+
+# the same strategy over a parameter grid, replaying the book once for all of it
+grid = p.makeGrid(list(range(10, 510, 10)), [1.0, 1.5, 2.0, 2.5, 3.0], [1, 10])
+
+ts = time.time()
+results = p.sweep(reader, symbol_id, grid, N, numWorkers=4)
+te = time.time()
+
+print(f'Sweep of {len(grid)} parameter sets took {te - ts}s')
+for result in sorted(results, key=lambda r: r.numFills, reverse=True)[:10]:
+    print(result)
+
+# independent days, symbol sets and strategy configs on a pool sized to the machine
+jobs = p.makeBacktestJobs(["../data/01302019.NASDAQ_ITCH50"], [["QQQ"], ["SPY", "IWM"]],
+                          [p.StrategyConfig("TestStrategy", k=k) for k in ks] + [p.StrategyConfig("Momentum", fast=20, slow=200)])
+report = p.runBacktests(jobs, numIters=N)
+print(report.toString())
+
 timestamps, bids, asks = p.getTopOfBookData(reader, symbol_id, N)
 
 def plotBA(n=0):